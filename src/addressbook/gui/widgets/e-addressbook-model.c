@@ -43,6 +43,7 @@ struct _EAddressbookModelPrivate {
 
 	/* Query Results */
 	GPtrArray *contacts;
+	GHashTable *contacts_index; /* gchar *uid ~> gint *index into contacts */
 
 	/* Signal Handler IDs */
 	gulong create_contact_id;
@@ -91,6 +92,41 @@ free_data (EAddressbookModel *model)
 	array = model->priv->contacts;
 	g_ptr_array_foreach (array, (GFunc) g_object_unref, NULL);
 	g_ptr_array_set_size (array, 0);
+
+	g_hash_table_remove_all (model->priv->contacts_index);
+}
+
+static gint
+contacts_index_lookup (EAddressbookModel *model,
+                       const gchar *uid)
+{
+	gint *pindex;
+
+	if (!uid)
+		return -1;
+
+	pindex = g_hash_table_lookup (model->priv->contacts_index, uid);
+
+	return pindex ? *pindex : -1;
+}
+
+static void
+contacts_index_set (EAddressbookModel *model,
+                    const gchar *uid,
+                    gint index)
+{
+	gint *pindex;
+
+	if (!uid)
+		return;
+
+	pindex = g_hash_table_lookup (model->priv->contacts_index, uid);
+	if (!pindex) {
+		pindex = g_new (gint, 1);
+		g_hash_table_insert (model->priv->contacts_index, g_strdup (uid), pindex);
+	}
+
+	*pindex = index;
 }
 
 static void
@@ -186,6 +222,7 @@ view_create_contact_cb (EBookClientView *client_view,
 	while (contact_list != NULL) {
 		EContact *contact = contact_list->data;
 
+		contacts_index_set (model, e_contact_get_const (contact, E_CONTACT_UID), array->len);
 		g_ptr_array_add (array, g_object_ref (contact));
 		contact_list = contact_list->next;
 	}
@@ -209,51 +246,54 @@ view_remove_contact_cb (EBookClientView *client_view,
                         const GSList *ids,
                         EAddressbookModel *model)
 {
-	/* XXX we should keep a hash around instead of this O(n*m) loop */
 	const GSList *iter;
 	GArray *indices;
 	GPtrArray *array;
-	gint ii;
+	guint ii, jj;
 
 	array = model->priv->contacts;
 	indices = g_array_new (FALSE, FALSE, sizeof (gint));
 
+	/* Leave NULL in place of the removed contacts first... */
 	for (iter = ids; iter != NULL; iter = iter->next) {
 		const gchar *target_uid = iter->data;
+		gint index;
 
-		for (ii = 0; ii < array->len; ii++) {
-			EContact *contact;
-			const gchar *uid;
+		index = contacts_index_lookup (model, target_uid);
+		if (index < 0 || index >= array->len || !array->pdata[index])
+			continue;
+
+		g_object_unref (array->pdata[index]);
+		array->pdata[index] = NULL;
+		g_array_append_val (indices, index);
+
+		g_hash_table_remove (model->priv->contacts_index, target_uid);
+	}
+
+	/* ...then drop all of them in one pass, instead of shifting
+	 * the rest of the array with each removed contact. */
+	if (indices->len > 0) {
+		for (ii = 0, jj = 0; ii < array->len; ii++) {
+			EContact *contact = array->pdata[ii];
 
-			contact = array->pdata[ii];
-			/* check if already removed */
 			if (!contact)
 				continue;
 
-			uid = e_contact_get_const (contact, E_CONTACT_UID);
-			g_return_if_fail (uid != NULL);
-
-			if (strcmp (uid, target_uid) == 0) {
-				g_object_unref (contact);
-				g_array_append_val (indices, ii);
-				array->pdata[ii] = NULL;
-				break;
+			if (ii != jj) {
+				array->pdata[jj] = contact;
+				contacts_index_set (model, e_contact_get_const (contact, E_CONTACT_UID), jj);
 			}
+
+			jj++;
 		}
+
+		g_ptr_array_set_size (array, jj);
 	}
 
-	/* Sort the 'indices' array in descending order, since
-	 * g_ptr_array_remove_index() shifts subsequent elements
-	 * down one position to fill the gap. */
+	/* Listeners expect the 'indices' array in descending order,
+	 * the same as when removing the contacts one by one. */
 	g_array_sort (indices, sort_descending);
 
-	for (ii = 0; ii < indices->len; ii++) {
-		gint index;
-
-		index = g_array_index (indices, gint, ii);
-		g_ptr_array_remove_index (array, index);
-	}
-
 	g_signal_emit (model, signals[CONTACTS_REMOVED], 0, indices);
 	g_array_free (indices, FALSE);
 
@@ -272,7 +312,7 @@ view_modify_contact_cb (EBookClientView *client_view,
 	while (contact_list != NULL) {
 		EContact *new_contact = contact_list->data;
 		const gchar *target_uid;
-		gint ii;
+		gint index;
 
 		target_uid = e_contact_get_const (new_contact, E_CONTACT_UID);
 		g_warn_if_fail (target_uid != NULL);
@@ -283,25 +323,14 @@ view_modify_contact_cb (EBookClientView *client_view,
 			continue;
 		}
 
-		for (ii = 0; ii < array->len; ii++) {
-			EContact *old_contact;
-			const gchar *uid;
+		index = contacts_index_lookup (model, target_uid);
 
-			old_contact = array->pdata[ii];
-			g_return_if_fail (old_contact != NULL);
-
-			uid = e_contact_get_const (old_contact, E_CONTACT_UID);
-			g_return_if_fail (uid != NULL);
-
-			if (strcmp (uid, target_uid) != 0)
-				continue;
-
-			g_object_unref (old_contact);
-			array->pdata[ii] = e_contact_duplicate (new_contact);
+		if (index >= 0 && index < array->len) {
+			g_object_unref (array->pdata[index]);
+			array->pdata[index] = e_contact_duplicate (new_contact);
 
 			g_signal_emit (
-				model, signals[CONTACT_CHANGED], 0, ii);
-			break;
+				model, signals[CONTACT_CHANGED], 0, index);
 		}
 
 		contact_list = contact_list->next;
@@ -577,6 +606,7 @@ addressbook_model_finalize (GObject *object)
 	priv = E_ADDRESSBOOK_MODEL_GET_PRIVATE (object);
 
 	g_ptr_array_free (priv->contacts, TRUE);
+	g_hash_table_destroy (priv->contacts_index);
 
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (e_addressbook_model_parent_class)->finalize (object);
@@ -768,6 +798,7 @@ e_addressbook_model_init (EAddressbookModel *model)
 {
 	model->priv = E_ADDRESSBOOK_MODEL_GET_PRIVATE (model);
 	model->priv->contacts = g_ptr_array_new ();
+	model->priv->contacts_index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 	model->priv->first_get_view = TRUE;
 }
 
@@ -874,6 +905,12 @@ e_addressbook_model_find (EAddressbookModel *model,
 	g_return_val_if_fail (E_IS_CONTACT (contact), -1);
 
 	array = model->priv->contacts;
+
+	ii = contacts_index_lookup (model, e_contact_get_const (contact, E_CONTACT_UID));
+	if (ii >= 0 && ii < array->len && array->pdata[ii] == contact)
+		return ii;
+
+	/* Fallback for contacts without UID or with a duplicate one */
 	for (ii = 0; ii < array->len; ii++) {
 		EContact *candidate = array->pdata[ii];
 
@@ -49,11 +49,12 @@ typedef struct {
 	EImport *import;
 	EImportTarget *target;
 
-	guint idle_id;
+	guint status_id;
+	gint progress;		/* percentage, updated by the import thread */
+	GCancellable *cancellable;
 
 	GHashTable *dn_contact_hash;
 
-	gint state;		/* 0 - initial scan, 1 - list cards, 2 - cancelled/complete */
 	FILE *file;
 	gulong size;
 
@@ -61,10 +62,9 @@ typedef struct {
 
 	GSList *contacts;
 	GSList *list_contacts;
-	GSList *list_iterator;
 } LDIFImporter;
 
-static void ldif_import_done (LDIFImporter *gci);
+static void ldif_import_done (LDIFImporter *gci, const GError *error);
 
 static struct {
 	const gchar *ldif_attribute;
@@ -481,73 +481,97 @@ add_to_notes (EContact *contact,
 	g_free (new_text);
 }
 
-static gboolean
-ldif_import_contacts (gpointer d)
+static void
+ldif_import_thread (GTask *task,
+                    gpointer source_object,
+                    gpointer task_data,
+                    GCancellable *cancellable)
 {
-	LDIFImporter *gci = d;
+	LDIFImporter *gci = task_data;
 	EContact *contact;
-	GSList *iter;
-	gint count = 0;
+	GSList *link, *batch = NULL;
+	guint batch_len = 0;
+	GError *local_error = NULL;
 
 	/* We process all normal cards immediately and keep the list
 	 * ones till the end */
 
-	if (gci->state == 0) {
-		while (count < 50 && (contact = getNextLDIFEntry (
-			gci->dn_contact_hash, gci->file))) {
+	while (!g_cancellable_is_cancelled (cancellable)) {
+		contact = getNextLDIFEntry (gci->dn_contact_hash, gci->file);
+
+		if (contact) {
 			if (e_contact_get (contact, E_CONTACT_IS_LIST)) {
 				gci->list_contacts = g_slist_prepend (
 					gci->list_contacts, contact);
 			} else {
-				gchar *uid = NULL;
-
 				add_to_notes (contact, E_CONTACT_OFFICE);
 				add_to_notes (contact, E_CONTACT_SPOUSE);
 				add_to_notes (contact, E_CONTACT_BLOG_URL);
 
-				e_book_client_add_contact_sync (
-					gci->book_client,
-					contact, &uid, NULL, NULL);
-				if (uid != NULL) {
-					e_contact_set (contact, E_CONTACT_UID, uid);
-					g_free (uid);
-				}
-				gci->contacts = g_slist_prepend (gci->contacts, contact);
+				batch = g_slist_prepend (batch, contact);
+				batch_len++;
 			}
-			count++;
 		}
-		if (contact == NULL) {
-			gci->state = 1;
-			gci->list_iterator = gci->list_contacts;
+
+		if (batch && (!contact || batch_len >= EVOLUTION_CONTACT_IMPORTER_BATCH_SIZE)) {
+			batch = g_slist_reverse (batch);
+			/* Only the first error is reported */
+			evolution_contact_importer_add_contacts_sync (gci->book_client, batch, cancellable,
+				local_error ? NULL : &local_error);
+
+			/* Keep them, the list cards can reference them through the dn_contact_hash */
+			gci->contacts = g_slist_concat (batch, gci->contacts);
+			batch = NULL;
+			batch_len = 0;
+
+			if (gci->size > 0)
+				g_atomic_int_set (&gci->progress, ftell (gci->file) * 100 / gci->size);
 		}
+
+		if (!contact)
+			break;
 	}
-	if (gci->state == 1) {
-		for (iter = gci->list_iterator; count < 50 && iter; iter = iter->next) {
-			gchar *uid = NULL;
-
-			contact = iter->data;
-			resolve_list_card (gci, contact);
-			e_book_client_add_contact_sync (
-				gci->book_client, contact, &uid, NULL, NULL);
-			if (uid != NULL) {
-				e_contact_set (contact, E_CONTACT_UID, uid);
-				g_free (uid);
-			}
-			count++;
+
+	gci->contacts = g_slist_concat (batch, gci->contacts);
+	batch = NULL;
+	batch_len = 0;
+
+	for (link = gci->list_contacts; link && !g_cancellable_is_cancelled (cancellable); link = g_slist_next (link)) {
+		contact = link->data;
+
+		resolve_list_card (gci, contact);
+
+		batch = g_slist_prepend (batch, contact);
+		batch_len++;
+
+		if (batch_len >= EVOLUTION_CONTACT_IMPORTER_BATCH_SIZE || !link->next) {
+			batch = g_slist_reverse (batch);
+			evolution_contact_importer_add_contacts_sync (gci->book_client, batch, cancellable,
+				local_error ? NULL : &local_error);
+			g_slist_free (batch);
+			batch = NULL;
+			batch_len = 0;
 		}
-		gci->list_iterator = iter;
-		if (iter == NULL)
-			gci->state = 2;
-	}
-	if (gci->state == 2) {
-		ldif_import_done (gci);
-		return FALSE;
-	} else {
-		e_import_status (
-			gci->import, gci->target, _("Importing..."),
-			ftell (gci->file) * 100 / gci->size);
-		return TRUE;
 	}
+
+	g_slist_free (batch);
+
+	if (local_error)
+		g_task_return_error (task, local_error);
+	else
+		g_task_return_boolean (task, TRUE);
+}
+
+static gboolean
+ldif_import_status_cb (gpointer user_data)
+{
+	LDIFImporter *gci = user_data;
+
+	e_import_status (
+		gci->import, gci->target, _("Importing..."),
+		g_atomic_int_get (&gci->progress));
+
+	return TRUE;
 }
 
 static void
@@ -655,25 +679,46 @@ ldif_supported (EImport *ei,
 }
 
 static void
-ldif_import_done (LDIFImporter *gci)
+ldif_import_done (LDIFImporter *gci,
+                  const GError *error)
 {
-	if (gci->idle_id)
-		g_source_remove (gci->idle_id);
+	if (gci->status_id)
+		g_source_remove (gci->status_id);
+
+	g_datalist_remove_data (&gci->target->data, "ldif-data");
 
 	fclose (gci->file);
-	g_object_unref (gci->book_client);
+	g_clear_object (&gci->book_client);
+	g_clear_object (&gci->cancellable);
 	g_slist_foreach (gci->contacts, (GFunc) g_object_unref, NULL);
 	g_slist_foreach (gci->list_contacts, (GFunc) g_object_unref, NULL);
 	g_slist_free (gci->contacts);
 	g_slist_free (gci->list_contacts);
 	g_hash_table_destroy (gci->dn_contact_hash);
 
-	e_import_complete (gci->import, gci->target, NULL);
+	e_import_complete (gci->import, gci->target, error);
 	g_object_unref (gci->import);
 
 	g_free (gci);
 }
 
+static void
+ldif_import_thread_done_cb (GObject *source_object,
+                            GAsyncResult *result,
+                            gpointer user_data)
+{
+	GError *error = NULL;
+
+	/* Cancelled by the user, which is not an error to report */
+	if (!g_task_propagate_boolean (G_TASK (result), &error) &&
+	    g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		g_clear_error (&error);
+
+	ldif_import_done (user_data, error);
+
+	g_clear_error (&error);
+}
+
 static void
 book_client_connect_cb (GObject *source_object,
                         GAsyncResult *result,
@@ -681,16 +726,26 @@ book_client_connect_cb (GObject *source_object,
 {
 	LDIFImporter *gci = user_data;
 	EClient *client;
+	GTask *task;
+	GError *error = NULL;
 
-	client = e_book_client_connect_finish (result, NULL);
+	client = e_book_client_connect_finish (result, &error);
 
 	if (client == NULL) {
-		ldif_import_done (gci);
+		ldif_import_done (gci, error);
+		g_clear_error (&error);
 		return;
 	}
 
 	gci->book_client = E_BOOK_CLIENT (client);
-	gci->idle_id = g_idle_add (ldif_import_contacts, gci);
+	gci->status_id = e_named_timeout_add (250, ldif_import_status_cb, gci);
+
+	/* Parse and add the contacts in a dedicated thread,
+	 * to not block the UI with large files. */
+	task = g_task_new (NULL, gci->cancellable, ldif_import_thread_done_cb, gci);
+	g_task_set_task_data (task, gci, NULL);
+	g_task_run_in_thread (task, ldif_import_thread);
+	g_object_unref (task);
 }
 
 static void
@@ -733,10 +788,11 @@ ldif_import (EImport *ei,
 		g_str_hash, g_str_equal,
 		(GDestroyNotify) g_free,
 		(GDestroyNotify) NULL);
+	gci->cancellable = g_cancellable_new ();
 
 	source = g_datalist_get_data (&target->data, "ldif-source");
 
-	e_book_client_connect (source, 30, NULL, book_client_connect_cb, gci);
+	e_book_client_connect (source, 30, gci->cancellable, book_client_connect_cb, gci);
 }
 
 static void
@@ -747,7 +803,7 @@ ldif_cancel (EImport *ei,
 	LDIFImporter *gci = g_datalist_get_data (&target->data, "ldif-data");
 
 	if (gci)
-		gci->state = 2;
+		g_cancellable_cancel (gci->cancellable);
 }
 
 static GtkWidget *
@@ -53,16 +53,10 @@ typedef struct {
 	EImport *import;
 	EImportTarget *target;
 
-	guint idle_id;
+	guint status_id;
+	gint progress;		/* percentage, updated by the import thread */
+	GCancellable *cancellable;
 
-	gint state;		/* 0 - importing, 1 - cancelled/complete */
-	gint total;
-	gint count;
-
-	ESource *primary;
-
-	GSList *contactlist;
-	GSList *iterator;
 	EBookClient *book_client;
 
 	/* when opening book */
@@ -70,7 +64,7 @@ typedef struct {
 	VCardEncoding encoding;
 } VCardImporter;
 
-static void vcard_import_done (VCardImporter *gci);
+static void vcard_import_done (VCardImporter *gci, const GError *error);
 
 static void
 vcard_import_contact (VCardImporter *gci,
@@ -78,7 +72,6 @@ vcard_import_contact (VCardImporter *gci,
 {
 	EContactPhoto *photo;
 	GList *attrs, *attr;
-	gchar *uid = NULL;
 
 	/* Apple's addressbook.app exports PHOTO's without a TYPE
 	 * param, so let's figure out the format here if there's a
@@ -211,43 +204,79 @@ vcard_import_contact (VCardImporter *gci,
 								"OTHER");
 		}
 	}
+}
+
+static void
+vcard_import_thread (GTask *task,
+                     gpointer source_object,
+                     gpointer task_data,
+                     GCancellable *cancellable)
+{
+	VCardImporter *gci = task_data;
+	GSList *contactlist, *link, *batch = NULL;
+	guint total, count = 0, batch_len = 0;
+	GError *local_error = NULL;
+
+	if (gci->encoding == VCARD_ENCODING_UTF16) {
+		gchar *tmp;
+
+		gunichar2 *contents_utf16 = (gunichar2 *) gci->contents;
+		tmp = utf16_to_utf8 (contents_utf16);
+		g_free (gci->contents);
+		gci->contents = tmp;
+
+	} else if (gci->encoding == VCARD_ENCODING_LOCALE) {
+		gchar *tmp;
+		tmp = g_locale_to_utf8 (gci->contents, -1, NULL, NULL, NULL);
+		g_free (gci->contents);
+		gci->contents = tmp;
+	}
 
-	/* FIXME Error checking */
-	e_book_client_add_contact_sync (
-		gci->book_client, contact, &uid, NULL, NULL);
-	if (uid != NULL) {
-		e_contact_set (contact, E_CONTACT_UID, uid);
-		g_free (uid);
+	contactlist = eab_contact_list_from_string (gci->contents);
+	g_free (gci->contents);
+	gci->contents = NULL;
+
+	total = g_slist_length (contactlist);
+
+	for (link = contactlist; link && !g_cancellable_is_cancelled (cancellable); link = g_slist_next (link)) {
+		vcard_import_contact (gci, link->data);
+
+		batch = g_slist_prepend (batch, link->data);
+		batch_len++;
+		count++;
+
+		if (batch_len >= EVOLUTION_CONTACT_IMPORTER_BATCH_SIZE || !link->next) {
+			batch = g_slist_reverse (batch);
+			/* Only the first error is reported */
+			evolution_contact_importer_add_contacts_sync (gci->book_client, batch, cancellable,
+				local_error ? NULL : &local_error);
+			g_slist_free (batch);
+			batch = NULL;
+			batch_len = 0;
+
+			g_atomic_int_set (&gci->progress, count * 100 / total);
+		}
 	}
+
+	g_slist_free (batch);
+	g_slist_free_full (contactlist, g_object_unref);
+
+	if (local_error)
+		g_task_return_error (task, local_error);
+	else
+		g_task_return_boolean (task, TRUE);
 }
 
 static gboolean
-vcard_import_contacts (gpointer data)
+vcard_import_status_cb (gpointer user_data)
 {
-	VCardImporter *gci = data;
-	gint count = 0;
-	GSList *iterator = gci->iterator;
-
-	if (gci->state == 0) {
-		while (count < 50 && iterator) {
-			vcard_import_contact (gci, iterator->data);
-			count++;
-			iterator = iterator->next;
-		}
-		gci->count += count;
-		gci->iterator = iterator;
-		if (iterator == NULL)
-			gci->state = 1;
-	}
-	if (gci->state == 1) {
-		vcard_import_done (gci);
-		return FALSE;
-	} else {
-		e_import_status (
-			gci->import, gci->target, _("Importing..."),
-			gci->count * 100 / gci->total);
-		return TRUE;
-	}
+	VCardImporter *gci = user_data;
+
+	e_import_status (
+		gci->import, gci->target, _("Importing..."),
+		g_atomic_int_get (&gci->progress));
+
+	return TRUE;
 }
 
 #define BOM (gunichar2)0xFEFF
@@ -452,20 +481,40 @@ vcard_supported (EImport *ei,
 }
 
 static void
-vcard_import_done (VCardImporter *gci)
+vcard_import_done (VCardImporter *gci,
+                   const GError *error)
 {
-	if (gci->idle_id)
-		g_source_remove (gci->idle_id);
+	if (gci->status_id)
+		g_source_remove (gci->status_id);
+
+	g_datalist_remove_data (&gci->target->data, "vcard-data");
 
 	g_free (gci->contents);
-	g_object_unref (gci->book_client);
-	g_slist_free_full (gci->contactlist, (GDestroyNotify) g_object_unref);
+	g_clear_object (&gci->book_client);
+	g_clear_object (&gci->cancellable);
 
-	e_import_complete (gci->import, gci->target, NULL);
+	e_import_complete (gci->import, gci->target, error);
 	g_object_unref (gci->import);
 	g_free (gci);
 }
 
+static void
+vcard_import_thread_done_cb (GObject *source_object,
+                             GAsyncResult *result,
+                             gpointer user_data)
+{
+	GError *error = NULL;
+
+	/* Cancelled by the user, which is not an error to report */
+	if (!g_task_propagate_boolean (G_TASK (result), &error) &&
+	    g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		g_clear_error (&error);
+
+	vcard_import_done (user_data, error);
+
+	g_clear_error (&error);
+}
+
 static void
 book_client_connect_cb (GObject *source_object,
                         GAsyncResult *result,
@@ -473,41 +522,26 @@ book_client_connect_cb (GObject *source_object,
 {
 	VCardImporter *gci = user_data;
 	EClient *client;
+	GTask *task;
+	GError *error = NULL;
 
-	client = e_book_client_connect_finish (result, NULL);
+	client = e_book_client_connect_finish (result, &error);
 
 	if (client == NULL) {
-		vcard_import_done (gci);
+		vcard_import_done (gci, error);
+		g_clear_error (&error);
 		return;
 	}
 
 	gci->book_client = E_BOOK_CLIENT (client);
-
-	if (gci->encoding == VCARD_ENCODING_UTF16) {
-		gchar *tmp;
-
-		gunichar2 *contents_utf16 = (gunichar2 *) gci->contents;
-		tmp = utf16_to_utf8 (contents_utf16);
-		g_free (gci->contents);
-		gci->contents = tmp;
-
-	} else if (gci->encoding == VCARD_ENCODING_LOCALE) {
-		gchar *tmp;
-		tmp = g_locale_to_utf8 (gci->contents, -1, NULL, NULL, NULL);
-		g_free (gci->contents);
-		gci->contents = tmp;
-	}
-
-	gci->contactlist = eab_contact_list_from_string (gci->contents);
-	g_free (gci->contents);
-	gci->contents = NULL;
-	gci->iterator = gci->contactlist;
-	gci->total = g_slist_length (gci->contactlist);
-
-	if (gci->iterator)
-		gci->idle_id = g_idle_add (vcard_import_contacts, gci);
-	else
-		vcard_import_done (gci);
+	gci->status_id = e_named_timeout_add (250, vcard_import_status_cb, gci);
+
+	/* Parse and add the contacts in a dedicated thread,
+	 * to not block the UI with large files. */
+	task = g_task_new (NULL, gci->cancellable, vcard_import_thread_done_cb, gci);
+	g_task_set_task_data (task, gci, NULL);
+	g_task_run_in_thread (task, vcard_import_thread);
+	g_object_unref (task);
 }
 
 static void
@@ -555,10 +589,11 @@ vcard_import (EImport *ei,
 	gci->target = target;
 	gci->encoding = encoding;
 	gci->contents = contents;
+	gci->cancellable = g_cancellable_new ();
 
 	source = g_datalist_get_data (&target->data, "vcard-source");
 
-	e_book_client_connect (source, 30, NULL, book_client_connect_cb, gci);
+	e_book_client_connect (source, 30, gci->cancellable, book_client_connect_cb, gci);
 }
 
 static void
@@ -569,7 +604,7 @@ vcard_cancel (EImport *ei,
 	VCardImporter *gci = g_datalist_get_data (&target->data, "vcard-data");
 
 	if (gci)
-		gci->state = 1;
+		g_cancellable_cancel (gci->cancellable);
 }
 
 static GtkWidget *
@@ -994,3 +1029,123 @@ evolution_contact_importer_get_preview_widget (const GSList *contacts)
 
 	return preview;
 }
+
+/* Whether the contact with the @uid is in the book already; errors
+ * other than the cancellation are treated as it is not. */
+static gboolean
+evolution_contact_importer_contact_exists_sync (EBookClient *book_client,
+                                                const gchar *uid,
+                                                GCancellable *cancellable,
+                                                GError **error)
+{
+	EContact *contact = NULL;
+	GError *local_error = NULL;
+
+	if (e_book_client_get_contact_sync (book_client, uid, &contact, cancellable, &local_error)) {
+		g_clear_object (&contact);
+		return TRUE;
+	}
+
+	if (g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		g_propagate_error (error, local_error);
+	else
+		g_clear_error (&local_error);
+
+	return FALSE;
+}
+
+/* Adds the @contacts to the book at once, when the book supports it,
+ * and sets their UIDs. The contacts the book refuses are skipped and
+ * the first error is returned, after all the other contacts are added,
+ * thus a single broken contact does not stop the import. */
+gboolean
+evolution_contact_importer_add_contacts_sync (EBookClient *book_client,
+                                              GSList *contacts,
+                                              GCancellable *cancellable,
+                                              GError **error)
+{
+	GSList *uids = NULL, *link, *uid_link;
+	GError *local_error = NULL;
+	gboolean batched;
+
+	if (!contacts)
+		return TRUE;
+
+	batched = contacts->next && e_client_check_capability (E_CLIENT (book_client), "bulk-adds");
+
+	if (batched) {
+		/* Give the contacts their UIDs in advance, thus it can be found out
+		 * which of them the book added, when it refuses the whole batch. */
+		for (link = contacts; link; link = g_slist_next (link)) {
+			if (!e_contact_get_const (link->data, E_CONTACT_UID)) {
+				gchar *uid = e_util_generate_uid ();
+
+				e_contact_set (link->data, E_CONTACT_UID, uid);
+				g_free (uid);
+			}
+		}
+
+		if (e_book_client_add_contacts_sync (book_client, contacts, &uids, cancellable, &local_error)) {
+			for (link = contacts, uid_link = uids;
+			     link && uid_link;
+			     link = g_slist_next (link), uid_link = g_slist_next (uid_link)) {
+				if (uid_link->data)
+					e_contact_set (link->data, E_CONTACT_UID, uid_link->data);
+			}
+
+			g_slist_free_full (uids, g_free);
+
+			return TRUE;
+		}
+
+		if (g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_propagate_error (error, local_error);
+			return FALSE;
+		}
+
+		g_clear_error (&local_error);
+	}
+
+	/* Add the contacts one by one, either because the book cannot add
+	 * more at once, or it refused the batch, to not lose all of them
+	 * only because of a single broken contact. Not every book adds
+	 * the batch as a whole or nothing, thus those already added are
+	 * skipped, not to create duplicates. */
+	for (link = contacts; link; link = g_slist_next (link)) {
+		EContact *contact = link->data;
+		GError *contact_error = NULL;
+		gchar *uid = NULL;
+
+		if (batched && evolution_contact_importer_contact_exists_sync (book_client,
+			e_contact_get_const (contact, E_CONTACT_UID), cancellable, &contact_error))
+			continue;
+
+		if (!contact_error &&
+		    e_book_client_add_contact_sync (book_client, contact, &uid, cancellable, &contact_error)) {
+			if (uid != NULL) {
+				e_contact_set (contact, E_CONTACT_UID, uid);
+				g_free (uid);
+			}
+
+			continue;
+		}
+
+		if (g_error_matches (contact_error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_clear_error (&local_error);
+			g_propagate_error (error, contact_error);
+			return FALSE;
+		}
+
+		if (local_error)
+			g_clear_error (&contact_error);
+		else
+			local_error = contact_error;
+	}
+
+	if (local_error) {
+		g_propagate_error (error, local_error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
@@ -0,0 +1,276 @@
+/*
+ * test-contact-importer.c
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Measures how long it takes to import a generated vCard, LDIF or CSV file
+ * into an address book through the importers, the same way as the Import
+ * assistant does. The imported contacts are removed afterwards, but better
+ * use an address book made for the test. */
+
+#include "evolution-config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <libebook/libebook.h>
+
+#include <e-util/e-util.h>
+
+#include "evolution-addressbook-importers.h"
+
+/* All the generated contacts have their e-mail address in this domain */
+#define EMAIL_DOMAIN "contact-importer.example.com"
+
+typedef struct _ImportData {
+	GMainLoop *loop;
+	GError *error;
+	gint last_pc;
+} ImportData;
+
+typedef struct _FileFormat {
+	const gchar *name;
+	const gchar *extension;
+	const gchar *source_key;
+	EImportImporter * (*peek) (void);
+	const gchar *header;
+	const gchar *format; /* takes the index, the index and the index */
+} FileFormat;
+
+static const FileFormat formats[] = {
+	{ "vcard", ".vcf", "vcard-source",
+	  evolution_vcard_importer_peek,
+	  NULL,
+	  "BEGIN:VCARD\r\n"
+	  "VERSION:3.0\r\n"
+	  "FN:Imported Contact %u\r\n"
+	  "N:Contact %u;Imported;;;\r\n"
+	  "EMAIL;TYPE=WORK:imported.contact.%u@" EMAIL_DOMAIN "\r\n"
+	  "END:VCARD\r\n" },
+	{ "ldif", ".ldif", "ldif-source",
+	  evolution_ldif_importer_peek,
+	  NULL,
+	  "dn: cn=Imported Contact %u\n"
+	  "objectclass: top\n"
+	  "objectclass: person\n"
+	  "cn: Imported Contact %u\n"
+	  "mail: imported.contact.%u@" EMAIL_DOMAIN "\n"
+	  "\n" },
+	{ "csv", ".csv", "csv-source",
+	  evolution_csv_evolution_importer_peek,
+	  "First Name,Last Name,NickName,E-mail Address\n",
+	  "Imported,Contact %u,contact%u,imported.contact.%u@" EMAIL_DOMAIN "\n" }
+};
+
+static gchar *
+generate_file (const FileFormat *format,
+               guint n_contacts,
+               GError **error)
+{
+	GString *contents;
+	gchar *dirname, *basename, *filename;
+	guint ii;
+
+	dirname = g_dir_make_tmp ("test-contact-importer-XXXXXX", error);
+	if (!dirname)
+		return NULL;
+
+	contents = g_string_new (format->header);
+
+	for (ii = 0; ii < n_contacts; ii++)
+		g_string_append_printf (contents, format->format, ii, ii, ii);
+
+	basename = g_strconcat ("contacts", format->extension, NULL);
+	filename = g_build_filename (dirname, basename, NULL);
+	g_free (basename);
+	g_free (dirname);
+
+	if (!g_file_set_contents (filename, contents->str, contents->len, error)) {
+		g_free (filename);
+		filename = NULL;
+	}
+
+	g_string_free (contents, TRUE);
+
+	return filename;
+}
+
+static void
+remove_file (const gchar *filename)
+{
+	gchar *dirname;
+
+	dirname = g_path_get_dirname (filename);
+	g_unlink (filename);
+	g_rmdir (dirname);
+	g_free (dirname);
+}
+
+static void
+import_status_cb (EImport *ei,
+                  const gchar *what,
+                  gint pc,
+                  gpointer user_data)
+{
+	ImportData *data = user_data;
+
+	data->last_pc = pc;
+}
+
+static void
+import_done_cb (EImport *ei,
+                const GError *error,
+                gpointer user_data)
+{
+	ImportData *data = user_data;
+
+	if (error)
+		data->error = g_error_copy (error);
+
+	g_main_loop_quit (data->loop);
+}
+
+static gboolean
+import_file (ESource *source,
+             const FileFormat *format,
+             const gchar *filename,
+             GError **error)
+{
+	EImport *import;
+	EImportTargetURI *target;
+	ImportData data;
+	GTimer *timer;
+	gchar *uri;
+
+	uri = g_filename_to_uri (filename, NULL, error);
+	if (!uri)
+		return FALSE;
+
+	import = e_import_new ("org.gnome.evolution.shell.importer");
+	target = e_import_target_new_uri (import, uri, NULL);
+	g_datalist_set_data (&target->target.data, format->source_key, source);
+
+	data.loop = g_main_loop_new (NULL, FALSE);
+	data.error = NULL;
+	data.last_pc = 0;
+
+	timer = g_timer_new ();
+
+	e_import_import (import, (EImportTarget *) target, format->peek (),
+		import_status_cb, import_done_cb, &data);
+
+	g_main_loop_run (data.loop);
+	g_timer_stop (timer);
+
+	if (data.error) {
+		g_propagate_error (error, data.error);
+	} else {
+		g_print ("Imported the %s file in %.3f seconds\n",
+			format->name, g_timer_elapsed (timer, NULL));
+	}
+
+	e_import_target_free (import, target);
+	g_main_loop_unref (data.loop);
+	g_timer_destroy (timer);
+	g_object_unref (import);
+	g_free (uri);
+
+	return data.error == NULL;
+}
+
+static gboolean
+remove_imported_contacts (ESource *source,
+                          guint n_contacts,
+                          GError **error)
+{
+	EClient *client;
+	GSList *uids = NULL;
+	gboolean success;
+
+	client = e_book_client_connect_sync (source, 30, NULL, error);
+	if (!client)
+		return FALSE;
+
+	success = e_book_client_get_contacts_uids_sync (E_BOOK_CLIENT (client),
+		"(endswith \"email\" \"@" EMAIL_DOMAIN "\")", &uids, NULL, error);
+
+	if (success && g_slist_length (uids) != n_contacts)
+		g_printerr ("Expected %u imported contacts, found %u\n", n_contacts, g_slist_length (uids));
+
+	if (success && uids)
+		success = e_book_client_remove_contacts_sync (E_BOOK_CLIENT (client), uids, NULL, error);
+
+	g_slist_free_full (uids, g_free);
+	g_object_unref (client);
+
+	return success;
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	ESourceRegistry *registry;
+	ESource *source = NULL;
+	const FileFormat *format = NULL;
+	gchar *filename = NULL;
+	guint n_contacts = 5000;
+	guint ii;
+	GError *error = NULL;
+
+	if (argc > 2) {
+		for (ii = 0; ii < G_N_ELEMENTS (formats) && !format; ii++) {
+			if (g_ascii_strcasecmp (argv[2], formats[ii].name) == 0)
+				format = &formats[ii];
+		}
+	}
+
+	if (!format) {
+		g_printerr ("USAGE: %s ADDRESS-BOOK-UID vcard|ldif|csv [N-CONTACTS]\n", argv[0]);
+		exit (EXIT_FAILURE);
+	}
+
+	if (argc > 3)
+		n_contacts = MAX (1, atoi (argv[3]));
+
+	registry = e_source_registry_new_sync (NULL, &error);
+	if (registry) {
+		source = e_source_registry_ref_source (registry, argv[1]);
+		if (!source)
+			g_set_error (&error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "Address book '%s' not found", argv[1]);
+		g_object_unref (registry);
+	}
+
+	if (source)
+		filename = generate_file (format, n_contacts, &error);
+
+	if (filename) {
+		if (import_file (source, format, filename, &error))
+			remove_imported_contacts (source, n_contacts, &error);
+
+		remove_file (filename);
+		g_free (filename);
+	}
+
+	g_clear_object (&source);
+
+	if (error) {
+		g_printerr ("%s\n", error->message);
+		g_clear_error (&error);
+		exit (EXIT_FAILURE);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -113,6 +113,119 @@ e_cal_data_model_subscriber_component_removed (ECalDataModelSubscriber *subscrib
 	iface->component_removed (subscriber, client, uid, rid);
 }
 
+/**
+ * e_cal_data_model_subscriber_components_added:
+ * @subscriber: an #ECalDataModelSubscriber
+ * @client: an #ECalClient, which notifies about the component addition
+ * @components: (element-type ECalComponent): a #GSList of added components
+ *
+ * Notifies the @subscriber about multiple added components, all belonging
+ * to the @client and to the time range used by the @subscriber, at once.
+ * Subscribers which do not implement the batched variant receive
+ * one e_cal_data_model_subscriber_component_added() call per component,
+ * in the order of the @components.
+ **/
+void
+e_cal_data_model_subscriber_components_added (ECalDataModelSubscriber *subscriber,
+					      ECalClient *client,
+					      const GSList *components)
+{
+	ECalDataModelSubscriberInterface *iface;
+	const GSList *link;
+
+	g_return_if_fail (E_IS_CAL_DATA_MODEL_SUBSCRIBER (subscriber));
+
+	if (!components)
+		return;
+
+	iface = E_CAL_DATA_MODEL_SUBSCRIBER_GET_INTERFACE (subscriber);
+
+	if (iface->components_added) {
+		iface->components_added (subscriber, client, components);
+		return;
+	}
+
+	for (link = components; link; link = g_slist_next (link)) {
+		e_cal_data_model_subscriber_component_added (subscriber, client, link->data);
+	}
+}
+
+/**
+ * e_cal_data_model_subscriber_components_modified:
+ * @subscriber: an #ECalDataModelSubscriber
+ * @client: an #ECalClient, which notifies about the component modification
+ * @components: (element-type ECalComponent): a #GSList of modified components
+ *
+ * Notifies the @subscriber about multiple modified components, all belonging
+ * to the @client and to the time range used by the @subscriber, at once.
+ * Subscribers which do not implement the batched variant receive
+ * one e_cal_data_model_subscriber_component_modified() call per component,
+ * in the order of the @components.
+ **/
+void
+e_cal_data_model_subscriber_components_modified (ECalDataModelSubscriber *subscriber,
+						 ECalClient *client,
+						 const GSList *components)
+{
+	ECalDataModelSubscriberInterface *iface;
+	const GSList *link;
+
+	g_return_if_fail (E_IS_CAL_DATA_MODEL_SUBSCRIBER (subscriber));
+
+	if (!components)
+		return;
+
+	iface = E_CAL_DATA_MODEL_SUBSCRIBER_GET_INTERFACE (subscriber);
+
+	if (iface->components_modified) {
+		iface->components_modified (subscriber, client, components);
+		return;
+	}
+
+	for (link = components; link; link = g_slist_next (link)) {
+		e_cal_data_model_subscriber_component_modified (subscriber, client, link->data);
+	}
+}
+
+/**
+ * e_cal_data_model_subscriber_components_removed:
+ * @subscriber: an #ECalDataModelSubscriber
+ * @client: an #ECalClient, which notifies about the component removal
+ * @ids: (element-type ECalComponentId): a #GSList of removed component IDs
+ *
+ * Notifies the @subscriber about multiple removed components of the @client
+ * at once. Subscribers which do not implement the batched variant receive
+ * one e_cal_data_model_subscriber_component_removed() call per ID,
+ * in the order of the @ids.
+ **/
+void
+e_cal_data_model_subscriber_components_removed (ECalDataModelSubscriber *subscriber,
+						ECalClient *client,
+						const GSList *ids)
+{
+	ECalDataModelSubscriberInterface *iface;
+	const GSList *link;
+
+	g_return_if_fail (E_IS_CAL_DATA_MODEL_SUBSCRIBER (subscriber));
+
+	if (!ids)
+		return;
+
+	iface = E_CAL_DATA_MODEL_SUBSCRIBER_GET_INTERFACE (subscriber);
+
+	if (iface->components_removed) {
+		iface->components_removed (subscriber, client, ids);
+		return;
+	}
+
+	for (link = ids; link; link = g_slist_next (link)) {
+		const ECalComponentId *id = link->data;
+
+		if (id)
+			e_cal_data_model_subscriber_component_removed (subscriber, client, id->uid, id->rid);
+	}
+}
+
 /**
  * e_cal_data_model_subscriber_freeze:
  * @subscriber: an #ECalDataModelSubscriber
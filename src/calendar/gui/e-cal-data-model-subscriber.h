@@ -60,6 +60,17 @@ struct _ECalDataModelSubscriberInterface {
 					 const gchar *rid);
 	void	(*freeze)		(ECalDataModelSubscriber *subscriber);
 	void	(*thaw)			(ECalDataModelSubscriber *subscriber);
+
+	/* Optional, batched variants of the above */
+	void	(*components_added)	(ECalDataModelSubscriber *subscriber,
+					 ECalClient *client,
+					 const GSList *components); /* ECalComponent * */
+	void	(*components_modified)	(ECalDataModelSubscriber *subscriber,
+					 ECalClient *client,
+					 const GSList *components); /* ECalComponent * */
+	void	(*components_removed)	(ECalDataModelSubscriber *subscriber,
+					 ECalClient *client,
+					 const GSList *ids); /* ECalComponentId * */
 };
 
 GType		e_cal_data_model_subscriber_get_type		(void) G_GNUC_CONST;
@@ -73,6 +84,15 @@ void		e_cal_data_model_subscriber_component_removed	(ECalDataModelSubscriber *su
 								 ECalClient *client,
 								 const gchar *uid,
 								 const gchar *rid);
+void		e_cal_data_model_subscriber_components_added	(ECalDataModelSubscriber *subscriber,
+								 ECalClient *client,
+								 const GSList *components);
+void		e_cal_data_model_subscriber_components_modified	(ECalDataModelSubscriber *subscriber,
+								 ECalClient *client,
+								 const GSList *components);
+void		e_cal_data_model_subscriber_components_removed	(ECalDataModelSubscriber *subscriber,
+								 ECalClient *client,
+								 const GSList *ids);
 void		e_cal_data_model_subscriber_freeze		(ECalDataModelSubscriber *subscriber);
 void		e_cal_data_model_subscriber_thaw		(ECalDataModelSubscriber *subscriber);
 
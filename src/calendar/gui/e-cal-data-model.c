@@ -27,6 +27,13 @@
 #define LOCK_PROPS() g_rec_mutex_lock (&data_model->priv->props_lock)
 #define UNLOCK_PROPS() g_rec_mutex_unlock (&data_model->priv->props_lock)
 
+/* Recurrences of many components are expanded by more jobs in parallel,
+   each taking the components one by one from the ViewData */
+#define EXPAND_RECURRENCES_MAX_JOBS 3
+#define EXPAND_RECURRENCES_PER_JOB 16
+/* How often the already expanded instances are delivered to the subscribers */
+#define EXPAND_RECURRENCES_NOTIFY_INTERVAL (G_USEC_PER_SEC / 5)
+
 struct _ECalDataModelPrivate {
 	GThread *main_thread;
 	ECalDataModelSubmitThreadJobFunc submit_thread_job_func;
@@ -68,11 +75,14 @@ static guint signals[LAST_SIGNAL];
 
 G_DEFINE_TYPE (ECalDataModel, e_cal_data_model, G_TYPE_OBJECT)
 
+typedef struct _ComponentsIndex ComponentsIndex;
+
 typedef struct _ComponentData {
 	ECalComponent *component;
 	time_t instance_start;
 	time_t instance_end;
 	gboolean is_detached;
+	ComponentsIndex *index; /* in which it is, if any */
 } ComponentData;
 
 typedef struct _ViewData {
@@ -90,6 +100,8 @@ typedef struct _ViewData {
 
 	GHashTable *components; /* ECalComponentId ~> ComponentData */
 	GHashTable *lost_components; /* ECalComponentId ~> ComponentData; when re-running view, valid till 'complete' is received */
+	ComponentsIndex *components_index; /* of the 'components' */
+	ComponentsIndex *lost_components_index; /* of the 'lost_components' */
 	gboolean received_complete;
 	GSList *to_expand_recurrences; /* icalcomponent */
 	GSList *expanded_recurrences; /* ComponentData */
@@ -98,12 +110,289 @@ typedef struct _ViewData {
 	GCancellable *cancellable;
 } ViewData;
 
+typedef enum {
+	SUBSCRIBER_BATCH_NONE,
+	SUBSCRIBER_BATCH_ADDED,
+	SUBSCRIBER_BATCH_MODIFIED,
+	SUBSCRIBER_BATCH_REMOVED
+} SubscriberBatchKind;
+
 typedef struct _SubscriberData {
 	ECalDataModelSubscriber *subscriber;
 	time_t range_start;
 	time_t range_end;
+
+	/* Notifications are collected while frozen and delivered in batches;
+	   a batch holds consecutive changes of the same kind for one client,
+	   thus the order of the notifications is preserved. */
+	gint freeze_count;
+	SubscriberBatchKind batch_kind;
+	ECalClient *batch_client;
+	GSList *batch; /* ECalComponent * or ECalComponentId *, in reverse order */
 } SubscriberData;
 
+/* Components of a view are indexed by their instance time, in a treap
+   ordered by the instance start (and the ComponentData address, to make
+   the keys unique), with each node knowing the largest instance end in
+   its subtree. That makes the time range queries O(log n + k). */
+typedef struct _ComponentsIndexNode ComponentsIndexNode;
+
+struct _ComponentsIndexNode {
+	const ECalComponentId *id; /* owned by the hash table */
+	ComponentData *comp_data;
+	time_t max_end; /* the largest instance_end in this subtree */
+	guint32 priority;
+	ComponentsIndexNode *left;
+	ComponentsIndexNode *right;
+};
+
+struct _ComponentsIndex {
+	ComponentsIndexNode *root;
+};
+
+static gint
+components_index_compare (const ComponentData *comp_data1,
+			  const ComponentData *comp_data2)
+{
+	if (comp_data1->instance_start != comp_data2->instance_start)
+		return comp_data1->instance_start < comp_data2->instance_start ? -1 : 1;
+
+	if (comp_data1 == comp_data2)
+		return 0;
+
+	return GPOINTER_TO_SIZE (comp_data1) < GPOINTER_TO_SIZE (comp_data2) ? -1 : 1;
+}
+
+static void
+components_index_node_update (ComponentsIndexNode *node)
+{
+	node->max_end = node->comp_data->instance_end;
+
+	if (node->left && node->left->max_end > node->max_end)
+		node->max_end = node->left->max_end;
+
+	if (node->right && node->right->max_end > node->max_end)
+		node->max_end = node->right->max_end;
+}
+
+static ComponentsIndexNode *
+components_index_rotate_right (ComponentsIndexNode *node)
+{
+	ComponentsIndexNode *left = node->left;
+
+	node->left = left->right;
+	left->right = node;
+
+	components_index_node_update (node);
+	components_index_node_update (left);
+
+	return left;
+}
+
+static ComponentsIndexNode *
+components_index_rotate_left (ComponentsIndexNode *node)
+{
+	ComponentsIndexNode *right = node->right;
+
+	node->right = right->left;
+	right->left = node;
+
+	components_index_node_update (node);
+	components_index_node_update (right);
+
+	return right;
+}
+
+static ComponentsIndexNode *
+components_index_insert_node (ComponentsIndexNode *node,
+			      ComponentsIndexNode *new_node)
+{
+	if (!node)
+		return new_node;
+
+	if (components_index_compare (new_node->comp_data, node->comp_data) < 0) {
+		node->left = components_index_insert_node (node->left, new_node);
+		if (node->left->priority > node->priority)
+			return components_index_rotate_right (node);
+	} else {
+		node->right = components_index_insert_node (node->right, new_node);
+		if (node->right->priority > node->priority)
+			return components_index_rotate_left (node);
+	}
+
+	components_index_node_update (node);
+
+	return node;
+}
+
+static ComponentsIndexNode *
+components_index_remove_node (ComponentsIndexNode *node,
+			      const ComponentData *comp_data)
+{
+	gint cmp;
+
+	if (!node)
+		return NULL;
+
+	cmp = components_index_compare (comp_data, node->comp_data);
+
+	if (cmp < 0) {
+		node->left = components_index_remove_node (node->left, comp_data);
+	} else if (cmp > 0) {
+		node->right = components_index_remove_node (node->right, comp_data);
+	} else if (!node->left || !node->right) {
+		ComponentsIndexNode *child = node->left ? node->left : node->right;
+
+		g_slice_free (ComponentsIndexNode, node);
+
+		return child;
+	} else if (node->left->priority > node->right->priority) {
+		node = components_index_rotate_right (node);
+		node->right = components_index_remove_node (node->right, comp_data);
+	} else {
+		node = components_index_rotate_left (node);
+		node->left = components_index_remove_node (node->left, comp_data);
+	}
+
+	components_index_node_update (node);
+
+	return node;
+}
+
+static void
+components_index_free_nodes (ComponentsIndexNode *node)
+{
+	while (node) {
+		ComponentsIndexNode *right = node->right;
+
+		components_index_free_nodes (node->left);
+
+		node->comp_data->index = NULL;
+		g_slice_free (ComponentsIndexNode, node);
+
+		node = right;
+	}
+}
+
+static ComponentsIndex *
+components_index_new (void)
+{
+	return g_slice_new0 (ComponentsIndex);
+}
+
+/* The components are left in their hash table, only unlinked from the index */
+static void
+components_index_free (ComponentsIndex *index)
+{
+	if (index) {
+		components_index_free_nodes (index->root);
+		g_slice_free (ComponentsIndex, index);
+	}
+}
+
+static void
+components_index_add (ComponentsIndex *index,
+		      const ECalComponentId *id,
+		      ComponentData *comp_data)
+{
+	ComponentsIndexNode *node;
+
+	g_return_if_fail (index != NULL);
+	g_return_if_fail (comp_data != NULL);
+	g_return_if_fail (comp_data->index == NULL);
+
+	node = g_slice_new0 (ComponentsIndexNode);
+	node->id = id;
+	node->comp_data = comp_data;
+	node->max_end = comp_data->instance_end;
+	node->priority = g_random_int ();
+
+	index->root = components_index_insert_node (index->root, node);
+	comp_data->index = index;
+}
+
+static void
+components_index_remove (ComponentsIndex *index,
+			 ComponentData *comp_data)
+{
+	g_return_if_fail (index != NULL);
+	g_return_if_fail (comp_data != NULL);
+	g_return_if_fail (comp_data->index == index);
+
+	index->root = components_index_remove_node (index->root, comp_data);
+	comp_data->index = NULL;
+}
+
+typedef struct _ComponentsIndexForeachData {
+	ECalDataModel *data_model;
+	ECalClient *client;
+	time_t in_range_start;
+	time_t in_range_end;
+	gboolean everything;
+	ECalDataModelForeachFunc func;
+	gpointer user_data;
+} ComponentsIndexForeachData;
+
+/* Returns FALSE when the func asked to stop */
+static gboolean
+components_index_foreach_node (ComponentsIndexNode *node,
+			       ComponentsIndexForeachData *fd)
+{
+	while (node) {
+		ComponentData *comp_data = node->comp_data;
+
+		/* Nothing in this subtree ends after the range start */
+		if (!fd->everything && node->max_end < fd->in_range_start)
+			break;
+
+		if (!components_index_foreach_node (node->left, fd))
+			return FALSE;
+
+		if (fd->everything ||
+		    (comp_data->instance_start < fd->in_range_end && comp_data->instance_end > fd->in_range_start) ||
+		    (comp_data->instance_start == comp_data->instance_end && comp_data->instance_end == fd->in_range_start)) {
+			if (!fd->func (fd->data_model, fd->client, node->id, comp_data->component,
+				       comp_data->instance_start, comp_data->instance_end, fd->user_data))
+				return FALSE;
+		}
+
+		/* The right subtree starts at or after this node */
+		if (!fd->everything &&
+		    comp_data->instance_start >= fd->in_range_end &&
+		    comp_data->instance_start > fd->in_range_start)
+			break;
+
+		node = node->right;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+components_index_foreach_in_range (ComponentsIndex *index,
+				   ECalDataModel *data_model,
+				   ECalClient *client,
+				   time_t in_range_start,
+				   time_t in_range_end,
+				   ECalDataModelForeachFunc func,
+				   gpointer user_data)
+{
+	ComponentsIndexForeachData fd;
+
+	g_return_val_if_fail (index != NULL, FALSE);
+	g_return_val_if_fail (func != NULL, FALSE);
+
+	fd.data_model = data_model;
+	fd.client = client;
+	fd.in_range_start = in_range_start;
+	fd.in_range_end = in_range_end;
+	fd.everything = in_range_start == in_range_end && in_range_start == (time_t) 0;
+	fd.func = func;
+	fd.user_data = user_data;
+
+	return components_index_foreach_node (index->root, &fd);
+}
+
 static ComponentData *
 component_data_new (ECalComponent *comp,
 		    time_t instance_start,
@@ -129,6 +418,8 @@ component_data_free (gpointer ptr)
 	ComponentData *comp_data = ptr;
 
 	if (comp_data) {
+		if (comp_data->index)
+			components_index_remove (comp_data->index, comp_data);
 		g_object_unref (comp_data->component);
 		g_free (comp_data);
 	}
@@ -203,6 +494,7 @@ view_data_new (ECalClient *client)
 	view_data->components = g_hash_table_new_full (
 		(GHashFunc) e_cal_component_id_hash, (GEqualFunc) e_cal_component_id_equal,
 		(GDestroyNotify) e_cal_component_free_id, component_data_free);
+	view_data->components_index = components_index_new ();
 
 	return view_data;
 }
@@ -251,7 +543,9 @@ view_data_unref (gpointer ptr)
 			g_clear_object (&view_data->cancellable);
 			g_clear_object (&view_data->client);
 			g_clear_object (&view_data->view);
+			components_index_free (view_data->components_index);
 			g_hash_table_destroy (view_data->components);
+			components_index_free (view_data->lost_components_index);
 			if (view_data->lost_components)
 				g_hash_table_destroy (view_data->lost_components);
 			g_slist_free_full (view_data->to_expand_recurrences, (GDestroyNotify) icalcomponent_free);
@@ -295,17 +589,171 @@ subscriber_data_new (ECalDataModelSubscriber *subscriber,
 	return subs_data;
 }
 
+static void
+subscriber_data_free_batch (SubscriberBatchKind batch_kind,
+			    GSList *batch)
+{
+	if (batch_kind == SUBSCRIBER_BATCH_REMOVED)
+		g_slist_free_full (batch, (GDestroyNotify) e_cal_component_free_id);
+	else
+		g_slist_free_full (batch, g_object_unref);
+}
+
 static void
 subscriber_data_free (gpointer ptr)
 {
 	SubscriberData *subs_data = ptr;
 
 	if (subs_data) {
+		/* Undelivered changes are dropped, the same as for unsubscribe */
+		subscriber_data_free_batch (subs_data->batch_kind, subs_data->batch);
+		g_clear_object (&subs_data->batch_client);
 		g_clear_object (&subs_data->subscriber);
 		g_free (subs_data);
 	}
 }
 
+static void
+subscriber_data_flush (SubscriberData *subs_data)
+{
+	ECalDataModelSubscriber *subscriber;
+	SubscriberBatchKind batch_kind;
+	ECalClient *client;
+	GSList *batch;
+
+	g_return_if_fail (subs_data != NULL);
+
+	if (subs_data->batch_kind == SUBSCRIBER_BATCH_NONE)
+		return;
+
+	/* Detach the batch first, the subscriber can unsubscribe
+	   itself or cause new notifications during the delivery */
+	subscriber = g_object_ref (subs_data->subscriber);
+	batch_kind = subs_data->batch_kind;
+	client = subs_data->batch_client;
+	batch = g_slist_reverse (subs_data->batch);
+
+	subs_data->batch_kind = SUBSCRIBER_BATCH_NONE;
+	subs_data->batch_client = NULL;
+	subs_data->batch = NULL;
+
+	switch (batch_kind) {
+	case SUBSCRIBER_BATCH_ADDED:
+		e_cal_data_model_subscriber_components_added (subscriber, client, batch);
+		break;
+	case SUBSCRIBER_BATCH_MODIFIED:
+		e_cal_data_model_subscriber_components_modified (subscriber, client, batch);
+		break;
+	case SUBSCRIBER_BATCH_REMOVED:
+		e_cal_data_model_subscriber_components_removed (subscriber, client, batch);
+		break;
+	case SUBSCRIBER_BATCH_NONE:
+		break;
+	}
+
+	subscriber_data_free_batch (batch_kind, batch);
+	g_clear_object (&client);
+	g_object_unref (subscriber);
+}
+
+/* Returns whether the change should be added to the batch;
+   when FALSE, the subscriber is to be notified immediately. */
+static gboolean
+subscriber_data_prepare_batch (SubscriberData *subs_data,
+			       SubscriberBatchKind batch_kind,
+			       ECalClient *client)
+{
+	g_return_val_if_fail (subs_data != NULL, FALSE);
+
+	if (subs_data->freeze_count <= 0)
+		return FALSE;
+
+	if (subs_data->batch_kind != batch_kind ||
+	    subs_data->batch_client != client)
+		subscriber_data_flush (subs_data);
+
+	if (subs_data->batch_kind == SUBSCRIBER_BATCH_NONE) {
+		subs_data->batch_kind = batch_kind;
+		subs_data->batch_client = client ? g_object_ref (client) : NULL;
+	}
+
+	return TRUE;
+}
+
+static void
+subscriber_data_component_added (SubscriberData *subs_data,
+				 ECalClient *client,
+				 ECalComponent *comp)
+{
+	g_return_if_fail (subs_data != NULL);
+	g_return_if_fail (E_IS_CAL_COMPONENT (comp));
+
+	if (subscriber_data_prepare_batch (subs_data, SUBSCRIBER_BATCH_ADDED, client))
+		subs_data->batch = g_slist_prepend (subs_data->batch, g_object_ref (comp));
+	else
+		e_cal_data_model_subscriber_component_added (subs_data->subscriber, client, comp);
+}
+
+static void
+subscriber_data_component_modified (SubscriberData *subs_data,
+				    ECalClient *client,
+				    ECalComponent *comp)
+{
+	g_return_if_fail (subs_data != NULL);
+	g_return_if_fail (E_IS_CAL_COMPONENT (comp));
+
+	if (subscriber_data_prepare_batch (subs_data, SUBSCRIBER_BATCH_MODIFIED, client))
+		subs_data->batch = g_slist_prepend (subs_data->batch, g_object_ref (comp));
+	else
+		e_cal_data_model_subscriber_component_modified (subs_data->subscriber, client, comp);
+}
+
+static void
+subscriber_data_component_removed (SubscriberData *subs_data,
+				   ECalClient *client,
+				   const ECalComponentId *id)
+{
+	g_return_if_fail (subs_data != NULL);
+	g_return_if_fail (id != NULL);
+
+	if (subscriber_data_prepare_batch (subs_data, SUBSCRIBER_BATCH_REMOVED, client))
+		subs_data->batch = g_slist_prepend (subs_data->batch, e_cal_component_id_copy (id));
+	else
+		e_cal_data_model_subscriber_component_removed (subs_data->subscriber, client, id->uid, id->rid);
+}
+
+static void
+subscriber_data_freeze (SubscriberData *subs_data)
+{
+	g_return_if_fail (subs_data != NULL);
+
+	subs_data->freeze_count++;
+
+	e_cal_data_model_subscriber_freeze (subs_data->subscriber);
+}
+
+static void
+subscriber_data_thaw (SubscriberData *subs_data)
+{
+	ECalDataModelSubscriber *subscriber;
+
+	g_return_if_fail (subs_data != NULL);
+
+	subscriber = g_object_ref (subs_data->subscriber);
+
+	/* The subscriber could be added while the others were frozen */
+	if (subs_data->freeze_count > 0) {
+		subs_data->freeze_count--;
+
+		if (!subs_data->freeze_count)
+			subscriber_data_flush (subs_data);
+	}
+
+	e_cal_data_model_subscriber_thaw (subscriber);
+
+	g_object_unref (subscriber);
+}
+
 typedef struct _ViewStateChangedData {
 	ECalDataModel *data_model;
 	ECalClientView *view;
@@ -534,7 +982,7 @@ e_cal_data_model_submit_thread_job (ECalDataModel *data_model,
 
 typedef void (* ECalDataModelForeachSubscriberFunc) (ECalDataModel *data_model,
 						     ECalClient *client,
-						     ECalDataModelSubscriber *subscriber,
+						     SubscriberData *subs_data,
 						     gpointer user_data);
 
 static void
@@ -561,7 +1009,7 @@ cal_data_model_foreach_subscriber_in_range (ECalDataModel *data_model,
 		if ((in_range_start == (time_t) 0 && in_range_end == (time_t) 0) ||
 		    (subs_data->range_start == (time_t) 0 && subs_data->range_end == (time_t) 0) ||
 		    (subs_data->range_start <= in_range_end && subs_data->range_end >= in_range_start))
-			func (data_model, client, subs_data->subscriber, user_data);
+			func (data_model, client, subs_data, user_data);
 	}
 
 	UNLOCK_PROPS ();
@@ -581,19 +1029,19 @@ cal_data_model_foreach_subscriber (ECalDataModel *data_model,
 static void
 cal_data_model_freeze_subscriber_cb (ECalDataModel *data_model,
 				     ECalClient *client,
-				     ECalDataModelSubscriber *subscriber,
+				     SubscriberData *subs_data,
 				     gpointer user_data)
 {
-	e_cal_data_model_subscriber_freeze (subscriber);
+	subscriber_data_freeze (subs_data);
 }
 
 static void
 cal_data_model_thaw_subscriber_cb (ECalDataModel *data_model,
 				   ECalClient *client,
-				   ECalDataModelSubscriber *subscriber,
+				   SubscriberData *subs_data,
 				   gpointer user_data)
 {
-	e_cal_data_model_subscriber_thaw (subscriber);
+	subscriber_data_thaw (subs_data);
 }
 
 static void
@@ -611,53 +1059,53 @@ cal_data_model_thaw_all_subscribers (ECalDataModel *data_model)
 static void
 cal_data_model_gather_subscribers_cb (ECalDataModel *data_model,
 				      ECalClient *client,
-				      ECalDataModelSubscriber *subscriber,
+				      SubscriberData *subs_data,
 				      gpointer user_data)
 {
 	GHashTable *subscribers = user_data;
 
 	g_return_if_fail (subscribers != NULL);
 
-	g_hash_table_insert (subscribers, g_object_ref (subscriber), NULL);
+	g_hash_table_insert (subscribers, subs_data, NULL);
 }
 
 static void
 cal_data_model_add_component_cb (ECalDataModel *data_model,
 				 ECalClient *client,
-				 ECalDataModelSubscriber *subscriber,
+				 SubscriberData *subs_data,
 				 gpointer user_data)
 {
 	ECalComponent *comp = user_data;
 
 	g_return_if_fail (comp != NULL);
 
-	e_cal_data_model_subscriber_component_added (subscriber, client, comp);
+	subscriber_data_component_added (subs_data, client, comp);
 }
 
 static void
 cal_data_model_modify_component_cb (ECalDataModel *data_model,
 				    ECalClient *client,
-				    ECalDataModelSubscriber *subscriber,
+				    SubscriberData *subs_data,
 				    gpointer user_data)
 {
 	ECalComponent *comp = user_data;
 
 	g_return_if_fail (comp != NULL);
 
-	e_cal_data_model_subscriber_component_modified (subscriber, client, comp);
+	subscriber_data_component_modified (subs_data, client, comp);
 }
 
 static void
 cal_data_model_remove_one_view_component_cb (ECalDataModel *data_model,
 					     ECalClient *client,
-					     ECalDataModelSubscriber *subscriber,
+					     SubscriberData *subs_data,
 					     gpointer user_data)
 {
 	const ECalComponentId *id = user_data;
 
 	g_return_if_fail (id != NULL);
 
-	e_cal_data_model_subscriber_component_removed (subscriber, client, id->uid, id->rid);
+	subscriber_data_component_removed (subs_data, client, id);
 }
 
 static void
@@ -854,8 +1302,10 @@ cal_data_model_process_added_component (ECalDataModel *data_model,
 
 	/* Note: old_comp_data is freed or NULL now */
 
-	/* 'id' is stolen by view_data->components */
-	g_hash_table_insert (view_data->components, id, comp_data);
+	/* 'id' is stolen by view_data->components; replace it, not insert,
+	   because the index references the key of the hash table */
+	g_hash_table_replace (view_data->components, id, comp_data);
+	components_index_add (view_data->components_index, id, comp_data);
 
 	if (!comp_data_equal) {
 		if (!old_comp_data) {
@@ -870,8 +1320,11 @@ cal_data_model_process_added_component (ECalDataModel *data_model,
 			GHashTableIter iter;
 			gpointer key;
 
-			old_subscribers = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
-			new_subscribers = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
+			/* The SubscriberData pointers are valid as long as the props lock is held */
+			LOCK_PROPS ();
+
+			old_subscribers = g_hash_table_new (g_direct_hash, g_direct_equal);
+			new_subscribers = g_hash_table_new (g_direct_hash, g_direct_equal);
 
 			cal_data_model_foreach_subscriber_in_range (data_model, view_data->client,
 				old_instance_start, old_instance_end,
@@ -883,26 +1336,28 @@ cal_data_model_process_added_component (ECalDataModel *data_model,
 
 			g_hash_table_iter_init (&iter, old_subscribers);
 			while (g_hash_table_iter_next (&iter, &key, NULL)) {
-				ECalDataModelSubscriber *subscriber = key;
+				SubscriberData *subs_data = key;
 
 				/* If in both hashes, then the subscriber can be notified with 'modified',
 				   otherwise the component had been 'removed' for it. */
-				if (g_hash_table_remove (new_subscribers, subscriber))
-					e_cal_data_model_subscriber_component_modified (subscriber, view_data->client, comp_data->component);
+				if (g_hash_table_remove (new_subscribers, subs_data))
+					subscriber_data_component_modified (subs_data, view_data->client, comp_data->component);
 				else if (old_id)
-					e_cal_data_model_subscriber_component_removed (subscriber, view_data->client, old_id->uid, old_id->rid);
+					subscriber_data_component_removed (subs_data, view_data->client, old_id);
 			}
 
 			/* Those which left in the new_subscribers have the component added. */
 			g_hash_table_iter_init (&iter, new_subscribers);
 			while (g_hash_table_iter_next (&iter, &key, NULL)) {
-				ECalDataModelSubscriber *subscriber = key;
+				SubscriberData *subs_data = key;
 
-				e_cal_data_model_subscriber_component_added (subscriber, view_data->client, comp_data->component);
+				subscriber_data_component_added (subs_data, view_data->client, comp_data->component);
 			}
 
 			g_hash_table_destroy (old_subscribers);
 			g_hash_table_destroy (new_subscribers);
+
+			UNLOCK_PROPS ();
 		} else {
 			cal_data_model_foreach_subscriber_in_range (data_model, view_data->client,
 				comp_data->instance_start, comp_data->instance_end,
@@ -1045,6 +1500,8 @@ cal_data_model_notify_recurrences_cb (gpointer user_data)
 		if (g_atomic_int_dec_and_test (&view_data->pending_expand_recurrences) &&
 		    view_data->is_used && view_data->lost_components && view_data->received_complete) {
 			cal_data_model_remove_components (data_model, view_data->client, view_data->lost_components, NULL);
+			components_index_free (view_data->lost_components_index);
+			view_data->lost_components_index = NULL;
 			g_hash_table_destroy (view_data->lost_components);
 			view_data->lost_components = NULL;
 		}
@@ -1071,6 +1528,7 @@ cal_data_model_notify_recurrences_cb (gpointer user_data)
 typedef struct
 {
 	ECalClient *client;
+	ViewData *view_data;
 	icaltimezone *zone;
 	GSList **pexpanded_recurrences;
 	gboolean skip_cancelled;
@@ -1090,6 +1548,10 @@ cal_data_model_instance_generated (ECalComponent *comp,
 
 	g_return_val_if_fail (gid != NULL, FALSE);
 
+	/* Stop the expansion, the result will not be used anyway */
+	if (!gid->view_data->is_used)
+		return FALSE;
+
 	e_cal_component_get_status (comp, &status);
 	if (gid->skip_cancelled && status == ICAL_STATUS_CANCELLED)
 		return TRUE;
@@ -1129,14 +1591,45 @@ cal_data_model_instance_generated (ECalComponent *comp,
 	return TRUE;
 }
 
+/* Passes the expanded_recurrences to the main thread. The last call of each
+   expand job consumes the pending_expand_recurrences of the job, the calls
+   in between increment it for their own notification. */
+static void
+cal_data_model_deliver_expanded_recurrences (ECalDataModel *data_model,
+					     ViewData *view_data,
+					     ECalClient *client,
+					     GSList *expanded_recurrences,
+					     gboolean is_last)
+{
+	view_data_lock (view_data);
+
+	if (expanded_recurrences)
+		view_data->expanded_recurrences = g_slist_concat (view_data->expanded_recurrences, expanded_recurrences);
+
+	if (view_data->is_used) {
+		NotifyRecurrencesData *notif_data;
+
+		if (!is_last)
+			g_atomic_int_inc (&view_data->pending_expand_recurrences);
+
+		notif_data = g_new0 (NotifyRecurrencesData, 1);
+		notif_data->data_model = g_object_ref (data_model);
+		notif_data->client = g_object_ref (client);
+
+		g_timeout_add (1, cal_data_model_notify_recurrences_cb, notif_data);
+	}
+
+	view_data_unlock (view_data);
+}
+
 static void
 cal_data_model_expand_recurrences_thread (ECalDataModel *data_model,
 					  gpointer user_data)
 {
 	ECalClient *client = user_data;
-	GSList *to_expand_recurrences, *link;
 	GSList *expanded_recurrences = NULL;
 	time_t range_start, range_end;
+	gint64 last_notify;
 	ViewData *view_data;
 
 	g_return_if_fail (E_IS_CAL_DATA_MODEL (data_model));
@@ -1166,43 +1659,55 @@ cal_data_model_expand_recurrences_thread (ECalDataModel *data_model,
 		return;
 	}
 
-	to_expand_recurrences = view_data->to_expand_recurrences;
-	view_data->to_expand_recurrences = NULL;
-
 	view_data_unlock (view_data);
 
-	for (link = to_expand_recurrences; link && view_data->is_used; link = g_slist_next (link)) {
-		icalcomponent *icomp = link->data;
+	last_notify = g_get_monotonic_time ();
+
+	while (view_data->is_used && !e_cal_data_model_get_disposing (data_model)) {
 		GenerateInstancesData gid;
+		icalcomponent *icomp;
+		GSList *link;
+
+		/* Other jobs can take from the same list */
+		view_data_lock (view_data);
+		link = view_data->to_expand_recurrences;
+		if (link)
+			view_data->to_expand_recurrences = g_slist_remove_link (view_data->to_expand_recurrences, link);
+		view_data_unlock (view_data);
+
+		if (!link)
+			break;
+
+		icomp = link->data;
+		g_slist_free_1 (link);
 
 		if (!icomp)
 			continue;
 
 		gid.client = client;
+		gid.view_data = view_data;
 		gid.pexpanded_recurrences = &expanded_recurrences;
 		gid.zone = data_model->priv->zone;
 		gid.skip_cancelled = data_model->priv->skip_cancelled;
 
 		e_cal_client_generate_instances_for_object_sync (client, icomp, range_start, range_end,
 			cal_data_model_instance_generated, &gid);
-	}
-
-	g_slist_free_full (to_expand_recurrences, (GDestroyNotify) icalcomponent_free);
-
-	view_data_lock (view_data);
-	if (expanded_recurrences)
-		view_data->expanded_recurrences = g_slist_concat (view_data->expanded_recurrences, expanded_recurrences);
-	if (view_data->is_used) {
-		NotifyRecurrencesData *notif_data;
 
-		notif_data = g_new0 (NotifyRecurrencesData, 1);
-		notif_data->data_model = g_object_ref (data_model);
-		notif_data->client = g_object_ref (client);
+		icalcomponent_free (icomp);
 
-		g_timeout_add (1, cal_data_model_notify_recurrences_cb, notif_data);
+		/* Let the subscribers show what is known so far, instead of waiting
+		   for all the components. All instances of one component are always
+		   delivered together, the notification relies on it. */
+		if (expanded_recurrences &&
+		    g_get_monotonic_time () - last_notify >= EXPAND_RECURRENCES_NOTIFY_INTERVAL) {
+			cal_data_model_deliver_expanded_recurrences (data_model, view_data, client, expanded_recurrences, FALSE);
+			expanded_recurrences = NULL;
+			last_notify = g_get_monotonic_time ();
+		}
 	}
 
-	view_data_unlock (view_data);
+	cal_data_model_deliver_expanded_recurrences (data_model, view_data, client, expanded_recurrences, TRUE);
+
 	view_data_unref (view_data);
 	g_object_unref (client);
 }
@@ -1251,6 +1756,8 @@ cal_data_model_process_modified_or_added_objects (ECalClientView *view,
 			   because there is no hope for a merge. */
 			if (view_data->lost_components) {
 				cal_data_model_remove_components (data_model, client, view_data->lost_components, NULL);
+				components_index_free (view_data->lost_components_index);
+				view_data->lost_components_index = NULL;
 				g_hash_table_destroy (view_data->lost_components);
 				view_data->lost_components = NULL;
 			}
@@ -1302,14 +1809,24 @@ cal_data_model_process_modified_or_added_objects (ECalClientView *view,
 		cal_data_model_thaw_all_subscribers (data_model);
 
 		if (to_expand_recurrences) {
+			guint n_jobs;
+
+			n_jobs = 1 + g_slist_length (to_expand_recurrences) / EXPAND_RECURRENCES_PER_JOB;
+			n_jobs = MIN (n_jobs, EXPAND_RECURRENCES_MAX_JOBS);
+
 			view_data_lock (view_data);
 			view_data->to_expand_recurrences = g_slist_concat (
-				view_data->to_expand_recurrences, to_expand_recurrences);
-			g_atomic_int_inc (&view_data->pending_expand_recurrences);
+				view_data->to_expand_recurrences, g_slist_reverse (to_expand_recurrences));
 			view_data_unlock (view_data);
 
-			cal_data_model_submit_internal_thread_job (data_model,
-				cal_data_model_expand_recurrences_thread, g_object_ref (client));
+			while (n_jobs > 0) {
+				n_jobs--;
+
+				g_atomic_int_inc (&view_data->pending_expand_recurrences);
+
+				cal_data_model_submit_internal_thread_job (data_model,
+					cal_data_model_expand_recurrences_thread, g_object_ref (client));
+			}
 		}
 	}
 
@@ -1494,6 +2011,8 @@ cal_data_model_view_complete (ECalClientView *view,
 	    view_data->lost_components &&
 	    !view_data->pending_expand_recurrences) {
 		cal_data_model_remove_components (data_model, view_data->client, view_data->lost_components, NULL);
+		components_index_free (view_data->lost_components_index);
+		view_data->lost_components_index = NULL;
 		g_hash_table_destroy (view_data->lost_components);
 		view_data->lost_components = NULL;
 	}
@@ -1667,6 +2186,8 @@ cal_data_model_update_client_view (ECalDataModel *data_model,
 			g_hash_table_foreach (view_data->lost_components,
 				cal_data_model_notify_remove_components_cb, &nrc_data);
 
+			components_index_free (view_data->lost_components_index);
+			view_data->lost_components_index = NULL;
 			g_hash_table_destroy (view_data->lost_components);
 			view_data->lost_components = NULL;
 		}
@@ -1684,14 +2205,18 @@ cal_data_model_update_client_view (ECalDataModel *data_model,
 				cal_data_model_notify_remove_components_cb, &nrc_data);
 			cal_data_model_thaw_all_subscribers (data_model);
 
+			components_index_free (view_data->lost_components_index);
+			view_data->lost_components_index = NULL;
 			g_hash_table_destroy (view_data->lost_components);
 			view_data->lost_components = NULL;
 		}
 
 		view_data->lost_components = view_data->components;
+		view_data->lost_components_index = view_data->components_index;
 		view_data->components = g_hash_table_new_full (
 			(GHashFunc) e_cal_component_id_hash, (GEqualFunc) e_cal_component_id_equal,
 			(GDestroyNotify) e_cal_component_free_id, component_data_free);
+		view_data->components_index = components_index_new ();
 	}
 
 	view_data_unlock (view_data);
@@ -1789,12 +2314,12 @@ cal_data_model_add_to_subscriber (ECalDataModel *data_model,
 				  time_t instance_end,
 				  gpointer user_data)
 {
-	ECalDataModelSubscriber *subscriber = user_data;
+	SubscriberData *subs_data = user_data;
 
-	g_return_val_if_fail (subscriber != NULL, FALSE);
+	g_return_val_if_fail (subs_data != NULL, FALSE);
 	g_return_val_if_fail (id != NULL, FALSE);
 
-	e_cal_data_model_subscriber_component_added (subscriber, client, component);
+	subscriber_data_component_added (subs_data, client, component);
 
 	return TRUE;
 }
@@ -1818,7 +2343,7 @@ cal_data_model_add_to_subscriber_except_its_range (ECalDataModel *data_model,
 	   time range will be added */
 	if (!(instance_start <= subs_data->range_end &&
 	    instance_end >= subs_data->range_start))
-		e_cal_data_model_subscriber_component_added (subs_data->subscriber, client, component);
+		subscriber_data_component_added (subs_data, client, component);
 
 	return TRUE;
 }
@@ -1842,7 +2367,7 @@ cal_data_model_remove_from_subscriber_except_its_range (ECalDataModel *data_mode
 	   time range will be removed */
 	if (!(instance_start <= subs_data->range_end &&
 	    instance_end >= subs_data->range_start))
-		e_cal_data_model_subscriber_component_removed (subs_data->subscriber, client, id->uid, id->rid);
+		subscriber_data_component_removed (subs_data, client, id);
 
 	return TRUE;
 }
@@ -2675,47 +3200,18 @@ cal_data_model_foreach_component (ECalDataModel *data_model,
 	g_hash_table_iter_init (&viter, data_model->priv->views);
 	while (checked_all && g_hash_table_iter_next (&viter, &key, &value)) {
 		ViewData *view_data = value;
-		GHashTableIter citer;
 
 		if (!view_data)
 			continue;
 
 		view_data_lock (view_data);
 
-		g_hash_table_iter_init (&citer, view_data->components);
-		while (checked_all && g_hash_table_iter_next (&citer, &key, &value)) {
-			ECalComponentId *id = key;
-			ComponentData *comp_data = value;
-
-			if (!comp_data)
-				continue;
-
-			if ((in_range_start == in_range_end && in_range_start == (time_t) 0) ||
-			    (comp_data->instance_start < in_range_end && comp_data->instance_end > in_range_start) ||
-			    (comp_data->instance_start == comp_data->instance_end && comp_data->instance_end == in_range_start)) {
-				if (!func (data_model, view_data->client, id, comp_data->component,
-					   comp_data->instance_start, comp_data->instance_end, user_data))
-					checked_all = FALSE;
-			}
-		}
-
-		if (include_lost_components && view_data->lost_components) {
-			g_hash_table_iter_init (&citer, view_data->lost_components);
-			while (checked_all && g_hash_table_iter_next (&citer, &key, &value)) {
-				ECalComponentId *id = key;
-				ComponentData *comp_data = value;
+		checked_all = components_index_foreach_in_range (view_data->components_index,
+			data_model, view_data->client, in_range_start, in_range_end, func, user_data);
 
-				if (!comp_data)
-					continue;
-
-				if ((in_range_start == in_range_end && in_range_start == (time_t) 0) ||
-				    (comp_data->instance_start < in_range_end && comp_data->instance_end > in_range_start) ||
-				    (comp_data->instance_start == comp_data->instance_end && comp_data->instance_end == in_range_start)) {
-					if (!func (data_model, view_data->client, id, comp_data->component,
-						   comp_data->instance_start, comp_data->instance_end, user_data))
-						checked_all = FALSE;
-				}
-			}
+		if (checked_all && include_lost_components && view_data->lost_components_index) {
+			checked_all = components_index_foreach_in_range (view_data->lost_components_index,
+				data_model, view_data->client, in_range_start, in_range_end, func, user_data);
 		}
 
 		view_data_unlock (view_data);
@@ -2832,13 +3328,13 @@ e_cal_data_model_subscribe (ECalDataModel *data_model,
 
 		if (new_range_start == (time_t) 0 && new_range_end == (time_t) 0) {
 			/* The subscriber is looking for everything and the data_model has everything too */
-			e_cal_data_model_subscriber_freeze (subs_data->subscriber);
+			subscriber_data_freeze (subs_data);
 			cal_data_model_foreach_component (data_model,
 				new_range_start, old_range_start,
 				cal_data_model_add_to_subscriber_except_its_range, subs_data, TRUE);
-			e_cal_data_model_subscriber_thaw (subs_data->subscriber);
+			subscriber_data_thaw (subs_data);
 		} else {
-			e_cal_data_model_subscriber_freeze (subs_data->subscriber);
+			subscriber_data_freeze (subs_data);
 
 			if (new_range_start >= old_range_end ||
 			    new_range_end <= old_range_start) {
@@ -2896,7 +3392,7 @@ e_cal_data_model_subscribe (ECalDataModel *data_model,
 				}
 			}
 
-			e_cal_data_model_subscriber_thaw (subs_data->subscriber);
+			subscriber_data_thaw (subs_data);
 		}
 
 		subs_data->range_start = range_start;
@@ -2906,10 +3402,10 @@ e_cal_data_model_subscribe (ECalDataModel *data_model,
 
 		data_model->priv->subscribers = g_slist_prepend (data_model->priv->subscribers, subs_data);
 
-		e_cal_data_model_subscriber_freeze (subscriber);
+		subscriber_data_freeze (subs_data);
 		cal_data_model_foreach_component (data_model, range_start, range_end,
-			cal_data_model_add_to_subscriber, subscriber, TRUE);
-		e_cal_data_model_subscriber_thaw (subscriber);
+			cal_data_model_add_to_subscriber, subs_data, TRUE);
+		subscriber_data_thaw (subs_data);
 	}
 
 	cal_data_model_update_time_range (data_model);
@@ -2029,6 +2029,97 @@ e_cal_model_data_subscriber_component_modified (ECalDataModelSubscriber *subscri
 	cal_model_data_subscriber_component_added_or_modified (subscriber, client, comp, FALSE);
 }
 
+static void
+e_cal_model_data_subscriber_components_added (ECalDataModelSubscriber *subscriber,
+					      ECalClient *client,
+					      const GSList *components)
+{
+	ECalModel *model;
+	ETableModel *table_model;
+	GSList *new_components = NULL, *link;
+	GHashTable *new_ids; /* gchar *uid-and-rid ~> GSList *link in the new_components */
+	gboolean client_known = FALSE;
+	guint ii, first_new_row;
+
+	model = E_CAL_MODEL (subscriber);
+	table_model = E_TABLE_MODEL (model);
+
+	/* Components of a client with no component in the model yet cannot
+	   be known, which avoids the linear index lookup for each of them,
+	   like when a calendar is being populated for the first time. */
+	for (ii = 0; ii < model->priv->objects->len && !client_known; ii++) {
+		ECalModelComponent *comp_data = g_ptr_array_index (model->priv->objects, ii);
+
+		client_known = comp_data && comp_data->client == client;
+	}
+
+	new_ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	for (link = (GSList *) components; link; link = g_slist_next (link)) {
+		ECalComponent *comp = link->data;
+		ECalComponentId *id;
+		GSList *new_link;
+		gchar *key;
+
+		id = e_cal_component_get_id (comp);
+
+		if (client_known) {
+			gint index;
+
+			index = e_cal_model_get_component_index (model, client, id);
+
+			if (index >= 0) {
+				e_cal_component_free_id (id);
+				cal_model_data_subscriber_component_added_or_modified (subscriber, client, comp, FALSE);
+				continue;
+			}
+		}
+
+		key = g_strconcat (id && id->uid ? id->uid : "", "\n", id && id->rid ? id->rid : "", NULL);
+		e_cal_component_free_id (id);
+
+		/* The same component can be in the batch more than once; it is
+		   added only once, with the last data, as if the later ones
+		   modified it. */
+		new_link = g_hash_table_lookup (new_ids, key);
+		if (new_link) {
+			new_link->data = comp;
+			g_free (key);
+			continue;
+		}
+
+		new_components = g_slist_prepend (new_components, comp);
+		g_hash_table_insert (new_ids, key, new_components);
+	}
+
+	g_hash_table_destroy (new_ids);
+
+	if (!new_components)
+		return;
+
+	new_components = g_slist_reverse (new_components);
+
+	e_table_model_pre_change (table_model);
+
+	first_new_row = model->priv->objects->len;
+
+	for (link = new_components; link; link = g_slist_next (link)) {
+		ECalComponent *comp = link->data;
+		ECalModelComponent *comp_data;
+
+		comp_data = g_object_new (E_TYPE_CAL_MODEL_COMPONENT, NULL);
+		comp_data->is_new_component = FALSE;
+		comp_data->client = g_object_ref (client);
+		comp_data->icalcomp = icalcomponent_new_clone (e_cal_component_get_icalcomponent (comp));
+		e_cal_model_set_instance_times (comp_data, model->priv->zone);
+		g_ptr_array_add (model->priv->objects, comp_data);
+	}
+
+	e_table_model_rows_inserted (table_model, first_new_row, model->priv->objects->len - first_new_row);
+
+	g_slist_free (new_components);
+}
+
 static void
 e_cal_model_data_subscriber_component_removed (ECalDataModelSubscriber *subscriber,
 					       ECalClient *client,
@@ -2618,6 +2709,7 @@ e_cal_model_cal_data_model_subscriber_init (ECalDataModelSubscriberInterface *if
 	iface->component_removed = e_cal_model_data_subscriber_component_removed;
 	iface->freeze = e_cal_model_data_subscriber_freeze;
 	iface->thaw = e_cal_model_data_subscriber_thaw;
+	iface->components_added = e_cal_model_data_subscriber_components_added;
 }
 
 static void
@@ -153,21 +153,10 @@ static const gchar *
 get_cache_str (gpointer cmp_cache,
                const gchar *str)
 {
-	const gchar *value;
-
 	if (!cmp_cache || !str)
 		return str;
 
-	value = e_table_sorting_utils_lookup_cmp_cache (cmp_cache, str);
-	if (!value) {
-		gchar *ckey;
-
-		ckey = g_utf8_collate_key (str, -1);
-		e_table_sorting_utils_add_to_cmp_cache (cmp_cache, (gchar *) str, ckey);
-		value = ckey;
-	}
-
-	return value;
+	return e_table_sorting_utils_get_collate_key (cmp_cache, str, FALSE);
 }
 
 static gboolean
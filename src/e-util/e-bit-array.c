@@ -22,6 +22,8 @@
 
 #include "evolution-config.h"
 
+#include <string.h>
+
 #include <gtk/gtk.h>
 
 #include "e-bit-array.h"
@@ -34,132 +36,352 @@
 #define BITMASK_LEFT(n) ((((n) % 32) == 0) ? 0 : (ONES << (32 - ((n) % 32))))
 #define BITMASK_RIGHT(n) ((guint32)(((guint32) ONES) >> ((n) % 32)))
 
+#define N_WORDS(bits) (((bits) + 31) / 32)
+
+/* One run of selected rows, with the 'end' not included */
+typedef struct _ERange {
+	gint start;
+	gint end;
+} ERange;
+
+#define RANGE(ranges, i) (g_array_index ((ranges), ERange, (i)))
+
 G_DEFINE_TYPE (
 	EBitArray,
 	e_bit_array,
 	G_TYPE_OBJECT)
 
+static gint
+bit_array_popcount (guint32 value)
+{
+#if defined (__GNUC__)
+	return __builtin_popcount (value);
+#else
+	value = value - ((value >> 1) & 0x55555555);
+	value = (value & 0x33333333) + ((value >> 2) & 0x33333333);
+	value = (value + (value >> 4)) & 0x0f0f0f0f;
+
+	return (value * 0x01010101) >> 24;
+#endif
+}
+
+/* Returns the index of the highest set bit, counted from the left */
+static gint
+bit_array_first_set (guint32 value)
+{
+#if defined (__GNUC__)
+	return __builtin_clz (value);
+#else
+	gint n = 0;
+
+	while (!(value & 0x80000000)) {
+		value <<= 1;
+		n++;
+	}
+
+	return n;
+#endif
+}
+
+/* Returns 32 bits starting at bit @pos; the bits past the data are zero */
+static guint32
+bit_array_get_bits (const guint32 *data,
+                    gint n_words,
+                    gint pos)
+{
+	gint box = BOX (pos);
+	gint shift = pos % 32;
+	guint32 value;
+
+	value = data[box] << shift;
+	if (shift && box + 1 < n_words)
+		value |= data[box + 1] >> (32 - shift);
+
+	return value;
+}
+
+/* Copies @n_bits from @src at @src_pos to @dest at @dest_pos, a word at a time.
+ * The destination bits are expected to be zero. */
 static void
-e_bit_array_insert_real (EBitArray *bit_array,
-                         gint row)
+bit_array_copy_bits (guint32 *dest,
+                     gint dest_words,
+                     gint dest_pos,
+                     const guint32 *src,
+                     gint src_words,
+                     gint src_pos,
+                     gint n_bits)
 {
-	gint box;
-	gint i;
-	if (bit_array->bit_count >= 0) {
-		/* Add another word if needed. */
-		if ((bit_array->bit_count & 0x1f) == 0) {
-			bit_array->data = g_renew (
-				guint32, bit_array->data,
-				(bit_array->bit_count >> 5) + 1);
-			bit_array->data[bit_array->bit_count >> 5] = 0;
+	gint ii;
+
+	for (ii = 0; ii < n_bits; ii += 32) {
+		guint32 value;
+		gint box, shift;
+
+		value = bit_array_get_bits (src, src_words, src_pos + ii);
+		if (n_bits - ii < 32)
+			value &= ~BITMASK_RIGHT (n_bits - ii);
+
+		box = BOX (dest_pos + ii);
+		shift = (dest_pos + ii) % 32;
+
+		dest[box] |= value >> shift;
+		if (shift && box + 1 < dest_words)
+			dest[box + 1] |= value << (32 - shift);
+	}
+}
+
+/* Index of the first range, which ends at or after @row */
+static guint
+bit_array_ranges_find (GArray *ranges,
+                       gint row)
+{
+	guint lo = 0, hi = ranges->len;
+
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+
+		if (RANGE (ranges, mid).end < row)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* Selects or unselects rows [start, end), merging touching ranges */
+static void
+bit_array_ranges_set (GArray *ranges,
+                      gint start,
+                      gint end,
+                      gboolean selected)
+{
+	ERange pieces[2];
+	guint first, last;
+	gint n_pieces = 0;
+
+	if (start >= end)
+		return;
+
+	first = bit_array_ranges_find (ranges, start);
+	for (last = first; last < ranges->len && RANGE (ranges, last).start <= end; last++) {
+		/* find the last range touching [start, end) */
+	}
+
+	if (selected) {
+		pieces[0].start = start;
+		pieces[0].end = end;
+
+		if (first < last) {
+			pieces[0].start = MIN (start, RANGE (ranges, first).start);
+			pieces[0].end = MAX (end, RANGE (ranges, last - 1).end);
+		}
+
+		n_pieces = 1;
+	} else if (first < last) {
+		if (RANGE (ranges, first).start < start) {
+			pieces[n_pieces].start = RANGE (ranges, first).start;
+			pieces[n_pieces].end = start;
+			n_pieces++;
 		}
 
-		/* The box is the word that our row is in. */
-		box = BOX (row);
-		/* Shift all words to the right of our box right one bit. */
-		for (i = bit_array->bit_count >> 5; i > box; i--) {
-			bit_array->data[i] =
-				(bit_array->data[i] >> 1) |
-				(bit_array->data[i - 1] << 31);
+		if (RANGE (ranges, last - 1).end > end) {
+			pieces[n_pieces].start = end;
+			pieces[n_pieces].end = RANGE (ranges, last - 1).end;
+			n_pieces++;
 		}
+	}
+
+	if (first < last)
+		g_array_remove_range (ranges, first, last - first);
+
+	if (n_pieces)
+		g_array_insert_vals (ranges, first, pieces, n_pieces);
+}
+
+static gboolean
+bit_array_ranges_intersect (GArray *ranges,
+                            gint start,
+                            gint end)
+{
+	guint idx;
+
+	/* the first range ending after the start */
+	idx = bit_array_ranges_find (ranges, start + 1);
+
+	return idx < ranges->len && RANGE (ranges, idx).start < end;
+}
 
-		/* Shift right half of box one bit to the right. */
-		bit_array->data[box] =
-			(bit_array->data[box] & BITMASK_LEFT (row)) |
-			((bit_array->data[box] & BITMASK_RIGHT (row)) >> 1);
-		bit_array->bit_count++;
+static void
+bit_array_ranges_insert (GArray *ranges,
+                         gint row,
+                         gint count)
+{
+	guint ii;
+
+	for (ii = bit_array_ranges_find (ranges, row); ii < ranges->len; ii++) {
+		ERange *range = &RANGE (ranges, ii);
+
+		if (range->start >= row) {
+			range->start += count;
+			range->end += count;
+		} else if (range->end > row) {
+			/* The new rows are not selected, thus split the range. */
+			ERange tail;
+
+			tail.start = row + count;
+			tail.end = range->end + count;
+			range->end = row;
+
+			g_array_insert_val (ranges, ii + 1, tail);
+			ii++;
+		}
 	}
 }
 
 static void
-e_bit_array_delete_real (EBitArray *bit_array,
+bit_array_ranges_delete (GArray *ranges,
                          gint row,
-                         gboolean move_selection_mode)
+                         gint count)
 {
-	gint box;
-	gint i;
-	gint last;
-	gint selected = FALSE;
+	guint ii, jj;
 
-	if (bit_array->bit_count > 0) {
-		guint32 bitmask;
-		box = row >> 5;
-		last = (bit_array->bit_count - 1) >> 5;
+	#define map_row(_row) ((_row) < row ? (_row) : (_row) < row + count ? row : (_row) - count)
 
-		/* Build bitmasks for the left and right half of the box */
-		bitmask = BITMASK_RIGHT (row) >> 1;
+	for (ii = bit_array_ranges_find (ranges, row), jj = ii; ii < ranges->len; ii++) {
+		ERange range = RANGE (ranges, ii);
+
+		range.start = map_row (range.start);
+		range.end = map_row (range.end);
+
+		if (range.start >= range.end)
+			continue;
+
+		/* Ranges around the deleted rows can touch now. */
+		if (jj > 0 && RANGE (ranges, jj - 1).end >= range.start)
+			RANGE (ranges, jj - 1).end = MAX (RANGE (ranges, jj - 1).end, range.end);
+		else
+			RANGE (ranges, jj++) = range;
+	}
+
+	#undef map_row
+
+	g_array_set_size (ranges, jj);
+}
+
+static void
+bit_array_delete (EBitArray *bit_array,
+                  gint row,
+                  gint count,
+                  gboolean move_selection_mode)
+{
+	gboolean selected = FALSE;
+
+	if (row < 0 || count <= 0 || row >= bit_array->bit_count)
+		return;
+
+	if (row + count > bit_array->bit_count)
+		count = bit_array->bit_count - row;
+
+	if (bit_array->ranges) {
 		if (move_selection_mode)
-			selected = e_bit_array_value_at (bit_array, row);
-		/* Shift right half of box one bit to the left. */
-		bit_array->data[box] =
-			(bit_array->data[box] & BITMASK_LEFT (row)) |
-			((bit_array->data[box] & bitmask) << 1);
-
-		/* Shift all words to the right of our box left one bit. */
-		if (box < last) {
-			bit_array->data[box] &= bit_array->data[box + 1] >> 31;
-
-			for (i = box + 1; i < last; i++) {
-				bit_array->data[i] =
-					(bit_array->data[i] << 1) |
-					(bit_array->data[i + 1] >> 31);
-			}
-			/* this over-runs our memory! */
-			/*bit_array->data[i] = bit_array->data[i] << 1; */
-		}
-		bit_array->bit_count--;
-		/* Remove the last word if not needed. */
-		if ((bit_array->bit_count & 0x1f) == 0) {
-			bit_array->data = g_renew (guint32, bit_array->data, bit_array->bit_count >> 5);
-		}
-		if (move_selection_mode && selected && bit_array->bit_count > 0) {
-			e_bit_array_select_single_row (
-				bit_array, row == bit_array->bit_count ? row - 1 : row);
+			selected = bit_array_ranges_intersect (bit_array->ranges, row, row + count);
+
+		bit_array_ranges_delete (bit_array->ranges, row, count);
+	} else {
+		guint32 *data;
+		gint old_words, new_words;
+
+		old_words = N_WORDS (bit_array->bit_count);
+		new_words = N_WORDS (bit_array->bit_count - count);
+
+		if (move_selection_mode) {
+			gint ii;
+
+			for (ii = row; ii < row + count && !selected; ii++)
+				selected = e_bit_array_value_at (bit_array, ii);
 		}
+
+		/* Move the rows after the deleted ones in one pass, word by word. */
+		data = g_new0 (guint32, new_words);
+		bit_array_copy_bits (data, new_words, 0, bit_array->data, old_words, 0, row);
+		bit_array_copy_bits (
+			data, new_words, row,
+			bit_array->data, old_words, row + count,
+			bit_array->bit_count - row - count);
+
+		g_free (bit_array->data);
+		bit_array->data = data;
+	}
+
+	bit_array->bit_count -= count;
+
+	if (move_selection_mode && selected && bit_array->bit_count > 0) {
+		e_bit_array_select_single_row (
+			bit_array, MIN (row, bit_array->bit_count - 1));
 	}
 }
 
-/* FIXME : Improve efficiency here. */
 void
 e_bit_array_delete (EBitArray *bit_array,
                     gint row,
                     gint count)
 {
-	gint i;
-	for (i = 0; i < count; i++)
-		e_bit_array_delete_real (bit_array, row, FALSE);
+	bit_array_delete (bit_array, row, count, FALSE);
 }
 
-/* FIXME : Improve efficiency here. */
 void
 e_bit_array_delete_single_mode (EBitArray *bit_array,
                                 gint row,
                                 gint count)
 {
-	gint i;
-	for (i = 0; i < count; i++)
-		e_bit_array_delete_real (bit_array, row, TRUE);
+	bit_array_delete (bit_array, row, count, TRUE);
 }
 
-/* FIXME : Improve efficiency here. */
 void
 e_bit_array_insert (EBitArray *bit_array,
                     gint row,
                     gint count)
 {
-	gint i;
-	for (i = 0; i < count; i++)
-		e_bit_array_insert_real (bit_array, row);
+	if (bit_array->bit_count < 0 || count <= 0)
+		return;
+
+	if (row < 0)
+		row = 0;
+	if (row > bit_array->bit_count)
+		row = bit_array->bit_count;
+
+	if (bit_array->ranges) {
+		bit_array_ranges_insert (bit_array->ranges, row, count);
+	} else {
+		guint32 *data;
+		gint old_words, new_words;
+
+		old_words = N_WORDS (bit_array->bit_count);
+		new_words = N_WORDS (bit_array->bit_count + count);
+
+		/* Move the rows after the inserted ones in one pass, word by word. */
+		data = g_new0 (guint32, new_words);
+		bit_array_copy_bits (data, new_words, 0, bit_array->data, old_words, 0, row);
+		bit_array_copy_bits (
+			data, new_words, row + count,
+			bit_array->data, old_words, row,
+			bit_array->bit_count - row);
+
+		g_free (bit_array->data);
+		bit_array->data = data;
+	}
+
+	bit_array->bit_count += count;
 }
 
-/* FIXME: Implement this more efficiently. */
 void
 e_bit_array_move_row (EBitArray *bit_array,
                       gint old_row,
                       gint new_row)
 {
-	e_bit_array_delete_real (bit_array, old_row, FALSE);
-	e_bit_array_insert_real (bit_array, new_row);
+	bit_array_delete (bit_array, old_row, 1, FALSE);
+	e_bit_array_insert (bit_array, new_row, 1);
 }
 
 static void
@@ -171,6 +393,9 @@ bit_array_finalize (GObject *object)
 
 	g_free (bit_array->data);
 
+	if (bit_array->ranges)
+		g_array_unref (bit_array->ranges);
+
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (e_bit_array_parent_class)->finalize (object);
 }
@@ -188,10 +413,19 @@ gboolean
 e_bit_array_value_at (EBitArray *bit_array,
                       gint n)
 {
-	if (bit_array->bit_count < n || bit_array->bit_count == 0)
+	if (n < 0 || n >= bit_array->bit_count)
 		return 0;
-	else
-		return (bit_array->data[BOX (n)] >> OFFSET (n)) & 0x1;
+
+	if (bit_array->ranges) {
+		GArray *ranges = bit_array->ranges;
+		guint idx;
+
+		idx = bit_array_ranges_find (ranges, n + 1);
+
+		return idx < ranges->len && RANGE (ranges, idx).start <= n;
+	}
+
+	return (bit_array->data[BOX (n)] >> OFFSET (n)) & 0x1;
 }
 
 /**
@@ -209,24 +443,36 @@ e_bit_array_foreach (EBitArray *bit_array,
                      gpointer closure)
 {
 	gint i;
-	gint last = (bit_array->bit_count + 31) / 32;
+	gint last;
+
+	if (bit_array->ranges) {
+		guint ii;
+
+		for (ii = 0; ii < bit_array->ranges->len; ii++) {
+			ERange range = RANGE (bit_array->ranges, ii);
+
+			for (i = range.start; i < range.end; i++)
+				callback (i, closure);
+		}
+
+		return;
+	}
+
+	last = N_WORDS (bit_array->bit_count);
+
 	for (i = 0; i < last; i++) {
-		if (bit_array->data[i]) {
-			gint j;
-			guint32 value = bit_array->data[i];
-			for (j = 0; j < 32; j++) {
-				if (value & 0x80000000) {
-					callback (i * 32 + j, closure);
-				}
-				value <<= 1;
-			}
+		guint32 value = bit_array->data[i];
+
+		/* Visit only the set bits, skipping the empty words. */
+		while (value) {
+			gint j = bit_array_first_set (value);
+
+			callback (i * 32 + j, closure);
+			value &= ~(((guint32) 0x80000000) >> j);
 		}
 	}
 }
 
-#define PART(x,n) ((guint32) ((((guint64) x) & (((guint64) 0x01010101) << n)) >> n))
-#define SECTION(x, n) (((x) >> (n * 8)) & 0xff)
-
 /**
  * e_bit_array_selected_count
  * @bit_array: #EBitArray to count
@@ -242,6 +488,17 @@ e_bit_array_selected_count (EBitArray *bit_array)
 	gint i;
 	gint last;
 
+	if (bit_array->ranges) {
+		guint ii;
+
+		count = 0;
+
+		for (ii = 0; ii < bit_array->ranges->len; ii++)
+			count += RANGE (bit_array->ranges, ii).end - RANGE (bit_array->ranges, ii).start;
+
+		return count;
+	}
+
 	if (!bit_array->data)
 		return 0;
 
@@ -249,14 +506,8 @@ e_bit_array_selected_count (EBitArray *bit_array)
 
 	last = BOX (bit_array->bit_count - 1);
 
-	for (i = 0; i <= last; i++) {
-		gint j;
-		guint32 thiscount = 0;
-		for (j = 0; j < 8; j++)
-			thiscount += PART (bit_array->data[i], j);
-		for (j = 0; j < 4; j++)
-			count += SECTION (thiscount, j);
-	}
+	for (i = 0; i <= last; i++)
+		count += bit_array_popcount (bit_array->data[i]);
 
 	return count;
 }
@@ -271,25 +522,26 @@ e_bit_array_selected_count (EBitArray *bit_array)
 void
 e_bit_array_select_all (EBitArray *bit_array)
 {
-	gint i;
+	gint n_words;
 
-	if (!bit_array->data)
-		bit_array->data = g_new0 (guint32, (bit_array->bit_count + 31) / 32);
-
-	for (i = 0; i < (bit_array->bit_count + 31) / 32; i++) {
-		bit_array->data[i] = ONES;
+	if (bit_array->ranges) {
+		g_array_set_size (bit_array->ranges, 0);
+		bit_array_ranges_set (bit_array->ranges, 0, bit_array->bit_count, TRUE);
+		return;
 	}
 
-	/* need to zero out the bits corresponding to the rows not
-	 * selected in the last full 32 bit mask */
-	if (bit_array->bit_count % 32) {
-		gint unselected_mask = 0;
-		gint num_unselected_in_last_byte = 32 - bit_array->bit_count % 32;
+	n_words = N_WORDS (bit_array->bit_count);
 
-		for (i = 0; i < num_unselected_in_last_byte; i++)
-			unselected_mask |= 1 << i;
+	if (!bit_array->data)
+		bit_array->data = g_new0 (guint32, n_words);
 
-		bit_array->data[(bit_array->bit_count + 31) / 32 - 1] &= ~unselected_mask;
+	if (n_words > 0) {
+		memset (bit_array->data, 0xff, n_words * sizeof (guint32));
+
+		/* need to zero out the bits corresponding to the rows not
+		 * selected in the last full 32 bit mask */
+		if (bit_array->bit_count % 32)
+			bit_array->data[n_words - 1] = BITMASK_LEFT (bit_array->bit_count);
 	}
 }
 
@@ -309,6 +561,12 @@ e_bit_array_change_one_row (EBitArray *bit_array,
                             gboolean grow)
 {
 	gint i;
+
+	if (bit_array->ranges) {
+		bit_array_ranges_set (bit_array->ranges, row, row + 1, grow);
+		return;
+	}
+
 	i = BOX (row);
 
 	OPERATE (bit_array, i, ~BITMASK (row), grow);
@@ -321,6 +579,12 @@ e_bit_array_change_range (EBitArray *bit_array,
                           gboolean grow)
 {
 	gint i, last;
+
+	if (bit_array->ranges) {
+		bit_array_ranges_set (bit_array->ranges, start, end, grow);
+		return;
+	}
+
 	if (start != end) {
 		i = BOX (start);
 		last = BOX (end);
@@ -331,13 +595,13 @@ e_bit_array_change_range (EBitArray *bit_array,
 				BITMASK_RIGHT (end), grow);
 		} else {
 			OPERATE (bit_array, i, BITMASK_LEFT (start), grow);
-			if (grow)
-				for (i++; i < last; i++)
-					bit_array->data[i] = ONES;
-			else
-				for (i++; i < last; i++)
-					bit_array->data[i] = 0;
-			OPERATE (bit_array, i, BITMASK_RIGHT (end), grow);
+			i++;
+			if (last > i)
+				memset (bit_array->data + i, grow ? 0xff : 0x00, (last - i) * sizeof (guint32));
+			i = last;
+			/* the 'end' can point just past the data */
+			if (i < N_WORDS (bit_array->bit_count))
+				OPERATE (bit_array, i, BITMASK_RIGHT (end), grow);
 		}
 	}
 }
@@ -347,11 +611,18 @@ e_bit_array_select_single_row (EBitArray *bit_array,
                                gint row)
 {
 	gint i;
-	for (i = 0; i < ((bit_array->bit_count + 31) / 32); i++) {
+
+	if (bit_array->ranges) {
+		g_array_set_size (bit_array->ranges, 0);
+		bit_array_ranges_set (bit_array->ranges, row, row + 1, TRUE);
+		return;
+	}
+
+	for (i = 0; i < N_WORDS (bit_array->bit_count); i++) {
 		if (!((i == BOX (row) && bit_array->data[i] == BITMASK (row)) ||
 		      (i != BOX (row) && bit_array->data[i] == 0))) {
 			g_free (bit_array->data);
-			bit_array->data = g_new0 (guint32, (bit_array->bit_count + 31) / 32);
+			bit_array->data = g_new0 (guint32, N_WORDS (bit_array->bit_count));
 			bit_array->data[BOX (row)] = BITMASK (row);
 
 			break;
@@ -363,16 +634,107 @@ void
 e_bit_array_toggle_single_row (EBitArray *bit_array,
                                gint row)
 {
+	if (bit_array->ranges) {
+		bit_array_ranges_set (
+			bit_array->ranges, row, row + 1,
+			!e_bit_array_value_at (bit_array, row));
+		return;
+	}
+
 	if (bit_array->data[BOX (row)] & BITMASK (row))
 		bit_array->data[BOX (row)] &= ~BITMASK (row);
 	else
 		bit_array->data[BOX (row)] |= BITMASK (row);
 }
 
+/**
+ * e_bit_array_set_use_ranges:
+ * @bit_array: an #EBitArray
+ * @use_ranges: whether to store runs of selected rows
+ *
+ * Switches between storing one bit per row and storing sorted runs of
+ * selected rows. With the runs, selecting all or a range of rows, and
+ * inserting or deleting rows, costs depend on the number of the runs,
+ * not on the number of rows, which is better for large selections made
+ * of a few contiguous blocks. The current selection is preserved.
+ **/
+void
+e_bit_array_set_use_ranges (EBitArray *bit_array,
+                            gboolean use_ranges)
+{
+	g_return_if_fail (E_IS_BIT_ARRAY (bit_array));
+
+	if ((bit_array->ranges != NULL) == (use_ranges != FALSE))
+		return;
+
+	if (use_ranges) {
+		GArray *ranges;
+		gint n_words = N_WORDS (bit_array->bit_count);
+		gint row = 0;
+
+		ranges = g_array_new (FALSE, FALSE, sizeof (ERange));
+
+		/* Collect the runs, skipping the whole empty and full words. */
+		while (row < bit_array->bit_count) {
+			ERange range;
+
+			while (row < bit_array->bit_count && !(row % 32) && !bit_array->data[BOX (row)])
+				row += 32;
+			while (row < bit_array->bit_count && !e_bit_array_value_at (bit_array, row))
+				row++;
+
+			if (row >= bit_array->bit_count)
+				break;
+
+			range.start = row;
+
+			while (row < bit_array->bit_count && !(row % 32) && BOX (row) + 1 < n_words && bit_array->data[BOX (row)] == ONES)
+				row += 32;
+			while (row < bit_array->bit_count && e_bit_array_value_at (bit_array, row))
+				row++;
+
+			range.end = row;
+
+			g_array_append_val (ranges, range);
+		}
+
+		g_free (bit_array->data);
+		bit_array->data = NULL;
+		bit_array->ranges = ranges;
+	} else {
+		GArray *ranges = bit_array->ranges;
+		guint ii;
+
+		bit_array->ranges = NULL;
+		bit_array->data = g_new0 (guint32, N_WORDS (bit_array->bit_count));
+
+		for (ii = 0; ii < ranges->len; ii++)
+			e_bit_array_change_range (bit_array, RANGE (ranges, ii).start, RANGE (ranges, ii).end, TRUE);
+
+		g_array_unref (ranges);
+	}
+}
+
+/**
+ * e_bit_array_get_use_ranges:
+ * @bit_array: an #EBitArray
+ *
+ * Returns: whether the @bit_array stores runs of selected rows,
+ *    instead of one bit per row; see e_bit_array_set_use_ranges()
+ **/
+gboolean
+e_bit_array_get_use_ranges (EBitArray *bit_array)
+{
+	g_return_val_if_fail (E_IS_BIT_ARRAY (bit_array), FALSE);
+
+	return bit_array->ranges != NULL;
+}
+
 static void
 e_bit_array_init (EBitArray *bit_array)
 {
 	bit_array->data = NULL;
+	bit_array->ranges = NULL;
 	bit_array->bit_count = 0;
 }
 
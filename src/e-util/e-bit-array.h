@@ -58,6 +58,10 @@ struct _EBitArray {
 
 	gint bit_count;
 	guint32 *data;
+
+	/* Runs of selected rows, used instead of the 'data'
+	 * when not NULL; see e_bit_array_set_use_ranges() */
+	GArray *ranges;
 };
 
 struct _EBitArrayClass {
@@ -99,6 +103,9 @@ void		e_bit_array_delete_single_mode	(EBitArray *bit_array,
 void		e_bit_array_move_row		(EBitArray *bit_array,
 						 gint old_row,
 						 gint new_row);
+void		e_bit_array_set_use_ranges	(EBitArray *bit_array,
+						 gboolean use_ranges);
+gboolean	e_bit_array_get_use_ranges	(EBitArray *bit_array);
 
 G_END_DECLS
 
@@ -110,6 +110,39 @@ G_DEFINE_TYPE (ECellText, e_cell_text, E_TYPE_CELL)
 
 #define TEXT_PAD 4
 
+/* Upper bound of shaped layouts kept by each ECellTextView */
+#define LAYOUT_CACHE_MAX_ENTRIES 256
+
+/* Models with more rows get only sampled for ECell::max_width */
+#define MAX_WIDTH_FULL_SCAN_ROWS 10000
+#define MAX_WIDTH_SAMPLE_ROWS 2000
+
+/* More changed rows than this make the running maximum recomputed */
+#define MAX_WIDTH_MAX_DIRTY_ROWS 1024
+
+enum {
+	TEXT_STYLE_BOLD		= 1 << 0,
+	TEXT_STYLE_STRIKEOUT	= 1 << 1,
+	TEXT_STYLE_UNDERLINE	= 1 << 2,
+	TEXT_STYLE_ITALIC	= 1 << 3
+};
+
+typedef struct {
+	gint model_col;
+	gint row;
+	gint width;
+} LayoutCacheKey;
+
+typedef struct {
+	LayoutCacheKey key;
+	PangoLayout *layout;
+	gchar *text;			/* the text the layout was shaped for */
+	guint style;			/* TEXT_STYLE_* flags */
+	guint strikeout_color;
+	guint context_serial;		/* of the canvas' PangoContext */
+	GList *link;			/* into ECellTextView::layout_cache_lru */
+} LayoutCacheEntry;
+
 typedef struct {
 	gpointer lines;			/* Text split into lines (private field) */
 	gint num_lines;			/* Number of lines of text */
@@ -133,6 +166,17 @@ typedef struct {
 	gint xofs, yofs;                 /* This gets added to the x
                                            and y for the cell text. */
 	gdouble ellipsis_width[2];      /* The width of the ellipsis. */
+
+	/* Layouts of already shaped cells, for cheap redraws. */
+	GHashTable *layout_cache;	/* LayoutCacheKey ~> LayoutCacheEntry */
+	GQueue layout_cache_lru;	/* LayoutCacheEntry, most recent first */
+
+	/* Running maximum for ECell::max_width, updated on model changes. */
+	gint max_width_col;		/* model column, -1 when not computed */
+	gint max_width_row;		/* the widest row, -1 when none */
+	gint max_width;
+	guint max_width_serial;		/* of the canvas' PangoContext */
+	GArray *max_width_dirty_rows;	/* gint rows to be measured again */
 } ECellTextView;
 
 struct _CellEdit {
@@ -329,6 +373,201 @@ ect_cancel_edit (ECellTextView *text_view)
 	e_table_item_leave_edit_ (text_view->cell_view.e_table_item_view);
 }
 
+static guint
+layout_cache_key_hash (gconstpointer ptr)
+{
+	const LayoutCacheKey *key = ptr;
+
+	return (((guint) key->row) * 31 + (guint) key->model_col) * 31 + (guint) key->width;
+}
+
+static gboolean
+layout_cache_key_equal (gconstpointer ptr1,
+                        gconstpointer ptr2)
+{
+	const LayoutCacheKey *key1 = ptr1, *key2 = ptr2;
+
+	return key1->row == key2->row &&
+		key1->model_col == key2->model_col &&
+		key1->width == key2->width;
+}
+
+static void
+layout_cache_entry_free (gpointer ptr)
+{
+	LayoutCacheEntry *entry = ptr;
+
+	if (entry) {
+		g_object_unref (entry->layout);
+		g_free (entry->text);
+		g_free (entry);
+	}
+}
+
+static void
+layout_cache_remove_entry (ECellTextView *text_view,
+                           LayoutCacheEntry *entry)
+{
+	g_queue_delete_link (&text_view->layout_cache_lru, entry->link);
+	entry->link = NULL;
+
+	/* This frees the entry */
+	g_hash_table_remove (text_view->layout_cache, &entry->key);
+}
+
+static void
+layout_cache_clear (ECellTextView *text_view)
+{
+	if (!text_view->layout_cache)
+		return;
+
+	g_queue_clear (&text_view->layout_cache_lru);
+	g_hash_table_remove_all (text_view->layout_cache);
+}
+
+static void
+layout_cache_remove_row (ECellTextView *text_view,
+                         gint row)
+{
+	GList *link, *next;
+
+	if (!text_view->layout_cache)
+		return;
+
+	for (link = text_view->layout_cache_lru.head; link; link = next) {
+		LayoutCacheEntry *entry = link->data;
+
+		next = g_list_next (link);
+
+		if (entry->key.row == row)
+			layout_cache_remove_entry (text_view, entry);
+	}
+}
+
+static guint
+layout_cache_get_context_serial (ECellTextView *text_view)
+{
+	return pango_context_get_serial (gtk_widget_get_pango_context (GTK_WIDGET (text_view->canvas)));
+}
+
+static void
+max_width_invalidate (ECellTextView *text_view)
+{
+	text_view->max_width_col = -1;
+	text_view->max_width_row = -1;
+	text_view->max_width = 0;
+
+	g_array_set_size (text_view->max_width_dirty_rows, 0);
+}
+
+static void
+max_width_add_dirty_row (ECellTextView *text_view,
+                         gint row)
+{
+	if (text_view->max_width_col < 0)
+		return;
+
+	if (text_view->max_width_dirty_rows->len >= MAX_WIDTH_MAX_DIRTY_ROWS)
+		max_width_invalidate (text_view);
+	else
+		g_array_append_val (text_view->max_width_dirty_rows, row);
+}
+
+static void
+ect_model_changed_cb (ETableModel *table_model,
+                      ECellTextView *text_view)
+{
+	layout_cache_clear (text_view);
+	max_width_invalidate (text_view);
+}
+
+static void
+ect_model_row_changed_cb (ETableModel *table_model,
+                          gint row,
+                          ECellTextView *text_view)
+{
+	layout_cache_remove_row (text_view, row);
+	max_width_add_dirty_row (text_view, row);
+}
+
+static void
+ect_model_cell_changed_cb (ETableModel *table_model,
+                           gint col,
+                           gint row,
+                           ECellTextView *text_view)
+{
+	/* Other columns can define the style of the text, thus drop whole row */
+	layout_cache_remove_row (text_view, row);
+	max_width_add_dirty_row (text_view, row);
+}
+
+static void
+ect_model_rows_inserted_cb (ETableModel *table_model,
+                            gint row,
+                            gint count,
+                            ECellTextView *text_view)
+{
+	guint ii;
+
+	/* Row indexes moved, the cached ones do not match anymore */
+	layout_cache_clear (text_view);
+
+	if (text_view->max_width_col < 0)
+		return;
+
+	if (count > MAX_WIDTH_MAX_DIRTY_ROWS) {
+		max_width_invalidate (text_view);
+		return;
+	}
+
+	if (text_view->max_width_row >= row)
+		text_view->max_width_row += count;
+
+	for (ii = 0; ii < text_view->max_width_dirty_rows->len; ii++) {
+		gint *dirty_row = &g_array_index (text_view->max_width_dirty_rows, gint, ii);
+
+		if (*dirty_row >= row)
+			*dirty_row += count;
+	}
+
+	for (ii = 0; ii < (guint) count && text_view->max_width_col >= 0; ii++) {
+		max_width_add_dirty_row (text_view, row + ii);
+	}
+}
+
+static void
+ect_model_rows_deleted_cb (ETableModel *table_model,
+                           gint row,
+                           gint count,
+                           ECellTextView *text_view)
+{
+	guint ii;
+
+	/* Row indexes moved, the cached ones do not match anymore */
+	layout_cache_clear (text_view);
+
+	if (text_view->max_width_col < 0)
+		return;
+
+	/* The maximum can only shrink, which needs to measure everything again */
+	if (text_view->max_width_row >= row && text_view->max_width_row < row + count) {
+		max_width_invalidate (text_view);
+		return;
+	}
+
+	if (text_view->max_width_row >= row + count)
+		text_view->max_width_row -= count;
+
+	for (ii = text_view->max_width_dirty_rows->len; ii-- > 0;) {
+		gint *dirty_row = &g_array_index (text_view->max_width_dirty_rows, gint, ii);
+
+		if (*dirty_row >= row + count)
+			*dirty_row -= count;
+		else if (*dirty_row >= row)
+			g_array_remove_index_fast (text_view->max_width_dirty_rows, ii);
+	}
+}
+
 /*
  * ECell::new_view method
  */
@@ -351,6 +590,34 @@ ect_new_view (ECell *ecell,
 	text_view->xofs = 0.0;
 	text_view->yofs = 0.0;
 
+	text_view->layout_cache = g_hash_table_new_full (
+		layout_cache_key_hash, layout_cache_key_equal,
+		NULL, layout_cache_entry_free);
+	g_queue_init (&text_view->layout_cache_lru);
+
+	text_view->max_width_dirty_rows = g_array_new (FALSE, FALSE, sizeof (gint));
+	max_width_invalidate (text_view);
+
+	if (table_model) {
+		g_object_ref (table_model);
+
+		g_signal_connect (
+			table_model, "model_changed",
+			G_CALLBACK (ect_model_changed_cb), text_view);
+		g_signal_connect (
+			table_model, "model_row_changed",
+			G_CALLBACK (ect_model_row_changed_cb), text_view);
+		g_signal_connect (
+			table_model, "model_cell_changed",
+			G_CALLBACK (ect_model_cell_changed_cb), text_view);
+		g_signal_connect (
+			table_model, "model_rows_inserted",
+			G_CALLBACK (ect_model_rows_inserted_cb), text_view);
+		g_signal_connect (
+			table_model, "model_rows_deleted",
+			G_CALLBACK (ect_model_rows_deleted_cb), text_view);
+	}
+
 	return (ECellView *) text_view;
 }
 
@@ -368,6 +635,15 @@ ect_kill_view (ECellView *ecv)
 	if (text_view->cell_view.kill_view_cb_data)
 	    g_list_free (text_view->cell_view.kill_view_cb_data);
 
+	if (text_view->cell_view.e_table_model) {
+		g_signal_handlers_disconnect_by_data (text_view->cell_view.e_table_model, text_view);
+		g_object_unref (text_view->cell_view.e_table_model);
+	}
+
+	layout_cache_clear (text_view);
+	g_hash_table_destroy (text_view->layout_cache);
+	g_array_free (text_view->max_width_dirty_rows, TRUE);
+
 	g_free (text_view);
 }
 
@@ -397,6 +673,9 @@ ect_unrealize (ECellView *ecv)
 		ect_cancel_edit (text_view);
 	}
 
+	/* The layouts belong to the canvas' PangoContext */
+	layout_cache_clear (text_view);
+
 	g_object_unref (text_view->i_cursor);
 
 	if (E_CELL_CLASS (e_cell_text_parent_class)->unrealize)
@@ -404,33 +683,55 @@ ect_unrealize (ECellView *ecv)
 
 }
 
+static guint
+get_text_style (ECellTextView *text_view,
+                gint row,
+                guint *out_strikeout_color)
+{
+	ECellView *ecell_view = (ECellView *) text_view;
+	ECellText *ect = E_CELL_TEXT (ecell_view->ecell);
+	guint style = 0;
+
+	*out_strikeout_color = 0;
+
+	if (row < 0)
+		return style;
+
+	if (ect->bold_column >= 0 &&
+	    e_table_model_value_at (ecell_view->e_table_model, ect->bold_column, row))
+		style |= TEXT_STYLE_BOLD;
+	if (ect->strikeout_column >= 0 &&
+	    e_table_model_value_at (ecell_view->e_table_model, ect->strikeout_column, row))
+		style |= TEXT_STYLE_STRIKEOUT;
+	if (ect->underline_column >= 0 &&
+	    e_table_model_value_at (ecell_view->e_table_model, ect->underline_column, row))
+		style |= TEXT_STYLE_UNDERLINE;
+	if (ect->italic_column >= 0 &&
+	    e_table_model_value_at (ecell_view->e_table_model, ect->italic_column, row))
+		style |= TEXT_STYLE_ITALIC;
+
+	if (ect->strikeout_color_column >= 0)
+		*out_strikeout_color = GPOINTER_TO_UINT (e_table_model_value_at (ecell_view->e_table_model, ect->strikeout_color_column, row));
+
+	return style;
+}
+
 static PangoAttrList *
 build_attr_list (ECellTextView *text_view,
                  gint row,
                  gint text_length)
 {
-
-	ECellView *ecell_view = (ECellView *) text_view;
-	ECellText *ect = E_CELL_TEXT (ecell_view->ecell);
 	PangoAttrList *attrs = pango_attr_list_new ();
 	gboolean bold, strikeout, underline, italic;
-	gint strikeout_color = 0;
+	guint strikeout_color = 0;
+	guint style;
 
-	bold = ect->bold_column >= 0 &&
-		row >= 0 &&
-		e_table_model_value_at (ecell_view->e_table_model, ect->bold_column, row);
-	strikeout = ect->strikeout_column >= 0 &&
-		row >= 0 &&
-		e_table_model_value_at (ecell_view->e_table_model, ect->strikeout_column, row);
-	underline = ect->underline_column >= 0 &&
-		row >= 0 &&
-		e_table_model_value_at (ecell_view->e_table_model, ect->underline_column, row);
-	italic = ect->italic_column >= 0 &&
-		row >= 0 &&
-		e_table_model_value_at (ecell_view->e_table_model, ect->italic_column, row);
+	style = get_text_style (text_view, row, &strikeout_color);
 
-	if (ect->strikeout_color_column >= 0 && row >= 0)
-		strikeout_color = GPOINTER_TO_UINT (e_table_model_value_at (ecell_view->e_table_model, ect->strikeout_color_column, row));
+	bold = (style & TEXT_STYLE_BOLD) != 0;
+	strikeout = (style & TEXT_STYLE_STRIKEOUT) != 0;
+	underline = (style & TEXT_STYLE_UNDERLINE) != 0;
+	italic = (style & TEXT_STYLE_ITALIC) != 0;
 
 	if (bold) {
 		PangoAttribute *attr = pango_attr_weight_new (PANGO_WEIGHT_BOLD);
@@ -609,6 +910,71 @@ build_layout (ECellTextView *text_view,
 	return layout;
 }
 
+static PangoLayout *
+layout_cache_lookup (ECellTextView *text_view,
+                     gint model_col,
+                     gint row,
+                     gint width,
+                     const gchar *text)
+{
+	LayoutCacheKey key;
+	LayoutCacheEntry *entry;
+	guint style, strikeout_color = 0;
+
+	key.model_col = model_col;
+	key.row = row;
+	key.width = width;
+
+	entry = g_hash_table_lookup (text_view->layout_cache, &key);
+	if (!entry)
+		return NULL;
+
+	style = get_text_style (text_view, row, &strikeout_color);
+
+	if (entry->style != style ||
+	    entry->strikeout_color != strikeout_color ||
+	    entry->context_serial != layout_cache_get_context_serial (text_view) ||
+	    g_strcmp0 (entry->text, text) != 0) {
+		layout_cache_remove_entry (text_view, entry);
+		return NULL;
+	}
+
+	if (entry->link != text_view->layout_cache_lru.head) {
+		g_queue_unlink (&text_view->layout_cache_lru, entry->link);
+		g_queue_push_head_link (&text_view->layout_cache_lru, entry->link);
+	}
+
+	return g_object_ref (entry->layout);
+}
+
+static void
+layout_cache_add (ECellTextView *text_view,
+                  gint model_col,
+                  gint row,
+                  gint width,
+                  const gchar *text,
+                  PangoLayout *layout)
+{
+	LayoutCacheEntry *entry;
+
+	entry = g_new0 (LayoutCacheEntry, 1);
+	entry->key.model_col = model_col;
+	entry->key.row = row;
+	entry->key.width = width;
+	entry->layout = g_object_ref (layout);
+	entry->text = g_strdup (text);
+	entry->style = get_text_style (text_view, row, &entry->strikeout_color);
+	entry->context_serial = layout_cache_get_context_serial (text_view);
+
+	g_queue_push_head (&text_view->layout_cache_lru, entry);
+	entry->link = text_view->layout_cache_lru.head;
+
+	g_hash_table_insert (text_view->layout_cache, &entry->key, entry);
+
+	while (text_view->layout_cache_lru.length > LAYOUT_CACHE_MAX_ENTRIES)
+		layout_cache_remove_entry (text_view, g_queue_peek_tail (&text_view->layout_cache_lru));
+}
+
 static PangoLayout *
 generate_layout (ECellTextView *text_view,
                  gint model_col,
@@ -628,7 +994,20 @@ generate_layout (ECellTextView *text_view,
 
 	if (row >= 0) {
 		gchar *temp = e_cell_text_get_text (ect, ecell_view->e_table_model, model_col, row);
-		layout = build_layout (text_view, row, temp ? temp : "?", width);
+		const gchar *text = temp ? temp : "?";
+
+		/* Layouts are configured differently while editing, and the edited
+		 * one is modified in place, thus do not share them with the cache. */
+		if (edit) {
+			layout = build_layout (text_view, row, text, width);
+		} else {
+			layout = layout_cache_lookup (text_view, model_col, row, width, text);
+			if (!layout) {
+				layout = build_layout (text_view, row, text, width);
+				layout_cache_add (text_view, model_col, row, width, text, layout);
+			}
+		}
+
 		e_cell_text_free_text (ect, ecell_view->e_table_model, model_col, temp);
 	} else
 		layout = build_layout (text_view, row, "Mumbo Jumbo", width);
@@ -1501,6 +1880,41 @@ ect_print_height (ECellView *ecell_view,
 	return 16 *lines + 8;
 }
 
+static gint
+measure_text_width (ECellTextView *text_view,
+                    gint model_col,
+                    gint row)
+{
+	ECellView *ecell_view = (ECellView *) text_view;
+	ECellText *ect = E_CELL_TEXT (ecell_view->ecell);
+	PangoLayout *layout;
+	gchar *temp;
+	gint width = 0;
+
+	temp = e_cell_text_get_text (ect, ecell_view->e_table_model, model_col, row);
+
+	/* Not using generate_layout(), to not flood the layout cache
+	 * with rows which are possibly never shown. */
+	layout = build_layout (text_view, row, temp ? temp : "?", 0);
+	pango_layout_get_pixel_size (layout, &width, NULL);
+	g_object_unref (layout);
+
+	e_cell_text_free_text (ect, ecell_view->e_table_model, model_col, temp);
+
+	return width;
+}
+
+static void
+max_width_update (ECellTextView *text_view,
+                  gint row,
+                  gint width)
+{
+	if (width > text_view->max_width || text_view->max_width_row < 0) {
+		text_view->max_width = width;
+		text_view->max_width_row = row;
+	}
+}
+
 static gint
 ect_max_width (ECellView *ecell_view,
                gint model_col,
@@ -1508,23 +1922,59 @@ ect_max_width (ECellView *ecell_view,
 {
 	/* New ECellText */
 	ECellTextView *text_view = (ECellTextView *) ecell_view;
-	gint row;
+	guint context_serial;
 	gint number_of_rows;
-	gint max_width = 0;
+	gint row;
 
 	number_of_rows = e_table_model_row_count (ecell_view->e_table_model);
+	context_serial = layout_cache_get_context_serial (text_view);
+
+	if (text_view->max_width_col != model_col ||
+	    text_view->max_width_serial != context_serial)
+		max_width_invalidate (text_view);
 
-	for (row = 0; row < number_of_rows; row++) {
-		PangoLayout *layout = generate_layout (text_view, model_col, view_col, row, 0);
-		gint width;
+	if (text_view->max_width_col >= 0) {
+		GArray *dirty_rows = text_view->max_width_dirty_rows;
+		guint ii;
 
-		pango_layout_get_pixel_size (layout, &width, NULL);
+		for (ii = 0; ii < dirty_rows->len; ii++) {
+			gint width;
+
+			row = g_array_index (dirty_rows, gint, ii);
+			if (row >= number_of_rows)
+				continue;
+
+			width = measure_text_width (text_view, model_col, row);
+
+			/* The widest row got narrower, the maximum is unknown now */
+			if (row == text_view->max_width_row && width < text_view->max_width) {
+				max_width_invalidate (text_view);
+				break;
+			}
+
+			max_width_update (text_view, row, width);
+		}
+
+		g_array_set_size (dirty_rows, 0);
+	}
+
+	if (text_view->max_width_col < 0) {
+		gint step = 1;
+
+		/* Large models are only sampled, thus the result is an estimate,
+		 * which is refined by the changes made to the model later on. */
+		if (number_of_rows > MAX_WIDTH_FULL_SCAN_ROWS)
+			step = number_of_rows / MAX_WIDTH_SAMPLE_ROWS;
+
+		for (row = 0; row < number_of_rows; row += step) {
+			max_width_update (text_view, row, measure_text_width (text_view, model_col, row));
+		}
 
-		max_width = MAX (max_width, width);
-		g_object_unref (layout);
+		text_view->max_width_col = model_col;
+		text_view->max_width_serial = context_serial;
 	}
 
-	return max_width + 8;
+	return text_view->max_width + 8;
 }
 
 static gint
@@ -103,6 +103,13 @@ typedef struct
 
 	EBookClientView *client_view_pending;
 	GPtrArray *contacts_pending;
+
+	/* e_book_client_get_view() calls in progress */
+	guint n_view_requests;
+
+	/* The client_view finished and was stopped,
+	 * thus the contacts are all it matched. */
+	gboolean finished;
 }
 ContactSource;
 
@@ -715,6 +722,9 @@ view_complete (EContactStore *contact_store,
 	/* If current view finished, do nothing */
 	if (client_view == source->client_view) {
 		stop_view (contact_store, source->client_view);
+		/* An error, like a size limit of an LDAP server, means
+		 * the contacts are not all the view matches. */
+		source->finished = !error && !source->client_view_pending && !source->n_view_requests;
 		return;
 	}
 
@@ -769,6 +779,11 @@ view_complete (EContactStore *contact_store,
 	/* Free array of pending contacts (members have been either moved or unreffed) */
 	g_ptr_array_free (source->contacts_pending, TRUE);
 	source->contacts_pending = NULL;
+
+	/* The new current view finished too, stop it the same way
+	 * as a current view which finished is stopped above. */
+	stop_view (contact_store, source->client_view);
+	source->finished = !error && !source->n_view_requests;
 }
 
 /* --------------------- *
@@ -885,6 +900,8 @@ clear_contact_source (EContactStore *contact_store,
 
 	/* Free main and pending views, clear cached contacts */
 
+	source->finished = FALSE;
+
 	if (source->client_view) {
 		stop_view (contact_store, source->client_view);
 		g_object_unref (source->client_view);
@@ -927,6 +944,9 @@ client_view_ready_cb (GObject *source_object,
 
 		source = &g_array_index (contact_store->priv->contact_sources, ContactSource, source_idx);
 
+		if (source->n_view_requests > 0)
+			source->n_view_requests--;
+
 		if (source->client_view) {
 			if (source->client_view_pending) {
 				stop_view (contact_store, source->client_view_pending);
@@ -947,6 +967,9 @@ client_view_ready_cb (GObject *source_object,
 
 			if (source->client_view) {
 				start_view (contact_store, client_view);
+			} else {
+				/* Nothing will come from this book */
+				source->finished = !source->n_view_requests;
 			}
 		}
 	}
@@ -977,6 +1000,9 @@ query_contact_source (EContactStore *contact_store,
 		}
 	}
 
+	source->finished = FALSE;
+	source->n_view_requests++;
+
 	query_str = e_book_query_to_string (contact_store->priv->query);
 	e_book_client_get_view (source->book_client, query_str, NULL, client_view_ready_cb, g_object_ref (contact_store));
 	g_free (query_str);
@@ -1208,6 +1234,88 @@ e_contact_store_set_query (EContactStore *contact_store,
 	}
 }
 
+/**
+ * e_contact_store_refine_query:
+ * @contact_store: an #EContactStore
+ * @book_query: an #EBookQuery
+ * @filter_func: (scope call): an #EContactStoreFilterFunc
+ * @user_data: user data for @filter_func
+ *
+ * Sets @book_query to be the query used by @contact_store, like
+ * e_contact_store_set_query() does, but without asking the books again.
+ * The @book_query should match a subset of the contacts the current query
+ * matched; the contacts for which @filter_func returns %FALSE are removed
+ * from @contact_store.
+ *
+ * This can be done only when all the books finished the current query
+ * without an error, like exceeding a size limit of the server, which would
+ * mean not all the matching contacts are known. When they did not, nothing
+ * is changed and the caller should use
+ * e_contact_store_set_query() instead.
+ *
+ * Returns: whether the query was refined
+ *
+ * Since: 3.32
+ **/
+gboolean
+e_contact_store_refine_query (EContactStore *contact_store,
+                              EBookQuery *book_query,
+                              EContactStoreFilterFunc filter_func,
+                              gpointer user_data)
+{
+	GArray *array;
+	gint offset = 0;
+	gint i, j;
+
+	g_return_val_if_fail (E_IS_CONTACT_STORE (contact_store), FALSE);
+	g_return_val_if_fail (book_query != NULL, FALSE);
+	g_return_val_if_fail (filter_func != NULL, FALSE);
+
+	if (!contact_store->priv->query)
+		return FALSE;
+
+	array = contact_store->priv->contact_sources;
+
+	for (i = 0; i < array->len; i++) {
+		ContactSource *source;
+
+		source = &g_array_index (array, ContactSource, i);
+		if (!source->finished)
+			return FALSE;
+	}
+
+	for (i = 0; i < array->len; i++) {
+		ContactSource *source;
+
+		source = &g_array_index (array, ContactSource, i);
+
+		if (source->client_view)
+			g_signal_emit (contact_store, signals[START_UPDATE], 0, source->client_view);
+
+		for (j = 0; j < source->contacts->len; j++) {
+			EContact *contact = g_ptr_array_index (source->contacts, j);
+
+			if (!filter_func (contact, user_data)) {
+				g_object_unref (contact);
+				g_ptr_array_remove_index (source->contacts, j);
+				row_deleted (contact_store, offset + j);
+				j--;  /* Stay in place */
+			}
+		}
+
+		if (source->client_view)
+			g_signal_emit (contact_store, signals[STOP_UPDATE], 0, source->client_view);
+
+		offset += source->contacts->len;
+	}
+
+	e_book_query_ref (book_query);
+	e_book_query_unref (contact_store->priv->query);
+	contact_store->priv->query = book_query;
+
+	return TRUE;
+}
+
 /**
  * e_contact_store_peek_query:
  * @contact_store: an #EContactStore
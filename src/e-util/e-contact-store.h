@@ -54,6 +54,18 @@ typedef struct _EContactStore EContactStore;
 typedef struct _EContactStoreClass EContactStoreClass;
 typedef struct _EContactStorePrivate EContactStorePrivate;
 
+/**
+ * EContactStoreFilterFunc:
+ * @contact: an #EContact
+ * @user_data: user data passed to e_contact_store_refine_query()
+ *
+ * Returns: whether @contact should be kept in the store
+ *
+ * Since: 3.32
+ **/
+typedef gboolean (*EContactStoreFilterFunc)	(EContact *contact,
+						 gpointer user_data);
+
 struct _EContactStore {
 	GObject parent;
 	EContactStorePrivate *priv;
@@ -92,6 +104,10 @@ gboolean	e_contact_store_remove_client	(EContactStore *contact_store,
 						 EBookClient *book_client);
 void		e_contact_store_set_query	(EContactStore *contact_store,
 						 EBookQuery *book_query);
+gboolean	e_contact_store_refine_query	(EContactStore *contact_store,
+						 EBookQuery *book_query,
+						 EContactStoreFilterFunc filter_func,
+						 gpointer user_data);
 EBookQuery *	e_contact_store_peek_query	(EContactStore *contact_store);
 
 G_END_DECLS
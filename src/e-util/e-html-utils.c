@@ -27,22 +27,6 @@
 
 #include "e-html-utils.h"
 
-static gchar *
-check_size (gchar **buffer,
-            gint *buffer_size,
-            gchar *out,
-            gint len)
-{
-	if (out + len + 1> *buffer + *buffer_size) {
-		gint index = out - *buffer;
-
-		*buffer_size = MAX (index + len + 1, *buffer_size * 2);
-		*buffer = g_realloc (*buffer, *buffer_size);
-		out = *buffer + index;
-	}
-	return out;
-}
-
 /* auto-urlification hints: the goal is not to be strictly RFC-compliant,
  * but rather to accurately distinguish urls/addresses from non-urls/
  * addresses in real-world email.
@@ -68,6 +52,113 @@ static gint special_chars[] = {
 #define is_trailing_garbage(c) (c > 127 || (special_chars[c] & 2))
 #define is_domain_name_char(c) (c < 128 && (special_chars[c] & 4))
 
+/* Classes of the input bytes, for runs of bytes which need no conversion
+ * to be copied to the output at once.  A byte is plain when its class
+ * has any bit of the mask e_text_to_html_full() builds from its flags.
+ *
+ * TEXT_PLAIN = always copied as is
+ * TEXT_SPACE = space, special with E_TEXT_TO_HTML_CONVERT_SPACES
+ * TEXT_TAB   = tab, special with E_TEXT_TO_HTML_CONVERT_SPACES or _NL
+ * TEXT_AT    = '@', special with E_TEXT_TO_HTML_CONVERT_ADDRESSES
+ * TEXT_URL   = plain letter, which can start a URL, see url_start_at()
+ */
+#define TEXT_PLAIN 1
+#define TEXT_SPACE 2
+#define TEXT_TAB   4
+#define TEXT_AT    8
+#define TEXT_URL   16
+
+static const guchar text_chars[256] = {
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  4,  0,  0,  0,  1,  0,  0,    /*  nul - 0x0f */
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,    /* 0x10 - 0x1f */
+	 2,  1,  0,  1,  1,  1,  0,  1,  1,  1,  1,  1,  1,  1,  1,  1,    /*   sp - /    */
+	 1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  0,  1,  0,  1,    /*    0 - ?    */
+	 8,  1,  1, 17,  1,  1, 17,  1, 17,  1,  1,  1,  1, 17, 17,  1,    /*    @ - O    */
+	 1,  1,  1, 17, 17,  1,  1, 17,  1,  1,  1,  1,  1,  1,  1,  1,    /*    P - _    */
+	 1,  1,  1, 17,  1,  1, 17,  1, 17,  1,  1,  1,  1, 17, 17,  1,    /*    ` - o    */
+	 1,  1,  1, 17, 17,  1,  1, 17,  1,  1,  1,  1,  1,  1,  1,  1     /*    p - del  */
+	/* 0x80 - 0xff are all zero, they are UTF-8 sequences to decode */
+};
+
+typedef enum {
+	URL_START_NONE,
+	URL_START_SCHEME,
+	URL_START_WWW
+} UrlStart;
+
+/* Checks whether a URL, which url_extract() should try to extract,
+ * starts at @p; only the schemes starting with the letter at @p are
+ * compared. */
+static UrlStart
+url_start_at (const guchar *p)
+{
+	const gchar *str = (const gchar *) p;
+
+	switch (*p) {
+	case 'c': case 'C':
+		if (!g_ascii_strncasecmp (str, "callto:", 7))
+			return URL_START_SCHEME;
+		break;
+	case 'f': case 'F':
+		if (!g_ascii_strncasecmp (str, "ftp://", 6) ||
+		    !g_ascii_strncasecmp (str, "file:", 5))
+			return URL_START_SCHEME;
+		break;
+	case 'h': case 'H':
+		if (!g_ascii_strncasecmp (str, "http://", 7) ||
+		    !g_ascii_strncasecmp (str, "https://", 8) ||
+		    !g_ascii_strncasecmp (str, "h323:", 5))
+			return URL_START_SCHEME;
+		break;
+	case 'm': case 'M':
+		if (!g_ascii_strncasecmp (str, "mailto:", 7))
+			return URL_START_SCHEME;
+		break;
+	case 'n': case 'N':
+		if (!g_ascii_strncasecmp (str, "nntp://", 7) ||
+		    !g_ascii_strncasecmp (str, "news:", 5))
+			return URL_START_SCHEME;
+		break;
+	case 's': case 'S':
+		if (!g_ascii_strncasecmp (str, "sip:", 4))
+			return URL_START_SCHEME;
+		break;
+	case 't': case 'T':
+		if (!g_ascii_strncasecmp (str, "tel:", 4))
+			return URL_START_SCHEME;
+		break;
+	case 'w': case 'W':
+		if (!g_ascii_strncasecmp (str, "webcal:", 7))
+			return URL_START_SCHEME;
+		if (!g_ascii_strncasecmp (str, "www.", 4) &&
+		    is_url_char (p[4]))
+			return URL_START_WWW;
+		break;
+	}
+
+	return URL_START_NONE;
+}
+
+/* Returns how many bytes from @p on can be copied to the output as they
+ * are, stopping before a URL start when @convert_urls is set. */
+static gsize
+text_to_html_plain_run (const guchar *p,
+                        guint plain_mask,
+                        gboolean convert_urls)
+{
+	const guchar *start = p;
+	guint cls;
+
+	while ((cls = text_chars[*p]) & plain_mask) {
+		if ((cls & TEXT_URL) != 0 && convert_urls &&
+		    url_start_at (p) != URL_START_NONE)
+			break;
+		p++;
+	}
+
+	return p - start;
+}
+
 /* (http|https|ftp|nntp)://[^ "|/]+\.([^ "|]*[^ ,.!?;:>)\]}`'"|_-])+ */
 /* www\.[A-Za-z0-9.-]+(/([^ "|]*[^ ,.!?;:>)\]}`'"|_-])+)             */
 
@@ -112,7 +203,7 @@ url_extract (const guchar **text,
 
 static gchar *
 email_address_extract (const guchar **cur,
-                       gchar **out,
+                       GString *out,
                        const guchar *linestart)
 {
 	const guchar *start, *end, *dot;
@@ -142,7 +233,7 @@ email_address_extract (const guchar **cur,
 		return NULL;
 
 	addr = g_strndup ((gchar *) start, end - start);
-	*out -= *cur - start;
+	g_string_truncate (out, out->len - (*cur - start));
 	*cur = end;
 
 	return addr;
@@ -239,41 +330,41 @@ e_text_to_html_full (const gchar *input,
                      guint32 color)
 {
 	const guchar *cur, *next, *linestart;
-	gchar *buffer = NULL;
-	gchar *out = NULL;
-	gint buffer_size = 0, col;
+	GString *out;
+	gint col;
+	guint plain_mask;
 	gboolean colored = FALSE, saw_citation = FALSE;
+	gboolean convert_urls = (flags & E_TEXT_TO_HTML_CONVERT_URLS) != 0;
 
 	/* Allocate a translation buffer.  */
-	buffer_size = strlen (input) * 2 + 5;
-	buffer = g_malloc (buffer_size);
+	out = g_string_sized_new (strlen (input) * 2 + 5);
 
-	out = buffer;
 	if (flags & E_TEXT_TO_HTML_PRE)
-		out += sprintf (out, "<PRE>");
+		g_string_append (out, "<PRE>");
+
+	plain_mask = TEXT_PLAIN;
+	if (!(flags & E_TEXT_TO_HTML_CONVERT_SPACES))
+		plain_mask |= TEXT_SPACE;
+	if (!(flags & (E_TEXT_TO_HTML_CONVERT_SPACES | E_TEXT_TO_HTML_CONVERT_NL)))
+		plain_mask |= TEXT_TAB;
+	if (!(flags & E_TEXT_TO_HTML_CONVERT_ADDRESSES))
+		plain_mask |= TEXT_AT;
 
 	col = 0;
 
 	for (cur = linestart = (const guchar *) input; cur && *cur; cur = next) {
 		gunichar u;
+		gsize n_plain;
 
 		if (flags & E_TEXT_TO_HTML_MARK_CITATION && col == 0) {
 			saw_citation = is_citation (cur, saw_citation);
 			if (saw_citation) {
 				if (!colored) {
-					gchar font[25];
-
-					g_snprintf (font, 25, "<FONT COLOR=\"#%06x\">", color);
-
-					out = check_size (&buffer, &buffer_size, out, 25);
-					out += sprintf (out, "%s", font);
+					g_string_append_printf (out, "<FONT COLOR=\"#%06x\">", color);
 					colored = TRUE;
 				}
 			} else if (colored) {
-				const gchar *no_font = "</FONT>";
-
-				out = check_size (&buffer, &buffer_size, out, 9);
-				out += sprintf (out, "%s", no_font);
+				g_string_append (out, "</FONT>");
 				colored = FALSE;
 			}
 
@@ -281,27 +372,24 @@ e_text_to_html_full (const gchar *input,
 			if (*cur == '>' && !saw_citation)
 				cur++;
 		} else if (flags & E_TEXT_TO_HTML_CITE && col == 0) {
-			out = check_size (&buffer, &buffer_size, out, 5);
-			out += sprintf (out, "&gt; ");
+			g_string_append (out, "&gt; ");
+		}
+
+		/* Copy the bytes which need no conversion in one go. */
+		n_plain = text_to_html_plain_run (cur, plain_mask, convert_urls);
+		if (n_plain > 0) {
+			g_string_append_len (out, (const gchar *) cur, n_plain);
+			col += n_plain;
+			next = cur + n_plain;
+			continue;
 		}
 
 		u = g_utf8_get_char ((gchar *) cur);
-		if (g_unichar_isalpha (u) &&
-		    (flags & E_TEXT_TO_HTML_CONVERT_URLS)) {
+		if (convert_urls && (text_chars[*cur] & TEXT_URL) != 0) {
 			gchar *tmpurl = NULL, *refurl = NULL, *dispurl = NULL;
 
-			if (!g_ascii_strncasecmp ((gchar *) cur, "http://", 7) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "https://", 8) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "ftp://", 6) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "nntp://", 7) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "mailto:", 7) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "news:", 5) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "file:", 5) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "callto:", 7) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "h323:", 5) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "sip:", 4) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "tel:", 4) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "webcal:", 7)) {
+			switch (url_start_at (cur)) {
+			case URL_START_SCHEME:
 				tmpurl = url_extract (&cur, TRUE, (flags & E_TEXT_TO_HTML_URL_IS_WHOLE_TEXT) != 0);
 				if (tmpurl) {
 					refurl = e_text_to_html (tmpurl, 0);
@@ -323,14 +411,19 @@ e_text_to_html_full (const gchar *input,
 						dispurl = g_strdup (refurl);
 					}
 				}
-			} else if (!g_ascii_strncasecmp ((gchar *) cur, "www.", 4) &&
-				   is_url_char (*(cur + 4))) {
+				break;
+
+			case URL_START_WWW:
 				tmpurl = url_extract (&cur, FALSE, (flags & E_TEXT_TO_HTML_URL_IS_WHOLE_TEXT) != 0);
 				if (tmpurl) {
 					dispurl = e_text_to_html (tmpurl, 0);
 					refurl = g_strdup_printf (
 						"http://%s", dispurl);
 				}
+				break;
+
+			case URL_START_NONE:
+				break;
 			}
 
 			if (tmpurl) {
@@ -346,13 +439,9 @@ e_text_to_html_full (const gchar *input,
 					refurl = replaced;
 				}
 
-				out = check_size (
-					&buffer, &buffer_size, out,
-					strlen (refurl) +
-					strlen (dispurl) + 15);
-				out += sprintf (out,
-						"<a href=\"%s\">%s</a>",
-						refurl, dispurl);
+				g_string_append_printf (out,
+					"<a href=\"%s\">%s</a>",
+					refurl, dispurl);
 				col += strlen (tmpurl);
 				g_free (tmpurl);
 				g_free (refurl);
@@ -365,20 +454,17 @@ e_text_to_html_full (const gchar *input,
 		}
 
 		if (u == '@' && (flags & E_TEXT_TO_HTML_CONVERT_ADDRESSES)) {
-			gchar *addr, *dispaddr, *outaddr;
+			gchar *addr, *dispaddr;
 
-			addr = email_address_extract (&cur, &out, linestart);
+			addr = email_address_extract (&cur, out, linestart);
 			if (addr) {
 				dispaddr = e_text_to_html (addr, 0);
-				outaddr = g_strdup_printf (
+				g_string_append_printf (out,
 					"<a href=\"mailto:%s\">%s</a>",
 					addr, dispaddr);
-				out = check_size (&buffer, &buffer_size, out, strlen (outaddr));
-				out += sprintf (out, "%s", outaddr);
 				col += strlen (addr);
 				g_free (addr);
 				g_free (dispaddr);
-				g_free (outaddr);
 
 				if (!*cur)
 					break;
@@ -395,39 +481,31 @@ e_text_to_html_full (const gchar *input,
 		} else
 			next = (const guchar *) g_utf8_next_char (cur);
 
-		out = check_size (&buffer, &buffer_size, out, 10);
-
 		switch (u) {
 		case '<':
-			strcpy (out, "&lt;");
-			out += 4;
+			g_string_append (out, "&lt;");
 			col++;
 			break;
 
 		case '>':
-			strcpy (out, "&gt;");
-			out += 4;
+			g_string_append (out, "&gt;");
 			col++;
 			break;
 
 		case '&':
-			strcpy (out, "&amp;");
-			out += 5;
+			g_string_append (out, "&amp;");
 			col++;
 			break;
 
 		case '"':
-			strcpy (out, "&quot;");
-			out += 6;
+			g_string_append (out, "&quot;");
 			col++;
 			break;
 
 		case '\n':
-			if (flags & E_TEXT_TO_HTML_CONVERT_NL) {
-				strcpy (out, "<br>");
-				out += 4;
-			}
-			*out++ = *cur;
+			if (flags & E_TEXT_TO_HTML_CONVERT_NL)
+				g_string_append (out, "<br>");
+			g_string_append_c (out, *cur);
 			linestart = cur;
 			col = 0;
 			break;
@@ -436,10 +514,7 @@ e_text_to_html_full (const gchar *input,
 			if (flags & (E_TEXT_TO_HTML_CONVERT_SPACES |
 				     E_TEXT_TO_HTML_CONVERT_NL)) {
 				do {
-					out = check_size (
-						&buffer, &buffer_size, out, 7);
-					strcpy (out, "&nbsp;");
-					out += 6;
+					g_string_append (out, "&nbsp;");
 					col++;
 				} while (col % 8);
 				break;
@@ -451,8 +526,7 @@ e_text_to_html_full (const gchar *input,
 				if (cur == (const guchar *) input ||
 				    *(cur + 1) == ' ' || *(cur + 1) == '\t' ||
 				    *(cur - 1) == '\n') {
-					strcpy (out, "&nbsp;");
-					out += 6;
+					g_string_append (out, "&nbsp;");
 					col++;
 					break;
 				}
@@ -463,25 +537,22 @@ e_text_to_html_full (const gchar *input,
 			if ((u >= 0x20 && u < 0x80) ||
 			    (u == '\r' || u == '\t')) {
 				/* Default case, just copy. */
-				*out++ = u;
+				g_string_append_c (out, u);
 			} else {
 				if (flags & E_TEXT_TO_HTML_ESCAPE_8BIT)
-					*out++ = '?';
+					g_string_append_c (out, '?');
 				else
-					out += g_snprintf (out, 9, "&#%d;", u);
+					g_string_append_printf (out, "&#%d;", u);
 			}
 			col++;
 			break;
 		}
 	}
 
-	out = check_size (&buffer, &buffer_size, out, 7);
 	if (flags & E_TEXT_TO_HTML_PRE)
-		strcpy (out, "</PRE>");
-	else
-		*out = '\0';
+		g_string_append (out, "</PRE>");
 
-	return buffer;
+	return g_string_free (out, FALSE);
 }
 
 gchar *
@@ -490,109 +561,3 @@ e_text_to_html (const gchar *input,
 {
 	return e_text_to_html_full (input, flags, 0);
 }
-
-#ifdef E_HTML_UTILS_TEST
-
-struct {
-	gchar *text, *url;
-} url_tests[] = {
-	{ "bob@foo.com", "mailto:bob@foo.com" },
-	{ "Ends with bob@foo.com", "mailto:bob@foo.com" },
-	{ "bob@foo.com at start", "mailto:bob@foo.com" },
-	{ "bob@foo.com.", "mailto:bob@foo.com" },
-	{ "\"bob@foo.com\"", "mailto:bob@foo.com" },
-	{ "<bob@foo.com>", "mailto:bob@foo.com" },
-	{ "(bob@foo.com)", "mailto:bob@foo.com" },
-	{ "bob@foo.com, 555-9999", "mailto:bob@foo.com" },
-	{ "|bob@foo.com|555-9999|", "mailto:bob@foo.com" },
-	{ "bob@ no match bob@", NULL },
-	{ "@foo.com no match @foo.com", NULL },
-	{ "\"bob\"@foo.com", NULL },
-	{ "M@ke money fast!", NULL },
-	{ "ASCII art @_@ @>->-", NULL },
-
-	{ "http://www.foo.com", "http://www.foo.com" },
-	{ "Ends with http://www.foo.com", "http://www.foo.com" },
-	{ "http://www.foo.com at start", "http://www.foo.com" },
-	{ "http://www.foo.com.", "http://www.foo.com" },
-	{ "http://www.foo.com/.", "http://www.foo.com/" },
-	{ "<http://www.foo.com>", "http://www.foo.com" },
-	{ "(http://www.foo.com)", "http://www.foo.com" },
-	{ "http://www.foo.com, 555-9999", "http://www.foo.com" },
-	{ "|http://www.foo.com|555-9999|", "http://www.foo.com" },
-	{ "foo http://www.foo.com/ bar", "http://www.foo.com/" },
-	{ "foo http://www.foo.com/index.html bar",
-	  "http://www.foo.com/index.html" },
-	{ "foo http://www.foo.com/q?99 bar", "http://www.foo.com/q?99" },
-	{ "foo http://www.foo.com/;foo=bar&baz=quux bar",
-	  "http://www.foo.com/;foo=bar&baz=quux" },
-	{ "foo http://www.foo.com/index.html#anchor bar",
-	  "http://www.foo.com/index.html#anchor" },
-	{ "http://www.foo.com/index.html; foo",
-	  "http://www.foo.com/index.html" },
-	{ "http://www.foo.com/index.html: foo",
-	  "http://www.foo.com/index.html" },
-	{ "http://www.foo.com/index.html-- foo",
-	  "http://www.foo.com/index.html" },
-	{ "http://www.foo.com/index.html?",
-	  "http://www.foo.com/index.html" },
-	{ "http://www.foo.com/index.html!",
-	  "http://www.foo.com/index.html" },
-	{ "\"http://www.foo.com/index.html\"",
-	  "http://www.foo.com/index.html" },
-	{ "'http://www.foo.com/index.html'",
-	  "http://www.foo.com/index.html" },
-	{ "http://bob@www.foo.com/bar/baz/",
-	  "http://bob@www.foo.com/bar/baz/" },
-	{ "http no match http", NULL },
-	{ "http: no match http:", NULL },
-	{ "http:// no match http://", NULL },
-	{ "unrecognized://bob@foo.com/path", NULL },
-
-	{ "src/www.c", NULL },
-	{ "Ewwwwww.Gross.", NULL },
-
-};
-gint num_url_tests = G_N_ELEMENTS (url_tests);
-
-gint
-main (gint argc,
-      gchar **argv)
-{
-	gint i, errors = 0;
-	gchar *html, *url, *p;
-
-	for (i = 0; i < num_url_tests; i++) {
-		html = e_text_to_html (
-			url_tests[i].text,
-			E_TEXT_TO_HTML_CONVERT_URLS |
-			E_TEXT_TO_HTML_CONVERT_ADDRESSES);
-
-		url = strstr (html, "href=\"");
-		if (url) {
-			url += 6;
-			p = strchr (url, '"');
-			if (p)
-				*p = '\0';
-
-			while ((p = strstr (url, "&amp;")))
-				memmove (p + 1, p + 5, strlen (p + 5) + 1);
-		}
-
-		if ((url && (!url_tests[i].url || strcmp (url, url_tests[i].url) != 0)) ||
-		    (!url && url_tests[i].url)) {
-			printf (
-				"FAILED on \"%s\" -> %s\n  (got %s)\n\n",
-				url_tests[i].text,
-				url_tests[i].url ? url_tests[i].url : "(nothing)",
-				url ? url : "(nothing)");
-			errors++;
-		}
-
-		g_free (html);
-	}
-
-	printf ("\n%d errors\n", errors);
-	return errors;
-}
-#endif
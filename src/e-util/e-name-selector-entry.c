@@ -62,6 +62,10 @@ struct _ENameSelectorEntryPrivate {
 	gboolean is_completing;
 	GSList *user_query_fields;
 
+	/* The cue and the query the contact store was last queried for. */
+	gchar *completion_cue;
+	EBookQuery *completion_query;
+
 	/* For asynchronous operations. */
 	GQueue cancellables;
 
@@ -112,6 +116,7 @@ static void user_insert_text (ENameSelectorEntry *name_selector_entry, gchar *ne
 static void user_delete_text (ENameSelectorEntry *name_selector_entry, gint start_pos, gint end_pos, gpointer user_data);
 
 static void setup_default_contact_store (ENameSelectorEntry *name_selector_entry);
+static void clear_completion_cue (ENameSelectorEntry *name_selector_entry);
 static void deep_free_list (GList *list);
 
 static void
@@ -223,6 +228,8 @@ name_selector_entry_dispose (GObject *object)
 	g_slist_free (priv->user_query_fields);
 	priv->user_query_fields = NULL;
 
+	clear_completion_cue (E_NAME_SELECTOR_ENTRY (object));
+
 	/* Cancel any stuck book loading operations. */
 	while (!g_queue_is_empty (&priv->cancellables)) {
 		GCancellable *cancellable;
@@ -824,6 +831,185 @@ ens_util_populate_user_query_fields (GSList *user_query_fields,
 	return g_string_free (user_fields, !user_fields->str || !*user_fields->str);
 }
 
+static void
+clear_completion_cue (ENameSelectorEntry *name_selector_entry)
+{
+	ENameSelectorEntryPrivate *priv = name_selector_entry->priv;
+
+	g_free (priv->completion_cue);
+	priv->completion_cue = NULL;
+
+	if (priv->completion_query) {
+		e_book_query_unref (priv->completion_query);
+		priv->completion_query = NULL;
+	}
+}
+
+typedef struct _CompletionFilterData {
+	GSList *user_query_fields;
+	const gchar *cue_str;
+	gchar *name_cue_str;
+	gchar *comma_cue_str;
+} CompletionFilterData;
+
+/* Whether the contacts matching a cue can be found among the contacts
+ * matching a shorter prefix of the cue, which holds for all the query
+ * parts except for exact matches on the user query fields. */
+static gboolean
+completion_query_can_refine (ENameSelectorEntry *name_selector_entry)
+{
+	GSList *link;
+
+	for (link = name_selector_entry->priv->user_query_fields; link; link = g_slist_next (link)) {
+		const gchar *field = link->data;
+		EContactField field_id;
+
+		if (!field || !*field)
+			continue;
+
+		if (*field == '@')
+			return FALSE;
+
+		if (*field == '$')
+			field++;
+
+		field_id = e_contact_field_id (field);
+		if (!field_id || (field_id != E_CONTACT_EMAIL && !e_contact_field_is_string (field_id)))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+completion_value_matches (const gchar *value,
+                          CompletionFilterData *data)
+{
+	if (!value || !*value)
+		return FALSE;
+
+	return e_util_utf8_strstrcasedecomp (value, data->cue_str) ||
+		(*data->name_cue_str && e_util_utf8_strstrcasedecomp (value, data->name_cue_str)) ||
+		(data->comma_cue_str && e_util_utf8_strstrcasedecomp (value, data->comma_cue_str));
+}
+
+static gboolean
+completion_field_matches (EContact *contact,
+                          EContactField field_id,
+                          CompletionFilterData *data)
+{
+	if (field_id == E_CONTACT_EMAIL) {
+		GList *emails, *link;
+		gboolean matches = FALSE;
+
+		emails = e_contact_get (contact, E_CONTACT_EMAIL);
+		for (link = emails; link && !matches; link = g_list_next (link)) {
+			matches = completion_value_matches (link->data, data);
+		}
+
+		g_list_free_full (emails, g_free);
+
+		return matches;
+	}
+
+	/* The books match the "full_name" also against the parts
+	 * of the structured name, thus do the same here. */
+	if (field_id == E_CONTACT_FULL_NAME) {
+		EContactName *name;
+		gboolean matches;
+
+		if (completion_value_matches (e_contact_get_const (contact, E_CONTACT_FULL_NAME), data))
+			return TRUE;
+
+		name = e_contact_get (contact, E_CONTACT_NAME);
+		if (!name)
+			return FALSE;
+
+		matches = completion_value_matches (name->given, data) ||
+			completion_value_matches (name->additional, data) ||
+			completion_value_matches (name->family, data) ||
+			completion_value_matches (name->prefixes, data) ||
+			completion_value_matches (name->suffixes, data);
+
+		e_contact_name_free (name);
+
+		return matches;
+	}
+
+	return completion_value_matches (e_contact_get_const (contact, field_id), data);
+}
+
+/* Keeps the contacts which contain the cue in any of the queried fields;
+ * this is looser than the beginswith parts of the query, but the contacts
+ * come from the results of the previous, shorter cue, thus it only keeps
+ * a few more contacts than a new query would return, and never less. */
+static gboolean
+completion_filter_cb (EContact *contact,
+                      gpointer user_data)
+{
+	CompletionFilterData *data = user_data;
+	GSList *link;
+
+	if (completion_field_matches (contact, E_CONTACT_NICKNAME, data) ||
+	    completion_field_matches (contact, E_CONTACT_EMAIL, data) ||
+	    completion_field_matches (contact, E_CONTACT_FULL_NAME, data) ||
+	    completion_field_matches (contact, E_CONTACT_FILE_AS, data))
+		return TRUE;
+
+	for (link = data->user_query_fields; link; link = g_slist_next (link)) {
+		const gchar *field = link->data;
+
+		if (!field || !*field)
+			continue;
+
+		if (*field == '$')
+			field++;
+
+		if (completion_field_matches (contact, e_contact_field_id (field), data))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Narrows the current results of the contact store down to the @cue_str,
+ * when it only extends the previous cue; typing a name then does not
+ * restart the book views on every key press. */
+static gboolean
+refine_completion_query (ENameSelectorEntry *name_selector_entry,
+                         EBookQuery *book_query,
+                         const gchar *cue_str)
+{
+	ENameSelectorEntryPrivate *priv = name_selector_entry->priv;
+	CompletionFilterData data;
+	gchar **strv;
+	gboolean refined;
+
+	if (!priv->completion_cue ||
+	    !g_str_has_prefix (cue_str, priv->completion_cue) ||
+	    e_contact_store_peek_query (priv->contact_store) != priv->completion_query ||
+	    !completion_query_can_refine (name_selector_entry))
+		return FALSE;
+
+	/* The same variants of the cue as the name_style_query() uses */
+	data.user_query_fields = priv->user_query_fields;
+	data.cue_str = cue_str;
+	data.name_cue_str = g_strstrip (sanitize_string (cue_str));
+	data.comma_cue_str = NULL;
+
+	strv = g_strsplit (data.name_cue_str, " ", 0);
+	if (strv[0] && strv[1])
+		data.comma_cue_str = g_strstrip (g_strjoinv (", ", strv));
+	g_strfreev (strv);
+
+	refined = e_contact_store_refine_query (priv->contact_store, book_query, completion_filter_cb, &data);
+
+	g_free (data.name_cue_str);
+	g_free (data.comma_cue_str);
+
+	return refined;
+}
+
 static void
 set_completion_query (ENameSelectorEntry *name_selector_entry,
                       const gchar *cue_str)
@@ -844,6 +1030,7 @@ set_completion_query (ENameSelectorEntry *name_selector_entry,
 	if (!cue_str) {
 		/* Clear the store */
 		e_contact_store_set_query (name_selector_entry->priv->contact_store, NULL);
+		clear_completion_cue (name_selector_entry);
 		return;
 	}
 
@@ -875,8 +1062,12 @@ set_completion_query (ENameSelectorEntry *name_selector_entry,
 	ENS_DEBUG (g_print ("%s\n", query_str));
 
 	book_query = e_book_query_from_string (query_str);
-	e_contact_store_set_query (name_selector_entry->priv->contact_store, book_query);
-	e_book_query_unref (book_query);
+	if (!book_query || !refine_completion_query (name_selector_entry, book_query, cue_str))
+		e_contact_store_set_query (name_selector_entry->priv->contact_store, book_query);
+
+	clear_completion_cue (name_selector_entry);
+	priv->completion_cue = g_strdup (cue_str);
+	priv->completion_query = book_query;  /* takes ownership */
 
 	g_free (query_str);
 }
@@ -1271,6 +1462,8 @@ clear_completion_model (ENameSelectorEntry *name_selector_entry)
 	e_contact_store_set_query (name_selector_entry->priv->contact_store, NULL);
 	g_hash_table_remove_all (name_selector_entry->priv->known_contacts);
 	priv->is_completing = FALSE;
+
+	clear_completion_cue (name_selector_entry);
 }
 
 static void
@@ -3738,6 +3931,7 @@ e_name_selector_entry_set_contact_store (ENameSelectorEntry *name_selector_entry
 	if (name_selector_entry->priv->contact_store)
 		g_object_unref (name_selector_entry->priv->contact_store);
 	name_selector_entry->priv->contact_store = contact_store;
+	clear_completion_cue (name_selector_entry);
 	if (name_selector_entry->priv->contact_store)
 		g_object_ref (name_selector_entry->priv->contact_store);
 
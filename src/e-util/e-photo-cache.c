@@ -23,13 +23,15 @@
  * #EPhotoCache finds photos associated with an email address.
  *
  * A limited internal cache is employed to speed up frequently searched
- * email addresses.  The exact caching semantics are private and subject
+ * email addresses, optionally backed by a cache on disk, so the photos
+ * survive restarts.  The exact caching semantics are private and subject
  * to change.
  **/
 
 #include "e-photo-cache.h"
 
 #include <string.h>
+#include <glib/gstdio.h>
 #include <libebackend/libebackend.h>
 
 #include <e-util/e-data-capture.h>
@@ -43,10 +45,19 @@
 #define ASYNC_TIMEOUT_SECONDS 3.0
 
 /* How many email addresses we track at once, regardless of whether
- * the email address has a photo.  As new cache entries are added, we
- * discard the least recently accessed entries to keep the cache size
- * within the limit. */
-#define MAX_CACHE_SIZE 20
+ * the email address has a photo, and how many bytes of photo data we
+ * hold at most.  As new cache entries are added, we discard the least
+ * recently accessed entries to keep the cache size within the limits.
+ * These are the defaults of the "max-entries" and "max-bytes" properties. */
+#define DEFAULT_MAX_ENTRIES 500
+#define DEFAULT_MAX_BYTES (8 * 1024 * 1024)
+
+/* How long (in seconds) to remember that an email address has no photo,
+ * before asking the photo sources again. */
+#define NO_PHOTO_TIMEOUT_SECONDS (15 * 60)
+
+/* How long (in seconds) a photo stays in the disk cache. */
+#define DISK_CACHE_MAX_AGE_SECONDS (7 * 24 * 60 * 60)
 
 #define ERROR_IS_CANCELLED(error) \
 	(g_error_matches ((error), G_IO_ERROR, G_IO_ERROR_CANCELLED))
@@ -54,6 +65,7 @@
 typedef struct _AsyncContext AsyncContext;
 typedef struct _AsyncSubtask AsyncSubtask;
 typedef struct _DataCaptureClosure DataCaptureClosure;
+typedef struct _DiskLookupData DiskLookupData;
 typedef struct _PhotoData PhotoData;
 
 struct _EPhotoCachePrivate {
@@ -63,6 +75,10 @@ struct _EPhotoCachePrivate {
 	GHashTable *photo_ht;
 	GQueue photo_ht_keys;
 	GMutex photo_ht_lock;
+	gsize photo_ht_bytes;
+	guint max_entries;
+	guint64 max_bytes;
+	gboolean use_disk_cache;
 
 	GHashTable *sources_ht;
 	GMutex sources_ht_lock;
@@ -75,6 +91,7 @@ struct _AsyncContext {
 	GQueue results;
 	GInputStream *stream;
 	GConverter *data_capture;
+	gchar *email_address;
 
 	GCancellable *cancellable;
 	gulong cancelled_handler_id;
@@ -95,15 +112,30 @@ struct _DataCaptureClosure {
 	gchar *email_address;
 };
 
+struct _DiskLookupData {
+	gchar *email_address;
+	GBytes *bytes;
+};
+
 struct _PhotoData {
 	volatile gint ref_count;
 	GMutex lock;
 	GBytes *bytes;
+
+	/* The link in the MRU queue, its data is the hash table key.
+	 * Protected by the photo_ht_lock, like the 'expires' below. */
+	GList *link;
+
+	/* Monotonic time when an entry without bytes expires. */
+	gint64 expires;
 };
 
 enum {
 	PROP_0,
-	PROP_CLIENT_CACHE
+	PROP_CLIENT_CACHE,
+	PROP_MAX_BYTES,
+	PROP_MAX_ENTRIES,
+	PROP_USE_DISK_CACHE
 };
 
 /* Forward Declarations */
@@ -276,6 +308,16 @@ async_subtask_complete (AsyncSubtask *async_subtask)
 		}
 
 		async_subtask_unref (async_subtask);
+	} else {
+		EPhotoCache *photo_cache;
+
+		/* All photo sources finished without an error and none
+		 * of them has a photo, remember that for a while. */
+		photo_cache = E_PHOTO_CACHE (
+			g_async_result_get_source_object (G_ASYNC_RESULT (simple)));
+		e_photo_cache_add_photo (
+			photo_cache, async_context->email_address, NULL);
+		g_object_unref (photo_cache);
 	}
 
 	g_simple_async_result_complete_in_idle (simple);
@@ -298,6 +340,7 @@ async_context_cancelled_cb (GCancellable *cancellable,
 
 static AsyncContext *
 async_context_new (EDataCapture *data_capture,
+                   const gchar *email_address,
                    GCancellable *cancellable)
 {
 	AsyncContext *async_context;
@@ -313,6 +356,7 @@ async_context_new (EDataCapture *data_capture,
 		(GDestroyNotify) NULL);
 
 	async_context->data_capture = g_object_ref (data_capture);
+	async_context->email_address = g_strdup (email_address);
 
 	if (G_IS_CANCELLABLE (cancellable)) {
 		gulong handler_id;
@@ -348,6 +392,7 @@ async_context_free (AsyncContext *async_context)
 	g_clear_object (&async_context->stream);
 	g_clear_object (&async_context->data_capture);
 	g_clear_object (&async_context->cancellable);
+	g_free (async_context->email_address);
 
 	g_slice_free (AsyncContext, async_context);
 }
@@ -484,6 +529,21 @@ photo_data_set_bytes (PhotoData *photo_data,
 	g_mutex_unlock (&photo_data->lock);
 }
 
+static gsize
+photo_data_get_size (PhotoData *photo_data)
+{
+	gsize size = 0;
+
+	g_mutex_lock (&photo_data->lock);
+
+	if (photo_data->bytes != NULL)
+		size = g_bytes_get_size (photo_data->bytes);
+
+	g_mutex_unlock (&photo_data->lock);
+
+	return size;
+}
+
 static gchar *
 photo_ht_normalize_key (const gchar *email_address)
 {
@@ -497,6 +557,47 @@ photo_ht_normalize_key (const gchar *email_address)
 	return collation_key;
 }
 
+/* Removes the entry for the @link from the MRU queue, with the lock held. */
+static void
+photo_ht_remove_link_locked (EPhotoCache *photo_cache,
+                             GList *link)
+{
+	PhotoData *photo_data;
+	gchar *key = link->data;
+
+	photo_data = g_hash_table_lookup (photo_cache->priv->photo_ht, key);
+	if (photo_data != NULL) {
+		photo_cache->priv->photo_ht_bytes -=
+			photo_data_get_size (photo_data);
+		photo_data->link = NULL;
+		g_hash_table_remove (photo_cache->priv->photo_ht, key);
+	}
+
+	g_queue_delete_link (&photo_cache->priv->photo_ht_keys, link);
+	g_free (key);
+}
+
+/* Discards the least recently accessed entries, with the lock held. */
+static void
+photo_ht_trim_locked (EPhotoCache *photo_cache)
+{
+	EPhotoCachePrivate *priv = photo_cache->priv;
+
+	/* Always keep the most recent entry, even when it alone
+	 * is larger than the byte limit. */
+	while (g_queue_get_length (&priv->photo_ht_keys) > 1 &&
+	       (g_queue_get_length (&priv->photo_ht_keys) > priv->max_entries ||
+		priv->photo_ht_bytes > priv->max_bytes)) {
+		photo_ht_remove_link_locked (
+			photo_cache, g_queue_peek_tail_link (&priv->photo_ht_keys));
+	}
+
+	/* Hash table and queue sizes should be equal at all times. */
+	g_warn_if_fail (
+		g_hash_table_size (priv->photo_ht) ==
+		g_queue_get_length (&priv->photo_ht_keys));
+}
+
 static void
 photo_ht_insert (EPhotoCache *photo_cache,
                  const gchar *email_address,
@@ -519,47 +620,44 @@ photo_ht_insert (EPhotoCache *photo_cache,
 	photo_data = g_hash_table_lookup (photo_ht, key);
 
 	if (photo_data != NULL) {
-		GList *link;
-
 		/* Replace the old photo data if we have new photo
 		 * data, otherwise leave the old photo data alone. */
-		if (bytes != NULL)
+		if (bytes != NULL) {
+			photo_cache->priv->photo_ht_bytes -=
+				photo_data_get_size (photo_data);
 			photo_data_set_bytes (photo_data, bytes);
+			photo_cache->priv->photo_ht_bytes +=
+				g_bytes_get_size (bytes);
+			photo_data->expires = 0;
+		}
 
 		/* Move the key to the head of the MRU queue. */
-		link = g_queue_find_custom (
-			photo_ht_keys, key,
-			(GCompareFunc) strcmp);
-		if (link != NULL) {
-			g_queue_unlink (photo_ht_keys, link);
-			g_queue_push_head_link (photo_ht_keys, link);
-		}
+		g_queue_unlink (photo_ht_keys, photo_data->link);
+		g_queue_push_head_link (photo_ht_keys, photo_data->link);
 	} else {
 		photo_data = photo_data_new (bytes);
 
+		if (bytes != NULL) {
+			photo_cache->priv->photo_ht_bytes +=
+				g_bytes_get_size (bytes);
+		} else {
+			photo_data->expires = g_get_monotonic_time () +
+				NO_PHOTO_TIMEOUT_SECONDS * G_USEC_PER_SEC;
+		}
+
 		g_hash_table_insert (
 			photo_ht, g_strdup (key),
 			photo_data_ref (photo_data));
 
 		/* Push the key to the head of the MRU queue. */
 		g_queue_push_head (photo_ht_keys, g_strdup (key));
-
-		/* Trim the cache if necessary. */
-		while (g_queue_get_length (photo_ht_keys) > MAX_CACHE_SIZE) {
-			gchar *oldest_key;
-
-			oldest_key = g_queue_pop_tail (photo_ht_keys);
-			g_hash_table_remove (photo_ht, oldest_key);
-			g_free (oldest_key);
-		}
+		photo_data->link = g_queue_peek_head_link (photo_ht_keys);
 
 		photo_data_unref (photo_data);
 	}
 
-	/* Hash table and queue sizes should be equal at all times. */
-	g_warn_if_fail (
-		g_hash_table_size (photo_ht) ==
-		g_queue_get_length (photo_ht_keys));
+	/* Trim the cache if necessary. */
+	photo_ht_trim_locked (photo_cache);
 
 	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
 
@@ -572,6 +670,7 @@ photo_ht_lookup (EPhotoCache *photo_cache,
                  GInputStream **out_stream)
 {
 	GHashTable *photo_ht;
+	GQueue *photo_ht_keys;
 	PhotoData *photo_data;
 	gboolean found = FALSE;
 	gchar *key;
@@ -580,6 +679,7 @@ photo_ht_lookup (EPhotoCache *photo_cache,
 	g_return_val_if_fail (out_stream != NULL, FALSE);
 
 	photo_ht = photo_cache->priv->photo_ht;
+	photo_ht_keys = &photo_cache->priv->photo_ht_keys;
 
 	key = photo_ht_normalize_key (email_address);
 
@@ -587,6 +687,13 @@ photo_ht_lookup (EPhotoCache *photo_cache,
 
 	photo_data = g_hash_table_lookup (photo_ht, key);
 
+	if (photo_data != NULL && photo_data->expires != 0 &&
+	    photo_data->expires < g_get_monotonic_time ()) {
+		/* Time to ask the photo sources again. */
+		photo_ht_remove_link_locked (photo_cache, photo_data->link);
+		photo_data = NULL;
+	}
+
 	if (photo_data != NULL) {
 		GBytes *bytes;
 
@@ -599,6 +706,10 @@ photo_ht_lookup (EPhotoCache *photo_cache,
 			*out_stream = NULL;
 		}
 		found = TRUE;
+
+		/* Move the key to the head of the MRU queue. */
+		g_queue_unlink (photo_ht_keys, photo_data->link);
+		g_queue_push_head_link (photo_ht_keys, photo_data->link);
 	}
 
 	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
@@ -612,38 +723,23 @@ static gboolean
 photo_ht_remove (EPhotoCache *photo_cache,
                  const gchar *email_address)
 {
-	GHashTable *photo_ht;
-	GQueue *photo_ht_keys;
+	PhotoData *photo_data;
 	gchar *key;
 	gboolean removed = FALSE;
 
 	g_return_val_if_fail (email_address != NULL, FALSE);
 
-	photo_ht = photo_cache->priv->photo_ht;
-	photo_ht_keys = &photo_cache->priv->photo_ht_keys;
-
 	key = photo_ht_normalize_key (email_address);
 
 	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
 
-	if (g_hash_table_remove (photo_ht, key)) {
-		GList *link;
+	photo_data = g_hash_table_lookup (photo_cache->priv->photo_ht, key);
 
-		link = g_queue_find_custom (
-			photo_ht_keys, key,
-			(GCompareFunc) strcmp);
-		if (link != NULL) {
-			g_free (link->data);
-			g_queue_delete_link (photo_ht_keys, link);
-			removed = TRUE;
-		}
+	if (photo_data != NULL) {
+		photo_ht_remove_link_locked (photo_cache, photo_data->link);
+		removed = TRUE;
 	}
 
-	/* Hash table and queue sizes should be equal at all times. */
-	g_warn_if_fail (
-		g_hash_table_size (photo_ht) ==
-		g_queue_get_length (photo_ht_keys));
-
 	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
 
 	g_free (key);
@@ -667,9 +763,150 @@ photo_ht_remove_all (EPhotoCache *photo_cache)
 	while (!g_queue_is_empty (photo_ht_keys))
 		g_free (g_queue_pop_head (photo_ht_keys));
 
+	photo_cache->priv->photo_ht_bytes = 0;
+
 	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
 }
 
+static void
+photo_ht_trim (EPhotoCache *photo_cache)
+{
+	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
+	photo_ht_trim_locked (photo_cache);
+	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+}
+
+/* The disk cache file name is a hash of the lowercase email address,
+ * the collation key used in memory is not suitable for a file name. */
+static gchar *
+photo_disk_build_filename (const gchar *email_address)
+{
+	gchar *lowercase_email_address;
+	gchar *checksum;
+	gchar *filename;
+
+	lowercase_email_address = g_utf8_strdown (email_address, -1);
+	checksum = g_compute_checksum_for_string (
+		G_CHECKSUM_SHA1, lowercase_email_address, -1);
+	filename = g_build_filename (
+		e_get_user_cache_dir (), "photos", checksum, NULL);
+	g_free (checksum);
+	g_free (lowercase_email_address);
+
+	return filename;
+}
+
+static GBytes *
+photo_disk_lookup (const gchar *email_address)
+{
+	GStatBuf st;
+	GBytes *bytes = NULL;
+	gchar *filename;
+	gchar *contents = NULL;
+	gsize length = 0;
+
+	filename = photo_disk_build_filename (email_address);
+
+	if (g_stat (filename, &st) == 0) {
+		if (st.st_mtime + DISK_CACHE_MAX_AGE_SECONDS < g_get_real_time () / G_USEC_PER_SEC)
+			g_unlink (filename);
+		else if (g_file_get_contents (filename, &contents, &length, NULL) && length > 0)
+			bytes = g_bytes_new_take (contents, length);
+		else
+			g_free (contents);
+	}
+
+	g_free (filename);
+
+	return bytes;
+}
+
+static DiskLookupData *
+disk_lookup_data_new (const gchar *email_address)
+{
+	DiskLookupData *lookup_data;
+
+	lookup_data = g_slice_new0 (DiskLookupData);
+	lookup_data->email_address = g_strdup (email_address);
+
+	return lookup_data;
+}
+
+static void
+disk_lookup_data_free (DiskLookupData *lookup_data)
+{
+	if (lookup_data->bytes != NULL)
+		g_bytes_unref (lookup_data->bytes);
+
+	g_free (lookup_data->email_address);
+
+	g_slice_free (DiskLookupData, lookup_data);
+}
+
+/* Runs in a worker thread. */
+static void
+photo_disk_lookup_thread (GSimpleAsyncResult *simple,
+                          GObject *source_object,
+                          GCancellable *cancellable)
+{
+	DiskLookupData *lookup_data;
+
+	lookup_data = g_simple_async_result_get_op_res_gpointer (simple);
+
+	if (!g_cancellable_is_cancelled (cancellable))
+		lookup_data->bytes = photo_disk_lookup (lookup_data->email_address);
+}
+
+static void
+photo_disk_store_done_cb (GObject *source_object,
+                          GAsyncResult *result,
+                          gpointer user_data)
+{
+	GError *local_error = NULL;
+
+	if (!g_file_replace_contents_finish (G_FILE (source_object), result, NULL, &local_error)) {
+		g_warning (
+			"%s: Failed to store photo: %s",
+			G_STRFUNC, local_error ? local_error->message : "Unknown error");
+		g_clear_error (&local_error);
+	}
+}
+
+static void
+photo_disk_store (const gchar *email_address,
+                  GBytes *bytes)
+{
+	GFile *file;
+	gchar *filename;
+	gchar *dirname;
+
+	filename = photo_disk_build_filename (email_address);
+
+	dirname = g_path_get_dirname (filename);
+	g_mkdir_with_parents (dirname, 0700);
+	g_free (dirname);
+
+	file = g_file_new_for_path (filename);
+
+	g_file_replace_contents_bytes_async (
+		file, bytes, NULL, FALSE,
+		G_FILE_CREATE_PRIVATE | G_FILE_CREATE_REPLACE_DESTINATION,
+		NULL, photo_disk_store_done_cb, NULL);
+
+	g_object_unref (file);
+	g_free (filename);
+}
+
+static void
+photo_disk_remove (const gchar *email_address)
+{
+	gchar *filename;
+
+	filename = photo_disk_build_filename (email_address);
+	g_unlink (filename);
+	g_free (filename);
+}
+
 static void
 photo_cache_data_captured_cb (EDataCapture *data_capture,
                               GBytes *bytes,
@@ -704,6 +941,89 @@ photo_cache_async_subtask_done_cb (GObject *source_object,
 	async_subtask_unref (async_subtask);
 }
 
+static void
+photo_cache_dispatch_subtasks (EPhotoCache *photo_cache,
+                               GSimpleAsyncResult *simple)
+{
+	AsyncContext *async_context;
+	GList *list, *link;
+
+	async_context = g_simple_async_result_get_op_res_gpointer (simple);
+
+	list = e_photo_cache_list_photo_sources (photo_cache);
+
+	if (list == NULL) {
+		g_simple_async_result_complete_in_idle (simple);
+		return;
+	}
+
+	g_mutex_lock (&async_context->lock);
+
+	/* Dispatch a subtask for each photo source. */
+	for (link = list; link != NULL; link = g_list_next (link)) {
+		EPhotoSource *photo_source;
+		AsyncSubtask *async_subtask;
+
+		photo_source = E_PHOTO_SOURCE (link->data);
+		async_subtask = async_subtask_new (photo_source, simple);
+
+		g_hash_table_add (
+			async_context->subtasks,
+			async_subtask_ref (async_subtask));
+
+		e_photo_source_get_photo (
+			photo_source, async_context->email_address,
+			async_subtask->cancellable,
+			photo_cache_async_subtask_done_cb,
+			async_subtask_ref (async_subtask));
+
+		async_subtask_unref (async_subtask);
+	}
+
+	g_mutex_unlock (&async_context->lock);
+
+	g_list_free_full (list, (GDestroyNotify) g_object_unref);
+
+	/* Check if we were cancelled while dispatching subtasks. */
+	if (g_cancellable_is_cancelled (async_context->cancellable))
+		async_context_cancel_subtasks (async_context);
+}
+
+static void
+photo_cache_disk_lookup_done_cb (GObject *source_object,
+                                 GAsyncResult *result,
+                                 gpointer user_data)
+{
+	GSimpleAsyncResult *simple = user_data;
+	GSimpleAsyncResult *lookup;
+	EPhotoCache *photo_cache;
+	AsyncContext *async_context;
+	DiskLookupData *lookup_data;
+	GError *local_error = NULL;
+
+	photo_cache = E_PHOTO_CACHE (source_object);
+	async_context = g_simple_async_result_get_op_res_gpointer (simple);
+
+	lookup = G_SIMPLE_ASYNC_RESULT (result);
+	lookup_data = g_simple_async_result_get_op_res_gpointer (lookup);
+
+	if (g_simple_async_result_propagate_error (lookup, &local_error)) {
+		g_simple_async_result_take_error (simple, local_error);
+		g_simple_async_result_complete (simple);
+	} else if (lookup_data->bytes != NULL) {
+		photo_ht_insert (
+			photo_cache, async_context->email_address,
+			lookup_data->bytes);
+		async_context->stream =
+			g_memory_input_stream_new_from_bytes (lookup_data->bytes);
+		g_simple_async_result_complete (simple);
+	} else {
+		photo_cache_dispatch_subtasks (photo_cache, simple);
+	}
+
+	g_object_unref (simple);
+}
+
 static void
 photo_cache_set_client_cache (EPhotoCache *photo_cache,
                               EClientCache *client_cache)
@@ -726,6 +1046,24 @@ photo_cache_set_property (GObject *object,
 				E_PHOTO_CACHE (object),
 				g_value_get_object (value));
 			return;
+
+		case PROP_MAX_BYTES:
+			e_photo_cache_set_max_bytes (
+				E_PHOTO_CACHE (object),
+				g_value_get_uint64 (value));
+			return;
+
+		case PROP_MAX_ENTRIES:
+			e_photo_cache_set_max_entries (
+				E_PHOTO_CACHE (object),
+				g_value_get_uint (value));
+			return;
+
+		case PROP_USE_DISK_CACHE:
+			e_photo_cache_set_use_disk_cache (
+				E_PHOTO_CACHE (object),
+				g_value_get_boolean (value));
+			return;
 	}
 
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -744,6 +1082,27 @@ photo_cache_get_property (GObject *object,
 				e_photo_cache_ref_client_cache (
 				E_PHOTO_CACHE (object)));
 			return;
+
+		case PROP_MAX_BYTES:
+			g_value_set_uint64 (
+				value,
+				e_photo_cache_get_max_bytes (
+				E_PHOTO_CACHE (object)));
+			return;
+
+		case PROP_MAX_ENTRIES:
+			g_value_set_uint (
+				value,
+				e_photo_cache_get_max_entries (
+				E_PHOTO_CACHE (object)));
+			return;
+
+		case PROP_USE_DISK_CACHE:
+			g_value_set_boolean (
+				value,
+				e_photo_cache_get_use_disk_cache (
+				E_PHOTO_CACHE (object)));
+			return;
 	}
 
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -822,6 +1181,55 @@ e_photo_cache_class_init (EPhotoCacheClass *class)
 			G_PARAM_READWRITE |
 			G_PARAM_CONSTRUCT_ONLY |
 			G_PARAM_STATIC_STRINGS));
+
+	/**
+	 * EPhotoCache:max-bytes:
+	 *
+	 * How many bytes of photo data to keep in memory at most.
+	 **/
+	g_object_class_install_property (
+		object_class,
+		PROP_MAX_BYTES,
+		g_param_spec_uint64 (
+			"max-bytes",
+			"Max Bytes",
+			"How many bytes of photo data to keep in memory at most",
+			0, G_MAXUINT64, DEFAULT_MAX_BYTES,
+			G_PARAM_READWRITE |
+			G_PARAM_STATIC_STRINGS));
+
+	/**
+	 * EPhotoCache:max-entries:
+	 *
+	 * How many email addresses to keep in memory at most,
+	 * regardless of whether they have a photo.
+	 **/
+	g_object_class_install_property (
+		object_class,
+		PROP_MAX_ENTRIES,
+		g_param_spec_uint (
+			"max-entries",
+			"Max Entries",
+			"How many email addresses to keep in memory at most",
+			1, G_MAXUINT, DEFAULT_MAX_ENTRIES,
+			G_PARAM_READWRITE |
+			G_PARAM_STATIC_STRINGS));
+
+	/**
+	 * EPhotoCache:use-disk-cache:
+	 *
+	 * Whether to also store the found photos on disk.
+	 **/
+	g_object_class_install_property (
+		object_class,
+		PROP_USE_DISK_CACHE,
+		g_param_spec_boolean (
+			"use-disk-cache",
+			"Use Disk Cache",
+			"Whether to also store the found photos on disk",
+			FALSE,
+			G_PARAM_READWRITE |
+			G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -846,6 +1254,8 @@ e_photo_cache_init (EPhotoCache *photo_cache)
 	photo_cache->priv->main_context = g_main_context_ref_thread_default ();
 	photo_cache->priv->photo_ht = photo_ht;
 	photo_cache->priv->sources_ht = sources_ht;
+	photo_cache->priv->max_entries = DEFAULT_MAX_ENTRIES;
+	photo_cache->priv->max_bytes = DEFAULT_MAX_BYTES;
 
 	g_mutex_init (&photo_cache->priv->photo_ht_lock);
 	g_mutex_init (&photo_cache->priv->sources_ht_lock);
@@ -981,6 +1391,132 @@ e_photo_cache_remove_photo_source (EPhotoCache *photo_cache,
 	return removed;
 }
 
+/**
+ * e_photo_cache_get_max_bytes:
+ * @photo_cache: an #EPhotoCache
+ *
+ * Returns how many bytes of photo data @photo_cache keeps in memory at most.
+ *
+ * Returns: the memory limit, in bytes
+ **/
+guint64
+e_photo_cache_get_max_bytes (EPhotoCache *photo_cache)
+{
+	g_return_val_if_fail (E_IS_PHOTO_CACHE (photo_cache), 0);
+
+	return photo_cache->priv->max_bytes;
+}
+
+/**
+ * e_photo_cache_set_max_bytes:
+ * @photo_cache: an #EPhotoCache
+ * @max_bytes: the memory limit, in bytes
+ *
+ * Sets how many bytes of photo data @photo_cache keeps in memory at most.
+ * The least recently used entries are discarded to fit the new limit.
+ **/
+void
+e_photo_cache_set_max_bytes (EPhotoCache *photo_cache,
+                             guint64 max_bytes)
+{
+	g_return_if_fail (E_IS_PHOTO_CACHE (photo_cache));
+
+	if (photo_cache->priv->max_bytes == max_bytes)
+		return;
+
+	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
+	photo_cache->priv->max_bytes = max_bytes;
+	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+
+	photo_ht_trim (photo_cache);
+
+	g_object_notify (G_OBJECT (photo_cache), "max-bytes");
+}
+
+/**
+ * e_photo_cache_get_max_entries:
+ * @photo_cache: an #EPhotoCache
+ *
+ * Returns how many email addresses @photo_cache keeps in memory at most,
+ * regardless of whether they have a photo.
+ *
+ * Returns: the maximum number of entries
+ **/
+guint
+e_photo_cache_get_max_entries (EPhotoCache *photo_cache)
+{
+	g_return_val_if_fail (E_IS_PHOTO_CACHE (photo_cache), 0);
+
+	return photo_cache->priv->max_entries;
+}
+
+/**
+ * e_photo_cache_set_max_entries:
+ * @photo_cache: an #EPhotoCache
+ * @max_entries: the maximum number of entries
+ *
+ * Sets how many email addresses @photo_cache keeps in memory at most,
+ * regardless of whether they have a photo.  The least recently used
+ * entries are discarded to fit the new limit.
+ **/
+void
+e_photo_cache_set_max_entries (EPhotoCache *photo_cache,
+                               guint max_entries)
+{
+	g_return_if_fail (E_IS_PHOTO_CACHE (photo_cache));
+	g_return_if_fail (max_entries > 0);
+
+	if (photo_cache->priv->max_entries == max_entries)
+		return;
+
+	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
+	photo_cache->priv->max_entries = max_entries;
+	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+
+	photo_ht_trim (photo_cache);
+
+	g_object_notify (G_OBJECT (photo_cache), "max-entries");
+}
+
+/**
+ * e_photo_cache_get_use_disk_cache:
+ * @photo_cache: an #EPhotoCache
+ *
+ * Returns whether @photo_cache also stores the found photos on disk,
+ * thus they are available after a restart without consulting
+ * the photo sources.
+ *
+ * Returns: whether the disk cache is used
+ **/
+gboolean
+e_photo_cache_get_use_disk_cache (EPhotoCache *photo_cache)
+{
+	g_return_val_if_fail (E_IS_PHOTO_CACHE (photo_cache), FALSE);
+
+	return photo_cache->priv->use_disk_cache;
+}
+
+/**
+ * e_photo_cache_set_use_disk_cache:
+ * @photo_cache: an #EPhotoCache
+ * @use_disk_cache: whether to use the disk cache
+ *
+ * Sets whether @photo_cache also stores the found photos on disk.
+ **/
+void
+e_photo_cache_set_use_disk_cache (EPhotoCache *photo_cache,
+                                  gboolean use_disk_cache)
+{
+	g_return_if_fail (E_IS_PHOTO_CACHE (photo_cache));
+
+	if (photo_cache->priv->use_disk_cache == use_disk_cache)
+		return;
+
+	photo_cache->priv->use_disk_cache = use_disk_cache;
+
+	g_object_notify (G_OBJECT (photo_cache), "use-disk-cache");
+}
+
 /**
  * e_photo_cache_add_photo:
  * @photo_cache: an #EPhotoCache
@@ -993,7 +1529,7 @@ e_photo_cache_remove_photo_source (EPhotoCache *photo_cache,
  *
  * The @bytes argument can also be %NULL to indicate no photo is available for
  * @email_address.  Subsequent photo requests for @email_address will yield no
- * input stream.
+ * input stream for a limited time.
  *
  * The entry may be removed without notice however, subject to @photo_cache's
  * internal caching policy.
@@ -1007,6 +1543,9 @@ e_photo_cache_add_photo (EPhotoCache *photo_cache,
 	g_return_if_fail (email_address != NULL);
 
 	photo_ht_insert (photo_cache, email_address, bytes);
+
+	if (bytes != NULL && e_photo_cache_get_use_disk_cache (photo_cache))
+		photo_disk_store (email_address, bytes);
 }
 
 /**
@@ -1014,7 +1553,8 @@ e_photo_cache_add_photo (EPhotoCache *photo_cache,
  * @photo_cache: an #EPhotoCache
  * @email_address: an email address
  *
- * Removes the cache entry for @email_address, if such an entry exists.
+ * Removes the cache entry for @email_address, if such an entry exists,
+ * also from the disk cache.
  *
  * Returns: %TRUE if a cache entry was found and removed
  **/
@@ -1025,6 +1565,9 @@ e_photo_cache_remove_photo (EPhotoCache *photo_cache,
 	g_return_val_if_fail (E_IS_PHOTO_CACHE (photo_cache), FALSE);
 	g_return_val_if_fail (email_address != NULL, FALSE);
 
+	if (e_photo_cache_get_use_disk_cache (photo_cache))
+		photo_disk_remove (email_address);
+
 	return photo_ht_remove (photo_cache, email_address);
 }
 
@@ -1101,7 +1644,6 @@ e_photo_cache_get_photo (EPhotoCache *photo_cache,
 	AsyncContext *async_context;
 	EDataCapture *data_capture;
 	GInputStream *stream = NULL;
-	GList *list, *link;
 
 	g_return_if_fail (E_IS_PHOTO_CACHE (photo_cache));
 	g_return_if_fail (email_address != NULL);
@@ -1116,7 +1658,7 @@ e_photo_cache_get_photo (EPhotoCache *photo_cache,
 		data_capture_closure_new (photo_cache, email_address),
 		(GClosureNotify) data_capture_closure_free, 0);
 
-	async_context = async_context_new (data_capture, cancellable);
+	async_context = async_context_new (data_capture, email_address, cancellable);
 
 	simple = g_simple_async_result_new (
 		G_OBJECT (photo_cache), callback,
@@ -1134,43 +1676,34 @@ e_photo_cache_get_photo (EPhotoCache *photo_cache,
 		goto exit;
 	}
 
-	list = e_photo_cache_list_photo_sources (photo_cache);
-
-	if (list == NULL) {
-		g_simple_async_result_complete_in_idle (simple);
-		goto exit;
-	}
-
-	g_mutex_lock (&async_context->lock);
+	/* Check if we have a photo from a previous session.  The disk is
+	 * read in a worker thread, the photo sources are asked only when
+	 * it has nothing. */
+	if (e_photo_cache_get_use_disk_cache (photo_cache)) {
+		GSimpleAsyncResult *lookup;
 
-	/* Dispatch a subtask for each photo source. */
-	for (link = list; link != NULL; link = g_list_next (link)) {
-		EPhotoSource *photo_source;
-		AsyncSubtask *async_subtask;
+		lookup = g_simple_async_result_new (
+			G_OBJECT (photo_cache),
+			photo_cache_disk_lookup_done_cb,
+			g_object_ref (simple),
+			photo_disk_lookup_thread);
 
-		photo_source = E_PHOTO_SOURCE (link->data);
-		async_subtask = async_subtask_new (photo_source, simple);
+		/* Completes the lookup with an error when cancelled. */
+		g_simple_async_result_set_check_cancellable (lookup, cancellable);
 
-		g_hash_table_add (
-			async_context->subtasks,
-			async_subtask_ref (async_subtask));
+		g_simple_async_result_set_op_res_gpointer (
+			lookup, disk_lookup_data_new (email_address),
+			(GDestroyNotify) disk_lookup_data_free);
 
-		e_photo_source_get_photo (
-			photo_source, email_address,
-			async_subtask->cancellable,
-			photo_cache_async_subtask_done_cb,
-			async_subtask_ref (async_subtask));
+		g_simple_async_result_run_in_thread (
+			lookup, photo_disk_lookup_thread,
+			G_PRIORITY_DEFAULT, cancellable);
 
-		async_subtask_unref (async_subtask);
+		g_object_unref (lookup);
+		goto exit;
 	}
 
-	g_mutex_unlock (&async_context->lock);
-
-	g_list_free_full (list, (GDestroyNotify) g_object_unref);
-
-	/* Check if we were cancelled while dispatching subtasks. */
-	if (g_cancellable_is_cancelled (cancellable))
-		async_context_cancel_subtasks (async_context);
+	photo_cache_dispatch_subtasks (photo_cache, simple);
 
 exit:
 	g_object_unref (simple);
@@ -76,6 +76,17 @@ GList *		e_photo_cache_list_photo_sources
 gboolean	e_photo_cache_remove_photo_source
 						(EPhotoCache *photo_cache,
 						 EPhotoSource *photo_source);
+guint64		e_photo_cache_get_max_bytes	(EPhotoCache *photo_cache);
+void		e_photo_cache_set_max_bytes	(EPhotoCache *photo_cache,
+						 guint64 max_bytes);
+guint		e_photo_cache_get_max_entries	(EPhotoCache *photo_cache);
+void		e_photo_cache_set_max_entries	(EPhotoCache *photo_cache,
+						 guint max_entries);
+gboolean	e_photo_cache_get_use_disk_cache
+						(EPhotoCache *photo_cache);
+void		e_photo_cache_set_use_disk_cache
+						(EPhotoCache *photo_cache,
+						 gboolean use_disk_cache);
 void		e_photo_cache_add_photo		(EPhotoCache *photo_cache,
 						 const gchar *email_address,
 						 GBytes *bytes);
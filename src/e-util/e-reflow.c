@@ -53,6 +53,10 @@ static void e_reflow_resize_children (GnomeCanvasItem *item);
 #define E_REFLOW_BORDER_WIDTH 7
 #define E_REFLOW_FULL_GUTTER (E_REFLOW_DIVIDER_WIDTH + E_REFLOW_BORDER_WIDTH * 2)
 
+/* Items are measured only when they are about to be shown;
+ * until then an average of the measured heights is used. */
+#define E_REFLOW_HEIGHT_UNKNOWN (-1)
+
 G_DEFINE_TYPE (EReflow, e_reflow, GNOME_TYPE_CANVAS_GROUP)
 
 enum {
@@ -90,6 +94,58 @@ er_compare (gint i1,
 	return e_reflow_model_compare (reflow->model, i1, i2, cmp_cache);
 }
 
+static void
+er_forget_height (EReflow *reflow,
+                  gint unsorted)
+{
+	if (reflow->heights[unsorted] != E_REFLOW_HEIGHT_UNKNOWN) {
+		reflow->measured_heights_sum -= reflow->heights[unsorted];
+		reflow->measured_heights_count--;
+		reflow->heights[unsorted] = E_REFLOW_HEIGHT_UNKNOWN;
+	}
+}
+
+/* Returns whether the height was not known before */
+static gboolean
+er_measure_height (EReflow *reflow,
+                   gint unsorted)
+{
+	gint height;
+
+	if (reflow->heights[unsorted] != E_REFLOW_HEIGHT_UNKNOWN || !reflow->model)
+		return FALSE;
+
+	height = e_reflow_model_height (reflow->model, unsorted, GNOME_CANVAS_GROUP (reflow));
+
+	reflow->heights[unsorted] = height;
+	reflow->measured_heights_sum += height;
+	reflow->measured_heights_count++;
+
+	return TRUE;
+}
+
+static gint
+er_estimated_height (EReflow *reflow)
+{
+	if (reflow->measured_heights_count == 0 && reflow->count > 0)
+		er_measure_height (reflow, 0);
+
+	if (reflow->measured_heights_count == 0)
+		return 0;
+
+	return reflow->measured_heights_sum / reflow->measured_heights_count;
+}
+
+static gint
+er_get_height (EReflow *reflow,
+               gint unsorted)
+{
+	if (reflow->heights[unsorted] == E_REFLOW_HEIGHT_UNKNOWN)
+		return er_estimated_height (reflow);
+
+	return reflow->heights[unsorted];
+}
+
 static gint
 e_reflow_pick_line (EReflow *reflow,
                     gdouble x)
@@ -297,6 +353,28 @@ incarnate (EReflow *reflow)
 
 	for (i = first_cell; i < last_cell; i++) {
 		gint unsorted = e_sorter_sorted_to_model (E_SORTER (reflow->sorter), i);
+		gint estimated_height = er_get_height (reflow, unsorted);
+
+		/* The columns were laid out with an estimated height,
+		 * thus reflow them from here on when it was wrong. */
+		if (er_measure_height (reflow, unsorted) &&
+		    reflow->heights[unsorted] != estimated_height &&
+		    (!reflow->need_reflow_columns || reflow->reflow_from_column != -1)) {
+			gint c;
+
+			for (c = reflow->column_count - 1; c >= 0; c--) {
+				if (reflow->columns[c] <= i) {
+					if (reflow->reflow_from_column == -1
+					    || reflow->reflow_from_column > c) {
+						reflow->reflow_from_column = c;
+					}
+					break;
+				}
+			}
+
+			reflow->need_reflow_columns = TRUE;
+		}
+
 		if (reflow->items[unsorted] == NULL) {
 			if (reflow->model) {
 				reflow->items[unsorted] = e_reflow_model_incarnate (reflow->model, unsorted, GNOME_CANVAS_GROUP (reflow));
@@ -309,6 +387,9 @@ incarnate (EReflow *reflow)
 		}
 	}
 	reflow->incarnate_idle_id = 0;
+
+	if (reflow->need_reflow_columns)
+		e_canvas_item_request_reflow (GNOME_CANVAS_ITEM (reflow));
 }
 
 static gboolean
@@ -358,12 +439,14 @@ reflow_columns (EReflow *reflow)
 	count = reflow->count - start;
 	for (i = start; i < count; i++) {
 		gint unsorted = e_sorter_sorted_to_model (E_SORTER (reflow->sorter), i);
-		if (i != 0 && running_height + reflow->heights[unsorted] + E_REFLOW_BORDER_WIDTH > reflow->height) {
+		gint height = er_get_height (reflow, unsorted);
+
+		if (i != 0 && running_height + height + E_REFLOW_BORDER_WIDTH > reflow->height) {
 			list = g_slist_prepend (list, GINT_TO_POINTER (i));
 			column_count++;
-			running_height = E_REFLOW_BORDER_WIDTH * 2 + reflow->heights[unsorted];
+			running_height = E_REFLOW_BORDER_WIDTH * 2 + height;
 		} else
-			running_height += reflow->heights[unsorted] + E_REFLOW_BORDER_WIDTH;
+			running_height += height + E_REFLOW_BORDER_WIDTH;
 	}
 
 	reflow->column_count = column_count;
@@ -393,9 +476,12 @@ item_changed (EReflowModel *model,
 	if (i < 0 || i >= reflow->count)
 		return;
 
-	reflow->heights[i] = e_reflow_model_height (reflow->model, i, GNOME_CANVAS_GROUP (reflow));
-	if (reflow->items[i] != NULL)
+	/* Measure only shown items, the rest is measured once it's shown */
+	er_forget_height (reflow, i);
+	if (reflow->items[i] != NULL) {
+		er_measure_height (reflow, i);
 		e_reflow_model_reincarnate (model, i, reflow->items[i]);
+	}
 	e_sorter_array_clean (reflow->sorter);
 	reflow->reflow_from_column = -1;
 	reflow->need_reflow_columns = TRUE;
@@ -429,6 +515,8 @@ item_removed (EReflowModel *model,
 	if (reflow->items[i])
 		g_object_run_dispose (G_OBJECT (reflow->items[i]));
 
+	er_forget_height (reflow, i);
+
 	memmove (reflow->heights + i, reflow->heights + i + 1, (reflow->count - i - 1) * sizeof (gint));
 	memmove (reflow->items + i, reflow->items + i + 1, (reflow->count - i - 1) * sizeof (GnomeCanvasItem *));
 
@@ -471,7 +559,7 @@ items_inserted (EReflowModel *model,
 	memmove (reflow->items + position + count, reflow->items + position, (reflow->count - position - count) * sizeof (GnomeCanvasItem *));
 	for (i = position; i < position + count; i++) {
 		reflow->items[i] = NULL;
-		reflow->heights[i] = e_reflow_model_height (reflow->model, i, GNOME_CANVAS_GROUP (reflow));
+		reflow->heights[i] = E_REFLOW_HEIGHT_UNKNOWN;
 	}
 
 	e_selection_model_simple_set_row_count (E_SELECTION_MODEL_SIMPLE (reflow->selection), reflow->count);
@@ -523,11 +611,13 @@ model_changed (EReflowModel *model,
 	reflow->allocated_count = reflow->count;
 	reflow->items = g_new (GnomeCanvasItem *, reflow->count);
 	reflow->heights = g_new (int, reflow->count);
+	reflow->measured_heights_sum = 0;
+	reflow->measured_heights_count = 0;
 
 	count = reflow->count;
 	for (i = 0; i < count; i++) {
 		reflow->items[i] = NULL;
-		reflow->heights[i] = e_reflow_model_height (reflow->model, i, GNOME_CANVAS_GROUP (reflow));
+		reflow->heights[i] = E_REFLOW_HEIGHT_UNKNOWN;
 	}
 
 	e_selection_model_simple_set_row_count (E_SELECTION_MODEL_SIMPLE (reflow->selection), count);
@@ -1490,7 +1580,7 @@ e_reflow_reflow (GnomeCanvasItem *item,
 				GNOME_CANVAS_ITEM (reflow->items[unsorted]),
 				(gdouble) running_width,
 				(gdouble) running_height);
-			running_height += reflow->heights[unsorted] + E_REFLOW_BORDER_WIDTH;
+			running_height += er_get_height (reflow, unsorted) + E_REFLOW_BORDER_WIDTH;
 		}
 	}
 	reflow->width = running_width + reflow->column_width + E_REFLOW_BORDER_WIDTH;
@@ -1673,6 +1763,8 @@ e_reflow_init (EReflow *reflow)
 	reflow->items = NULL;
 	reflow->heights = NULL;
 	reflow->count = 0;
+	reflow->measured_heights_sum = 0;
+	reflow->measured_heights_count = 0;
 
 	reflow->columns = NULL;
 	reflow->column_count = 0;
@@ -1727,3 +1819,32 @@ e_reflow_init (EReflow *reflow)
 
 	e_canvas_item_set_reflow_callback (GNOME_CANVAS_ITEM (reflow), e_reflow_reflow);
 }
+
+/**
+ * e_reflow_get_item_height:
+ * @reflow: an #EReflow
+ * @n: index of an item in the model
+ * @out_is_estimate: (out) (allow-none): set to %TRUE, when the item was not
+ *    measured yet
+ *
+ * Returns the height of the @n-th item, as used for the layout of the columns.
+ * The items are measured only once they are shown; until then an average
+ * of the already measured items is used.
+ *
+ * Returns: height of the @n-th item, or -1 when out of range
+ **/
+gint
+e_reflow_get_item_height (EReflow *reflow,
+                          gint n,
+                          gboolean *out_is_estimate)
+{
+	g_return_val_if_fail (E_IS_REFLOW (reflow), -1);
+
+	if (n < 0 || n >= reflow->count)
+		return -1;
+
+	if (out_is_estimate)
+		*out_is_estimate = reflow->heights[n] == E_REFLOW_HEIGHT_UNKNOWN;
+
+	return er_get_height (reflow, n);
+}
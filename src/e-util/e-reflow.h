@@ -79,11 +79,14 @@ struct _EReflow {
 	guint adjustment_value_changed_id;
 	guint set_scroll_adjustments_id;
 
-	gint *heights;
+	gint *heights; /* -1 for items not measured yet */
 	GnomeCanvasItem **items;
 	gint count;
 	gint allocated_count;
 
+	gint64 measured_heights_sum;
+	gint measured_heights_count;
+
 	gint *columns;
 	gint column_count; /* Number of columnns */
 
@@ -138,6 +141,9 @@ struct _EReflowClass
  * changes.
  */
 GType    e_reflow_get_type       (void) G_GNUC_CONST;
+gint     e_reflow_get_item_height (EReflow *reflow,
+                                   gint n,
+                                   gboolean *out_is_estimate);
 
 G_END_DECLS
 
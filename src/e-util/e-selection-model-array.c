@@ -45,6 +45,8 @@ e_selection_model_array_confirm_row_count (ESelectionModelArray *esma)
 	if (esma->eba == NULL) {
 		gint row_count = e_selection_model_array_get_row_count (esma);
 		esma->eba = e_bit_array_new (row_count);
+		if (esma->use_ranges)
+			e_bit_array_set_use_ranges (esma->eba, TRUE);
 		esma->selected_row = -1;
 		esma->selected_range_end = -1;
 	}
@@ -514,6 +516,44 @@ e_selection_model_array_get_row_count (ESelectionModelArray *esma)
 		return 0;
 }
 
+/**
+ * e_selection_model_array_set_use_ranges:
+ * @esma: an #ESelectionModelArray
+ * @use_ranges: whether to store the selection as runs of rows
+ *
+ * Sets whether the selection is stored as runs of selected rows, instead
+ * of one bit per row. This makes selecting all rows or a range of rows,
+ * and inserting or deleting rows, cost proportionally to the number of
+ * the runs, which suits large tables, where the selection is usually
+ * made of a few contiguous blocks. See e_bit_array_set_use_ranges().
+ **/
+void
+e_selection_model_array_set_use_ranges (ESelectionModelArray *esma,
+                                        gboolean use_ranges)
+{
+	g_return_if_fail (E_IS_SELECTION_MODEL_ARRAY (esma));
+
+	esma->use_ranges = use_ranges ? 1 : 0;
+
+	if (esma->eba)
+		e_bit_array_set_use_ranges (esma->eba, use_ranges);
+}
+
+/**
+ * e_selection_model_array_get_use_ranges:
+ * @esma: an #ESelectionModelArray
+ *
+ * Returns: whether the selection is stored as runs of selected rows;
+ *    see e_selection_model_array_set_use_ranges()
+ **/
+gboolean
+e_selection_model_array_get_use_ranges (ESelectionModelArray *esma)
+{
+	g_return_val_if_fail (E_IS_SELECTION_MODEL_ARRAY (esma), FALSE);
+
+	return esma->use_ranges;
+}
+
 static void
 e_selection_model_array_init (ESelectionModelArray *esma)
 {
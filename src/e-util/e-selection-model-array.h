@@ -80,6 +80,7 @@ struct _ESelectionModelArray {
 	guint frozen : 1;
 	guint selection_model_changed : 1;
 	guint group_info_changed : 1;
+	guint use_ranges : 1;
 };
 
 struct _ESelectionModelArrayClass {
@@ -107,6 +108,11 @@ void		e_selection_model_array_confirm_row_count
 					(ESelectionModelArray *selection);
 gint		e_selection_model_array_get_row_count
 					(ESelectionModelArray *selection);
+void		e_selection_model_array_set_use_ranges
+					(ESelectionModelArray *selection,
+					 gboolean use_ranges);
+gboolean	e_selection_model_array_get_use_ranges
+					(ESelectionModelArray *selection);
 
 G_END_DECLS
 
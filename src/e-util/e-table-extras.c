@@ -186,21 +186,8 @@ e_table_str_case_compare (gconstpointer x,
 			return x ? -1 : 1;
 	}
 
-	#define prepare_value(_z, _cz) \
-		_cz = e_table_sorting_utils_lookup_cmp_cache (cmp_cache, _z); \
-		if (!_cz) { \
-			gchar *tmp = g_utf8_casefold (_z, -1); \
-			_cz = g_utf8_collate_key (tmp, -1); \
-			g_free (tmp); \
- \
-			e_table_sorting_utils_add_to_cmp_cache ( \
-				cmp_cache, _z, (gchar *) _cz); \
-		}
-
-	prepare_value (x, cx);
-	prepare_value (y, cy);
-
-	#undef prepare_value
+	cx = e_table_sorting_utils_get_collate_key (cmp_cache, x, TRUE);
+	cy = e_table_sorting_utils_get_collate_key (cmp_cache, y, TRUE);
 
 	return strcmp (cx, cy);
 }
@@ -222,19 +209,8 @@ e_table_collate_compare (gconstpointer x,
 			return x ? -1 : 1;
 	}
 
-	#define prepare_value(_z, _cz) \
-		_cz = e_table_sorting_utils_lookup_cmp_cache (cmp_cache, _z); \
-		if (!_cz) { \
-			_cz = g_utf8_collate_key (_z, -1); \
- \
-			e_table_sorting_utils_add_to_cmp_cache ( \
-				cmp_cache, _z, (gchar *) _cz); \
-		}
-
-	prepare_value (x, cx);
-	prepare_value (y, cy);
-
-	#undef prepare_value
+	cx = e_table_sorting_utils_get_collate_key (cmp_cache, x, FALSE);
+	cy = e_table_sorting_utils_get_collate_key (cmp_cache, y, FALSE);
 
 	return strcmp (cx, cy);
 }
@@ -686,6 +686,112 @@ eti_remove_header_model (ETableItem *eti)
 	eti->header = NULL;
 }
 
+static void
+eti_height_tree_free (ETableItem *eti)
+{
+	g_free (eti->height_tree);
+	eti->height_tree = NULL;
+	eti->height_tree_rows = 0;
+}
+
+static void
+eti_height_tree_add (ETableItem *eti,
+                     gint row,
+                     gint delta)
+{
+	gint ii;
+
+	for (ii = row + 1; ii <= eti->height_tree_rows; ii += ii & (-ii))
+		eti->height_tree[ii] += delta;
+}
+
+/* Returns the height of the rows [0, @rows) */
+static gint
+eti_height_tree_prefix (ETableItem *eti,
+                        gint rows)
+{
+	gint ii, sum = 0;
+
+	for (ii = MIN (rows, eti->height_tree_rows); ii > 0; ii -= ii & (-ii))
+		sum += eti->height_tree[ii];
+
+	return sum;
+}
+
+/* Returns the first row which ends at or after @y, counted from the top
+ * of the first row, and sets @row_start to where this row begins. */
+static gint
+eti_height_tree_find (ETableItem *eti,
+                      gint y,
+                      gint *row_start)
+{
+	gint pos = 0, sum = 0, step = 1;
+
+	while (step * 2 <= eti->height_tree_rows)
+		step *= 2;
+
+	for (; step > 0; step /= 2) {
+		if (pos + step <= eti->height_tree_rows && sum + eti->height_tree[pos + step] < y) {
+			pos += step;
+			sum += eti->height_tree[pos];
+		}
+	}
+
+	*row_start = sum;
+
+	return pos;
+}
+
+/*
+ * eti_height_tree_ensure:
+ *
+ * Makes sure the height tree is up to date when it should be used, which
+ * is when the rows do not have uniform height and there are more of them
+ * than the length_threshold. Returns whether the tree can be used.
+ */
+static gboolean
+eti_height_tree_ensure (ETableItem *eti)
+{
+	gint height_extra = eti->horizontal_draw_grid ? 1 : 0;
+	gint estimate, ii;
+
+	if (eti->uniform_row_height || eti->length_threshold == -1 ||
+	    eti->rows <= eti->length_threshold) {
+		if (eti->height_tree)
+			eti_height_tree_free (eti);
+		return FALSE;
+	}
+
+	if (eti->height_tree &&
+	    eti->height_tree_rows == eti->rows &&
+	    eti->height_tree_extra == height_extra)
+		return TRUE;
+
+	eti_height_tree_free (eti);
+
+	/* This can reset the height cache, thus do it before the tree is built. */
+	estimate = ETI_ROW_HEIGHT (eti, 0);
+
+	eti->height_tree = g_new0 (gint, eti->rows + 1);
+	eti->height_tree_rows = eti->rows;
+	eti->height_tree_estimate = estimate;
+	eti->height_tree_extra = height_extra;
+
+	for (ii = 1; ii <= eti->rows; ii++) {
+		gint parent = ii + (ii & (-ii));
+
+		if (eti->height_cache && eti->height_cache[ii - 1] != -1)
+			eti->height_tree[ii] += eti->height_cache[ii - 1] + height_extra;
+		else
+			eti->height_tree[ii] += estimate + height_extra;
+
+		if (parent <= eti->rows)
+			eti->height_tree[parent] += eti->height_tree[ii];
+	}
+
+	return TRUE;
+}
+
 /*
  * eti_row_height_real:
  *
@@ -760,6 +866,7 @@ free_height_cache (ETableItem *eti)
 			g_free (eti->height_cache);
 		eti->height_cache = NULL;
 		eti->height_cache_idle_count = 0;
+		eti_height_tree_free (eti);
 		eti->uniform_row_height_cache = -1;
 
 		if (eti->uniform_row_height && eti->height_cache_idle_id != 0) {
@@ -798,6 +905,12 @@ eti_row_height (ETableItem *eti,
 		}
 		if (eti->height_cache[row] == -1) {
 			eti->height_cache[row] = eti_row_height_real (eti, row);
+			if (eti->height_tree && row < eti->height_tree_rows) {
+				if (row == 0 && eti->height_cache[row] != eti->height_tree_estimate)
+					eti_height_tree_free (eti);
+				else
+					eti_height_tree_add (eti, row, eti->height_cache[row] - eti->height_tree_estimate);
+			}
 			if (row > 0 &&
 			    eti->length_threshold != -1 &&
 			    eti->rows > eti->length_threshold &&
@@ -839,7 +952,12 @@ eti_get_height (ETableItem *eti)
 		gint row;
 		if (eti->length_threshold != -1) {
 			if (rows > eti->length_threshold) {
-				gint row_height = ETI_ROW_HEIGHT (eti, 0);
+				gint row_height;
+
+				if (eti_height_tree_ensure (eti))
+					return eti_height_tree_prefix (eti, rows) + height_extra;
+
+				row_height = ETI_ROW_HEIGHT (eti, 0);
 				if (eti->height_cache) {
 					height = 0;
 					for (row = 0; row < rows; row++) {
@@ -907,6 +1025,12 @@ e_table_item_row_diff (ETableItem *eti,
 
 	if (eti->uniform_row_height) {
 		return ((end_row - start_row) * (ETI_ROW_HEIGHT (eti, -1) + height_extra));
+	} else if (eti_height_tree_ensure (eti)) {
+		/* Rows which were not drawn yet count with the estimated height */
+		if (end_row <= start_row)
+			return 0;
+
+		return eti_height_tree_prefix (eti, end_row) - eti_height_tree_prefix (eti, start_row);
 	} else {
 		gint row, total;
 		total = 0;
@@ -1307,6 +1431,8 @@ eti_table_model_rows_inserted (ETableModel *table_model,
 	}
 	eti->rows = e_table_model_row_count (eti->table_model);
 
+	eti_height_tree_free (eti);
+
 	if (eti->height_cache) {
 		gint i;
 		eti->height_cache = g_renew (int, eti->height_cache, eti->rows);
@@ -1340,6 +1466,8 @@ eti_table_model_rows_deleted (ETableModel *table_model,
 
 	eti->rows = e_table_model_row_count (eti->table_model);
 
+	eti_height_tree_free (eti);
+
 	if (eti->height_cache && (eti->rows > row)) {
 		memmove (eti->height_cache + row, eti->height_cache + row + count, (eti->rows - row) * sizeof (gint));
 	}
@@ -1598,6 +1726,8 @@ eti_dispose (GObject *object)
 		g_free (eti->height_cache);
 	eti->height_cache = NULL;
 
+	eti_height_tree_free (eti);
+
 	/* Chain up to parent's dispose() method. */
 	G_OBJECT_CLASS (e_table_item_parent_class)->dispose (object);
 }
@@ -1752,6 +1882,9 @@ e_table_item_init (ETableItem *eti)
 	eti->height_cache_idle_id = 0;
 	eti->height_cache_idle_count = 0;
 
+	eti->height_tree = NULL;
+	eti->height_tree_rows = 0;
+
 	eti->length_threshold = -1;
 	eti->uniform_row_height = FALSE;
 
@@ -1875,6 +2008,8 @@ eti_unrealize (GnomeCanvasItem *item)
 	eti->height_cache = NULL;
 	eti->height_cache_idle_count = 0;
 
+	eti_height_tree_free (eti);
+
 	eti_unrealize_cell_views (eti);
 
 	eti->height = 0;
@@ -1990,7 +2125,17 @@ eti_draw (GnomeCanvasItem *item,
 		first_row = -1;
 
 		y1 = y2 = floor (eti_base_y) + height_extra;
-		for (row = 0; row < rows; row++, y1 = y2) {
+		row = 0;
+
+		/* Skip the rows above the exposed area without computing their heights */
+		if (eti_height_tree_ensure (eti)) {
+			gint row_start;
+
+			row = eti_height_tree_find (eti, y - y1, &row_start);
+			y1 = y2 = y1 + row_start;
+		}
+
+		for (; row < rows; row++, y1 = y2) {
 
 			y2 += ETI_ROW_HEIGHT (eti, row) + height_extra;
 
@@ -2281,7 +2426,17 @@ find_cell (ETableItem *eti,
 		y1 = y2 = height_extra;
 		if (y < height_extra)
 			return FALSE;
-		for (row = 0; row < rows; row++, y1 = y2) {
+
+		row = 0;
+
+		if (eti_height_tree_ensure (eti)) {
+			gint row_start;
+
+			row = eti_height_tree_find (eti, (gint) ceil (y - height_extra), &row_start);
+			y1 = y2 = height_extra + row_start;
+		}
+
+		for (; row < rows; row++, y1 = y2) {
 			y2 += ETI_ROW_HEIGHT (eti, row) + height_extra;
 
 			if (y <= y2)
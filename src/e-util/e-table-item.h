@@ -149,6 +149,17 @@ struct _ETableItem {
 	gint height_cache_idle_id;
 	gint height_cache_idle_count;
 
+	/*
+	 * Fenwick tree of row heights (including the grid line), used
+	 * instead of walking all the rows when there are more rows
+	 * than length_threshold; rows with unknown height count with
+	 * the height of the first row
+	 */
+	gint *height_tree;
+	gint height_tree_rows;
+	gint height_tree_estimate;
+	gint height_tree_extra;
+
 	/*
 	 * Lengh Threshold: above this, we stop computing correctly
 	 * the size
@@ -321,6 +321,10 @@ e_table_selection_model_init (ETableSelectionModel *selection)
 	selection->cursor_id = NULL;
 
 	selection->model_changed_idle_id = 0;
+
+	/* Tables can be long and their selection is usually made of
+	 * a few blocks of rows, which the runs of rows store better. */
+	e_selection_model_array_set_use_ranges (E_SELECTION_MODEL_ARRAY (selection), TRUE);
 }
 
 static void
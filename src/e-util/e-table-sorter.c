@@ -27,6 +27,9 @@
 
 #define d(x)
 
+/* Bigger changes of the model are handled by a full sort. */
+#define INCREMENTAL_MAX_ROWS 64
+
 enum {
 	PROP_0,
 	PROP_SORT_INFO
@@ -63,17 +66,12 @@ qsort_callback (gconstpointer data1,
 	gint row1 = *(gint *) data1;
 	gint row2 = *(gint *) data2;
 	gint j;
-	gint sort_count;
 	gint comp_val = 0;
 	gint ascending = 1;
 
-	sort_count =
-		e_table_sort_info_sorting_get_count (
-			qd->table_sorter->sort_info) +
-		e_table_sort_info_grouping_get_count (
-			qd->table_sorter->sort_info);
-
-	for (j = 0; j < sort_count; j++) {
+	/* This can be called from the parallel sort threads, thus
+	 * use only what had been gathered into the qsort_data. */
+	for (j = 0; j < qd->cols; j++) {
 		comp_val = (*(qd->compare[j]))(qd->vals[qd->cols * row1 + j], qd->vals[qd->cols * row2 + j], qd->cmp_cache);
 		ascending = qd->ascending[j];
 		if (comp_val != 0)
@@ -91,6 +89,27 @@ qsort_callback (gconstpointer data1,
 	return comp_val;
 }
 
+static gpointer
+qsort_data_dup (gconstpointer src,
+                gpointer user_data)
+{
+	struct qsort_data *qd;
+
+	qd = g_memdup (src, sizeof (struct qsort_data));
+	qd->cmp_cache = e_table_sorting_utils_create_cmp_cache ();
+
+	return qd;
+}
+
+static void
+qsort_data_free (gpointer ptr)
+{
+	struct qsort_data *qd = ptr;
+
+	e_table_sorting_utils_free_cmp_cache (qd->cmp_cache);
+	g_free (qd);
+}
+
 static void
 table_sorter_clean (ETableSorter *table_sorter)
 {
@@ -103,6 +122,46 @@ table_sorter_clean (ETableSorter *table_sorter)
 	table_sorter->needs_sorting = -1;
 }
 
+/* Grouping columns go first, then the sorting columns. */
+static gint
+table_sorter_get_n_columns (ETableSorter *table_sorter)
+{
+	return e_table_sort_info_grouping_get_count (table_sorter->sort_info) +
+		e_table_sort_info_sorting_get_count (table_sorter->sort_info);
+}
+
+static ETableCol *
+table_sorter_get_nth_column (ETableSorter *table_sorter,
+                             gint nth,
+                             GtkSortType *sort_type)
+{
+	ETableColumnSpecification *spec;
+	ETableCol *col;
+	gint group_cols;
+
+	group_cols = e_table_sort_info_grouping_get_count (table_sorter->sort_info);
+
+	if (nth < group_cols)
+		spec = e_table_sort_info_grouping_get_nth (
+			table_sorter->sort_info,
+			nth, sort_type);
+	else
+		spec = e_table_sort_info_sorting_get_nth (
+			table_sorter->sort_info,
+			nth - group_cols, sort_type);
+
+	col = e_table_header_get_column_by_spec (
+		table_sorter->full_header, spec);
+	if (col == NULL) {
+		gint last = e_table_header_count (
+			table_sorter->full_header) - 1;
+		col = e_table_header_get_column (
+			table_sorter->full_header, last);
+	}
+
+	return col;
+}
+
 static void
 table_sorter_sort (ETableSorter *table_sorter)
 {
@@ -110,16 +169,21 @@ table_sorter_sort (ETableSorter *table_sorter)
 	gint i;
 	gint j;
 	gint cols;
-	gint group_cols;
 	struct qsort_data qd;
 
-	if (table_sorter->sorted)
-		return;
-
 	rows = e_table_model_row_count (table_sorter->source);
-	group_cols = e_table_sort_info_grouping_get_count (table_sorter->sort_info);
-	cols = e_table_sort_info_sorting_get_count (table_sorter->sort_info) + group_cols;
 
+	if (table_sorter->sorted) {
+		if (table_sorter->sorted_rows == rows)
+			return;
+
+		/* Asked before the model change had been processed. */
+		table_sorter_clean (table_sorter);
+	}
+
+	cols = table_sorter_get_n_columns (table_sorter);
+
+	table_sorter->sorted_rows = rows;
 	table_sorter->sorted = g_new (int, rows);
 	for (i = 0; i < rows; i++)
 		table_sorter->sorted[i] = i;
@@ -130,30 +194,23 @@ table_sorter_sort (ETableSorter *table_sorter)
 	qd.vals = g_new (gpointer , rows * cols);
 	qd.ascending = g_new (int, cols);
 	qd.compare = g_new (GCompareDataFunc, cols);
-	qd.cmp_cache = e_table_sorting_utils_create_cmp_cache ();
+
+	/* The collate keys depend only on the compared strings, thus they
+	 * stay valid when rows change and can be reused by the next sort.
+	 * Only make sure the cache does not grow with strings the model
+	 * does not contain anymore. */
+	if (table_sorter->cmp_cache)
+		e_table_sorting_utils_prune_cmp_cache (table_sorter->cmp_cache, MAX (2 * rows * cols, 1024));
+	else
+		table_sorter->cmp_cache = e_table_sorting_utils_create_cmp_cache ();
+
+	qd.cmp_cache = table_sorter->cmp_cache;
 
 	for (j = 0; j < cols; j++) {
-		ETableColumnSpecification *spec;
 		ETableCol *col;
 		GtkSortType sort_type;
 
-		if (j < group_cols)
-			spec = e_table_sort_info_grouping_get_nth (
-				table_sorter->sort_info,
-				j, &sort_type);
-		else
-			spec = e_table_sort_info_sorting_get_nth (
-				table_sorter->sort_info,
-				j - group_cols, &sort_type);
-
-		col = e_table_header_get_column_by_spec (
-			table_sorter->full_header, spec);
-		if (col == NULL) {
-			gint last = e_table_header_count (
-				table_sorter->full_header) - 1;
-			col = e_table_header_get_column (
-				table_sorter->full_header, last);
-		}
+		col = table_sorter_get_nth_column (table_sorter, j, &sort_type);
 
 		for (i = 0; i < rows; i++) {
 			qd.vals[i * cols + j] = e_table_model_value_at (
@@ -165,30 +222,14 @@ table_sorter_sort (ETableSorter *table_sorter)
 		qd.ascending[j] = (sort_type == GTK_SORT_ASCENDING);
 	}
 
-	g_qsort_with_data (table_sorter->sorted, rows, sizeof (gint), qsort_callback, &qd);
+	if (!e_table_sorting_utils_parallel_sort (table_sorter->sorted, rows, qsort_callback, &qd, qsort_data_dup, qsort_data_free))
+		g_qsort_with_data (table_sorter->sorted, rows, sizeof (gint), qsort_callback, &qd);
 
 	for (j = 0; j < cols; j++) {
-		ETableColumnSpecification *spec;
 		ETableCol *col;
 		GtkSortType sort_type;
 
-		if (j < group_cols)
-			spec = e_table_sort_info_grouping_get_nth (
-				table_sorter->sort_info,
-				j, &sort_type);
-		else
-			spec = e_table_sort_info_sorting_get_nth (
-				table_sorter->sort_info,
-				j - group_cols, &sort_type);
-
-		col = e_table_header_get_column_by_spec (
-			table_sorter->full_header, spec);
-		if (col == NULL) {
-			gint last = e_table_header_count (
-				table_sorter->full_header) - 1;
-			col = e_table_header_get_column (
-				table_sorter->full_header, last);
-		}
+		col = table_sorter_get_nth_column (table_sorter, j, &sort_type);
 
 		for (i = 0; i < rows; i++) {
 			e_table_model_free_value (table_sorter->source, col->spec->model_col, qd.vals[i * cols + j]);
@@ -198,7 +239,6 @@ table_sorter_sort (ETableSorter *table_sorter)
 	g_free (qd.vals);
 	g_free (qd.ascending);
 	g_free (qd.compare);
-	e_table_sorting_utils_free_cmp_cache (qd.cmp_cache);
 }
 
 static void
@@ -206,11 +246,11 @@ table_sorter_backsort (ETableSorter *table_sorter)
 {
 	gint i, rows;
 
+	table_sorter_sort (table_sorter);
+
 	if (table_sorter->backsorted)
 		return;
 
-	table_sorter_sort (table_sorter);
-
 	rows = e_table_model_row_count (table_sorter->source);
 	table_sorter->backsorted = g_new0 (int, rows);
 
@@ -224,6 +264,123 @@ table_sorter_model_changed_cb (ETableModel *table_model,
                                ETableSorter *table_sorter)
 {
 	table_sorter_clean (table_sorter);
+
+	/* The whole content could change, drop the collate keys as well. */
+	if (table_sorter->cmp_cache)
+		e_table_sorting_utils_prune_cmp_cache (table_sorter->cmp_cache, 0);
+}
+
+/* The same order as qsort_callback(), only reading the values
+ * directly from the model, to place a few rows without a full sort. */
+static gint
+table_sorter_compare_rows (ETableSorter *table_sorter,
+                           gint row1,
+                           gint row2)
+{
+	gint j, cols;
+	gint comp_val = 0;
+	gint ascending = 1;
+
+	if (!table_sorter->cmp_cache)
+		table_sorter->cmp_cache = e_table_sorting_utils_create_cmp_cache ();
+
+	cols = table_sorter_get_n_columns (table_sorter);
+
+	for (j = 0; j < cols; j++) {
+		ETableCol *col;
+		GtkSortType sort_type;
+		gpointer value1, value2;
+
+		col = table_sorter_get_nth_column (table_sorter, j, &sort_type);
+
+		value1 = e_table_model_value_at (table_sorter->source, col->spec->model_col, row1);
+		value2 = e_table_model_value_at (table_sorter->source, col->spec->model_col, row2);
+
+		comp_val = (*col->compare) (value1, value2, table_sorter->cmp_cache);
+		ascending = (sort_type == GTK_SORT_ASCENDING);
+
+		e_table_model_free_value (table_sorter->source, col->spec->model_col, value1);
+		e_table_model_free_value (table_sorter->source, col->spec->model_col, value2);
+
+		if (comp_val != 0)
+			break;
+	}
+	if (comp_val == 0) {
+		if (row1 < row2)
+			comp_val = -1;
+		if (row1 > row2)
+			comp_val = 1;
+	}
+	if (!ascending)
+		comp_val = -comp_val;
+
+	return comp_val;
+}
+
+/* Inserts model @row into the first @n_sorted items of the sorted array,
+ * which has space for one more item. */
+static void
+table_sorter_insert_row (ETableSorter *table_sorter,
+                         gint n_sorted,
+                         gint row)
+{
+	gint *sorted = table_sorter->sorted;
+	gint lo = 0, hi = n_sorted;
+
+	while (lo < hi) {
+		gint mid = lo + (hi - lo) / 2;
+
+		if (table_sorter_compare_rows (table_sorter, sorted[mid], row) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	memmove (sorted + lo + 1, sorted + lo, sizeof (gint) * (n_sorted - lo));
+	sorted[lo] = row;
+}
+
+/* Whether the sorted array, covering @old_rows rows, can be updated
+ * for a change of @count rows, instead of sorting the model again. */
+static gboolean
+table_sorter_can_update (ETableSorter *table_sorter,
+                         gint old_rows,
+                         gint count)
+{
+	return table_sorter->sorted &&
+		table_sorter->sorted_rows == old_rows &&
+		count <= INCREMENTAL_MAX_ROWS &&
+		count * 4 <= old_rows;
+}
+
+static void
+table_sorter_reposition_row (ETableSorter *table_sorter,
+                             gint row)
+{
+	gint *sorted = table_sorter->sorted;
+	gint rows = table_sorter->sorted_rows;
+	gint pos;
+
+	if (table_sorter->backsorted) {
+		pos = table_sorter->backsorted[row];
+	} else {
+		for (pos = 0; pos < rows && sorted[pos] != row; pos++) {
+			/* just find it */
+		}
+	}
+
+	g_return_if_fail (pos < rows);
+
+	/* Still between its neighbours, no change needed. */
+	if ((pos == 0 || table_sorter_compare_rows (table_sorter, sorted[pos - 1], row) < 0) &&
+	    (pos == rows - 1 || table_sorter_compare_rows (table_sorter, row, sorted[pos + 1]) < 0))
+		return;
+
+	memmove (sorted + pos, sorted + pos + 1, sizeof (gint) * (rows - pos - 1));
+	table_sorter_insert_row (table_sorter, rows - 1, row);
+
+	g_free (table_sorter->backsorted);
+	table_sorter->backsorted = NULL;
 }
 
 static void
@@ -231,7 +388,14 @@ table_sorter_model_row_changed_cb (ETableModel *table_model,
                                    gint row,
                                    ETableSorter *table_sorter)
 {
-	table_sorter_clean (table_sorter);
+	gint rows = e_table_model_row_count (table_model);
+
+	if (!table_sorter_can_update (table_sorter, rows, 1) || row < 0 || row >= rows) {
+		table_sorter_clean (table_sorter);
+		return;
+	}
+
+	table_sorter_reposition_row (table_sorter, row);
 }
 
 static void
@@ -240,7 +404,20 @@ table_sorter_model_cell_changed_cb (ETableModel *table_model,
                                     gint row,
                                     ETableSorter *table_sorter)
 {
-	table_sorter_clean (table_sorter);
+	gint j, cols;
+
+	cols = table_sorter_get_n_columns (table_sorter);
+
+	for (j = 0; j < cols; j++) {
+		if (table_sorter_get_nth_column (table_sorter, j, NULL)->spec->model_col == col)
+			break;
+	}
+
+	/* The column does not influence the order. */
+	if (j == cols)
+		return;
+
+	table_sorter_model_row_changed_cb (table_model, row, table_sorter);
 }
 
 static void
@@ -249,7 +426,36 @@ table_sorter_model_rows_inserted_cb (ETableModel *table_model,
                                      gint count,
                                      ETableSorter *table_sorter)
 {
-	table_sorter_clean (table_sorter);
+	gint *sorted;
+	gint rows, old_rows, i;
+
+	rows = e_table_model_row_count (table_model);
+	old_rows = rows - count;
+
+	/* Already sorted with the new rows, when asked for by another handler. */
+	if (table_sorter->sorted && table_sorter->sorted_rows == rows)
+		return;
+
+	if (!table_sorter_can_update (table_sorter, old_rows, count) || row < 0 || row > old_rows) {
+		table_sorter_clean (table_sorter);
+		return;
+	}
+
+	g_free (table_sorter->backsorted);
+	table_sorter->backsorted = NULL;
+
+	table_sorter->sorted = g_renew (gint, table_sorter->sorted, rows);
+	sorted = table_sorter->sorted;
+
+	for (i = 0; i < old_rows; i++) {
+		if (sorted[i] >= row)
+			sorted[i] += count;
+	}
+
+	for (i = 0; i < count; i++)
+		table_sorter_insert_row (table_sorter, old_rows + i, row + i);
+
+	table_sorter->sorted_rows = rows;
 }
 
 static void
@@ -258,7 +464,38 @@ table_sorter_model_rows_deleted_cb (ETableModel *table_model,
                                     gint count,
                                     ETableSorter *table_sorter)
 {
-	table_sorter_clean (table_sorter);
+	gint *sorted;
+	gint rows, old_rows, i, j;
+
+	rows = e_table_model_row_count (table_model);
+	old_rows = rows + count;
+
+	/* Already sorted without the deleted rows. */
+	if (table_sorter->sorted && table_sorter->sorted_rows == rows)
+		return;
+
+	/* No comparison is needed here, thus the count does not matter. */
+	if (!table_sorter->sorted || table_sorter->sorted_rows != old_rows ||
+	    row < 0 || row + count > old_rows) {
+		table_sorter_clean (table_sorter);
+		return;
+	}
+
+	g_free (table_sorter->backsorted);
+	table_sorter->backsorted = NULL;
+
+	sorted = table_sorter->sorted;
+
+	for (i = 0, j = 0; i < old_rows; i++) {
+		gint value = sorted[i];
+
+		if (value >= row && value < row + count)
+			continue;
+
+		sorted[j++] = value >= row + count ? value - count : value;
+	}
+
+	table_sorter->sorted_rows = rows;
 }
 
 static void
@@ -382,6 +619,11 @@ table_sorter_dispose (GObject *object)
 
 	table_sorter_clean (table_sorter);
 
+	if (table_sorter->cmp_cache) {
+		e_table_sorting_utils_free_cmp_cache (table_sorter->cmp_cache);
+		table_sorter->cmp_cache = NULL;
+	}
+
 	/* Chain up to parent's dispose() method. */
 	G_OBJECT_CLASS (e_table_sorter_parent_class)->dispose (object);
 }
@@ -65,6 +65,10 @@ struct _ETableSorter {
 
 	gint *sorted;
 	gint *backsorted;
+	gint sorted_rows;
+
+	/* Kept between sorts, see table_sorter_sort() */
+	gpointer cmp_cache;
 
 	gulong table_model_changed_id;
 	gulong table_model_row_changed_id;
@@ -135,6 +135,27 @@ e_sort_callback (gconstpointer data1,
 	return comp_val;
 }
 
+static gpointer
+e_sort_closure_dup (gconstpointer src,
+                    gpointer user_data)
+{
+	ETableSortClosure *closure;
+
+	closure = g_memdup (src, sizeof (ETableSortClosure));
+	closure->cmp_cache = e_table_sorting_utils_create_cmp_cache ();
+
+	return closure;
+}
+
+static void
+e_sort_closure_free (gpointer ptr)
+{
+	ETableSortClosure *closure = ptr;
+
+	e_table_sorting_utils_free_cmp_cache (closure->cmp_cache);
+	g_free (closure);
+}
+
 void
 e_table_sorting_utils_sort (ETableModel *source,
                             ETableSortInfo *sort_info,
@@ -180,8 +201,8 @@ e_table_sorting_utils_sort (ETableModel *source,
 		closure.compare[j] = col->compare;
 	}
 
-	g_qsort_with_data (
-		map_table, rows, sizeof (gint), e_sort_callback, &closure);
+	if (!e_table_sorting_utils_parallel_sort (map_table, rows, e_sort_callback, &closure, e_sort_closure_dup, e_sort_closure_free))
+		g_qsort_with_data (map_table, rows, sizeof (gint), e_sort_callback, &closure);
 
 	for (j = 0; j < cols; j++) {
 		ETableColumnSpecification *spec;
@@ -356,6 +377,40 @@ e_table_sorting_utils_tree_sort (ETreeModel *source,
                                  ETableHeader *full_header,
                                  ETreePath *map_table,
                                  gint count)
+{
+	gpointer cmp_cache;
+
+	g_return_if_fail (E_IS_TREE_MODEL (source));
+	g_return_if_fail (E_IS_TABLE_SORT_INFO (sort_info));
+	g_return_if_fail (E_IS_TABLE_HEADER (full_header));
+
+	cmp_cache = e_table_sorting_utils_create_cmp_cache ();
+
+	e_table_sorting_utils_tree_sort_with_cmp_cache (source, sort_info, full_header, map_table, count, cmp_cache);
+
+	e_table_sorting_utils_free_cmp_cache (cmp_cache);
+}
+
+/**
+ * e_table_sorting_utils_tree_sort_with_cmp_cache:
+ * @source: an #ETreeModel
+ * @sort_info: an #ETableSortInfo
+ * @full_header: an #ETableHeader
+ * @map_table: (array length=count): the tree paths to sort
+ * @count: how many items @map_table has
+ * @cmp_cache: a compare cache; cannot be %NULL
+ *
+ * The same as e_table_sorting_utils_tree_sort(), only uses the given
+ * @cmp_cache, thus the values cached by one sort can be reused by
+ * the next sort of the same model.
+ **/
+void
+e_table_sorting_utils_tree_sort_with_cmp_cache (ETreeModel *source,
+                                                ETableSortInfo *sort_info,
+                                                ETableHeader *full_header,
+                                                ETreePath *map_table,
+                                                gint count,
+                                                gpointer cmp_cache)
 {
 	ETableSortClosure closure;
 	gint cols;
@@ -366,6 +421,7 @@ e_table_sorting_utils_tree_sort (ETreeModel *source,
 	g_return_if_fail (E_IS_TREE_MODEL (source));
 	g_return_if_fail (E_IS_TABLE_SORT_INFO (sort_info));
 	g_return_if_fail (E_IS_TABLE_HEADER (full_header));
+	g_return_if_fail (cmp_cache != NULL);
 
 	cols = e_table_sort_info_sorting_get_count (sort_info);
 	closure.cols = cols;
@@ -373,7 +429,7 @@ e_table_sorting_utils_tree_sort (ETreeModel *source,
 	closure.vals = g_new (gpointer , count * cols);
 	closure.sort_type = g_new (GtkSortType, cols);
 	closure.compare = g_new (GCompareDataFunc, cols);
-	closure.cmp_cache = e_table_sorting_utils_create_cmp_cache ();
+	closure.cmp_cache = cmp_cache;
 
 	for (j = 0; j < cols; j++) {
 		ETableColumnSpecification *spec;
@@ -399,8 +455,8 @@ e_table_sorting_utils_tree_sort (ETreeModel *source,
 		map[i] = i;
 	}
 
-	g_qsort_with_data (
-		map, count, sizeof (gint), e_sort_callback, &closure);
+	if (!e_table_sorting_utils_parallel_sort (map, count, e_sort_callback, &closure, e_sort_closure_dup, e_sort_closure_free))
+		g_qsort_with_data (map, count, sizeof (gint), e_sort_callback, &closure);
 
 	map_copy = g_new (ETreePath, count);
 	for (i = 0; i < count; i++) {
@@ -434,7 +490,6 @@ e_table_sorting_utils_tree_sort (ETreeModel *source,
 	g_free (closure.vals);
 	g_free (closure.sort_type);
 	g_free (closure.compare);
-	e_table_sorting_utils_free_cmp_cache (closure.cmp_cache);
 }
 
 /* FIXME: This could be done in time log n instead of time n with a binary search. */
@@ -495,6 +550,11 @@ e_table_sorting_utils_tree_insert (ETreeModel *source,
 	return end;
 }
 
+typedef struct _ETableCmpCache {
+	GHashTable *values;		/* gchar *key ~> gchar *value */
+	GHashTable *casefold_keys;	/* gchar *key ~> gchar *collate_key */
+} ETableCmpCache;
+
 /**
  * e_table_sorting_utils_create_cmp_cache:
  *
@@ -503,17 +563,31 @@ e_table_sorting_utils_tree_insert (ETreeModel *source,
  * e_table_sorting_utils_lookup_cmp_cache() and
  * e_table_sorting_utils_add_to_cmp_cache().
  *
+ * The values are derived from the key strings only, thus the cache can be
+ * kept across several sorts of the same model; see
+ * e_table_sorting_utils_prune_cmp_cache().
+ *
  * Returned pointer should be freed with
  * e_table_sorting_utils_free_cmp_cache().
  **/
 gpointer
 e_table_sorting_utils_create_cmp_cache (void)
 {
-	return g_hash_table_new_full (
+	ETableCmpCache *cache;
+
+	cache = g_slice_new (ETableCmpCache);
+	cache->values = g_hash_table_new_full (
 		(GHashFunc) g_str_hash,
 		(GEqualFunc) g_str_equal,
 		(GDestroyNotify) camel_pstring_free,
 		(GDestroyNotify) g_free);
+	cache->casefold_keys = g_hash_table_new_full (
+		(GHashFunc) g_str_hash,
+		(GEqualFunc) g_str_equal,
+		(GDestroyNotify) camel_pstring_free,
+		(GDestroyNotify) g_free);
+
+	return cache;
 }
 
 /**
@@ -526,9 +600,41 @@ e_table_sorting_utils_create_cmp_cache (void)
 void
 e_table_sorting_utils_free_cmp_cache (gpointer cmp_cache)
 {
+	ETableCmpCache *cache = cmp_cache;
+
+	g_return_if_fail (cmp_cache != NULL);
+
+	g_hash_table_destroy (cache->values);
+	g_hash_table_destroy (cache->casefold_keys);
+	g_slice_free (ETableCmpCache, cache);
+}
+
+/**
+ * e_table_sorting_utils_prune_cmp_cache:
+ * @cmp_cache: a compare cache; cannot be %NULL
+ * @max_entries: how many entries the cache can hold
+ *
+ * Drops all the entries from the @cmp_cache when it holds more than
+ * @max_entries of them. Long-living caches, which are reused between
+ * sorts, call this before each sort, to not grow with values which
+ * the model does not contain anymore. It cannot be called while
+ * sorting, because the compare functions can hold pointers to
+ * the cached values.
+ **/
+void
+e_table_sorting_utils_prune_cmp_cache (gpointer cmp_cache,
+                                       guint max_entries)
+{
+	ETableCmpCache *cache = cmp_cache;
+
 	g_return_if_fail (cmp_cache != NULL);
 
-	g_hash_table_destroy (cmp_cache);
+	if (g_hash_table_size (cache->values) +
+	    g_hash_table_size (cache->casefold_keys) <= max_entries)
+		return;
+
+	g_hash_table_remove_all (cache->values);
+	g_hash_table_remove_all (cache->casefold_keys);
 }
 
 /**
@@ -546,11 +652,13 @@ e_table_sorting_utils_add_to_cmp_cache (gpointer cmp_cache,
                                         const gchar *key,
                                         gchar *value)
 {
+	ETableCmpCache *cache = cmp_cache;
+
 	g_return_if_fail (cmp_cache != NULL);
 	g_return_if_fail (key != NULL);
 
 	g_hash_table_insert (
-		cmp_cache, (gchar *) camel_pstring_strdup (key), value);
+		cache->values, (gchar *) camel_pstring_strdup (key), value);
 }
 
 /**
@@ -565,10 +673,300 @@ const gchar *
 e_table_sorting_utils_lookup_cmp_cache (gpointer cmp_cache,
                                         const gchar *key)
 {
+	ETableCmpCache *cache = cmp_cache;
+
 	g_return_val_if_fail (key != NULL, NULL);
 
 	if (cmp_cache == NULL)
 		return NULL;
 
-	return g_hash_table_lookup (cmp_cache, key);
+	return g_hash_table_lookup (cache->values, key);
+}
+
+/**
+ * e_table_sorting_utils_get_collate_key:
+ * @cmp_cache: a compare cache; cannot be %NULL
+ * @str: a string to get the collate key for; cannot be %NULL
+ * @casefold: whether to casefold @str first
+ *
+ * Returns g_utf8_collate_key() of the @str, or of its casefolded
+ * variant, when @casefold is %TRUE. The key is computed only once
+ * and then kept in the @cmp_cache. The plain keys are shared with
+ * e_table_sorting_utils_lookup_cmp_cache(), while the casefolded
+ * keys are stored separately, thus both kinds of keys for the same
+ * @str can be in the cache at once.
+ *
+ * Returns: (transfer none): the collate key, owned by @cmp_cache
+ **/
+const gchar *
+e_table_sorting_utils_get_collate_key (gpointer cmp_cache,
+                                       const gchar *str,
+                                       gboolean casefold)
+{
+	ETableCmpCache *cache = cmp_cache;
+	GHashTable *keys;
+	gchar *collate_key;
+
+	g_return_val_if_fail (cmp_cache != NULL, NULL);
+	g_return_val_if_fail (str != NULL, NULL);
+
+	keys = casefold ? cache->casefold_keys : cache->values;
+
+	collate_key = g_hash_table_lookup (keys, str);
+	if (!collate_key) {
+		if (casefold) {
+			gchar *tmp = g_utf8_casefold (str, -1);
+			collate_key = g_utf8_collate_key (tmp, -1);
+			g_free (tmp);
+		} else {
+			collate_key = g_utf8_collate_key (str, -1);
+		}
+
+		g_hash_table_insert (keys, (gchar *) camel_pstring_strdup (str), collate_key);
+	}
+
+	return collate_key;
+}
+
+#define PARALLEL_SORT_MIN_CHUNK 4096
+#define PARALLEL_SORT_DEFAULT_THRESHOLD 50000
+#define PARALLEL_SORT_MAX_THREADS 16
+
+static gint parallel_sort_threshold = -1;
+
+typedef struct _ParallelSortJob {
+	gint *indexes;
+	gint *tmp;
+	gint start;
+	gint middle;
+	gint end;
+	GCompareDataFunc compare_func;
+	gpointer user_data;
+} ParallelSortJob;
+
+static gpointer
+parallel_sort_job_sort (gpointer user_data)
+{
+	ParallelSortJob *job = user_data;
+
+	g_qsort_with_data (
+		job->indexes + job->start, job->end - job->start,
+		sizeof (gint), job->compare_func, job->user_data);
+
+	return NULL;
+}
+
+static gpointer
+parallel_sort_job_merge (gpointer user_data)
+{
+	ParallelSortJob *job = user_data;
+	gint *indexes = job->indexes;
+	gint *tmp = job->tmp;
+	gint ii, jj, kk;
+
+	ii = job->start;
+	jj = job->middle;
+	kk = job->start;
+
+	/* Take from the left run on ties, to keep the merge stable. */
+	while (ii < job->middle && jj < job->end) {
+		if (job->compare_func (&indexes[jj], &indexes[ii], job->user_data) < 0)
+			tmp[kk++] = indexes[jj++];
+		else
+			tmp[kk++] = indexes[ii++];
+	}
+
+	while (ii < job->middle)
+		tmp[kk++] = indexes[ii++];
+
+	/* Whatever is left in the right run is already in place. */
+	memcpy (indexes + job->start, tmp + job->start, sizeof (gint) * (kk - job->start));
+
+	return NULL;
+}
+
+static void
+parallel_sort_run_jobs (ParallelSortJob *jobs,
+                        gint n_jobs,
+                        GThreadFunc func)
+{
+	GThread **threads;
+	gint ii;
+
+	threads = g_new0 (GThread *, n_jobs);
+
+	for (ii = 1; ii < n_jobs; ii++) {
+		threads[ii] = g_thread_try_new ("e-table-sort", func, &jobs[ii], NULL);
+
+		/* Cannot create a thread, do the work in this one. */
+		if (!threads[ii])
+			func (&jobs[ii]);
+	}
+
+	func (&jobs[0]);
+
+	for (ii = 1; ii < n_jobs; ii++) {
+		if (threads[ii])
+			g_thread_join (threads[ii]);
+	}
+
+	g_free (threads);
+}
+
+/**
+ * e_table_sorting_utils_get_parallel_threshold:
+ *
+ * Returns the row count from which e_table_sorting_utils_parallel_sort()
+ * splits the work between more threads. It is 50000 rows by default,
+ * which can be changed with the E_TABLE_PARALLEL_SORT_THRESHOLD environment
+ * variable, where 0 disables the parallel sort.
+ *
+ * Returns: the row count threshold, or 0 when the parallel sort is disabled
+ **/
+gint
+e_table_sorting_utils_get_parallel_threshold (void)
+{
+	if (parallel_sort_threshold < 0) {
+		const gchar *env;
+		gint threshold = PARALLEL_SORT_DEFAULT_THRESHOLD;
+
+		env = g_getenv ("E_TABLE_PARALLEL_SORT_THRESHOLD");
+		if (env && *env)
+			threshold = MAX (0, (gint) g_ascii_strtoll (env, NULL, 10));
+
+		g_atomic_int_set (&parallel_sort_threshold, threshold);
+	}
+
+	return g_atomic_int_get (&parallel_sort_threshold);
+}
+
+/**
+ * e_table_sorting_utils_set_parallel_threshold:
+ * @threshold: a row count, or 0 to disable the parallel sort
+ *
+ * Sets the row count from which e_table_sorting_utils_parallel_sort()
+ * splits the work between more threads. The value is never lower than
+ * the minimum chunk size processed by a single thread.
+ **/
+void
+e_table_sorting_utils_set_parallel_threshold (gint threshold)
+{
+	if (threshold > 0)
+		threshold = MAX (threshold, 2 * PARALLEL_SORT_MIN_CHUNK);
+	else
+		threshold = 0;
+
+	g_atomic_int_set (&parallel_sort_threshold, threshold);
+}
+
+/**
+ * e_table_sorting_utils_parallel_sort:
+ * @indexes: an array of indexes to sort
+ * @n_indexes: how many items @indexes has
+ * @compare_func: a function to compare two items of @indexes
+ * @user_data: user data passed to @compare_func
+ * @dup_user_data: (nullable): a function to create a copy of @user_data
+ *    for a single thread, or %NULL to share @user_data between the threads
+ * @free_user_data: (nullable): a function to free data created by @dup_user_data
+ *
+ * Sorts @indexes with a merge sort spread over several threads, when
+ * the parallel sort is enabled and @n_indexes reaches the threshold
+ * set by e_table_sorting_utils_set_parallel_threshold(). Each thread
+ * sorts its own chunk of @indexes, which are then merged, also in
+ * parallel. The @compare_func is called from the helper threads, thus
+ * it cannot touch any shared state other than @user_data, which is
+ * duplicated per thread with @dup_user_data. That's the place where
+ * to create a separate compare cache, if one is used.
+ *
+ * The result is the same as with g_qsort_with_data(), as long as
+ * the @compare_func doesn't consider any two items equal.
+ *
+ * Returns: %TRUE when @indexes had been sorted, %FALSE when the parallel
+ *    sort is not used, in which case the caller should sort @indexes itself
+ **/
+gboolean
+e_table_sorting_utils_parallel_sort (gint *indexes,
+                                     gint n_indexes,
+                                     GCompareDataFunc compare_func,
+                                     gpointer user_data,
+                                     GCopyFunc dup_user_data,
+                                     GDestroyNotify free_user_data)
+{
+	ParallelSortJob *jobs;
+	gpointer *datas;
+	gint *bounds;
+	gint *tmp;
+	gint threshold, n_threads, n_runs, ii;
+
+	g_return_val_if_fail (compare_func != NULL, FALSE);
+
+	threshold = e_table_sorting_utils_get_parallel_threshold ();
+	if (threshold <= 0 || n_indexes < threshold)
+		return FALSE;
+
+	n_threads = MIN (g_get_num_processors (), PARALLEL_SORT_MAX_THREADS);
+	n_threads = MIN (n_threads, n_indexes / PARALLEL_SORT_MIN_CHUNK);
+	if (n_threads < 2)
+		return FALSE;
+
+	datas = g_new (gpointer, n_threads);
+	datas[0] = user_data;
+	for (ii = 1; ii < n_threads; ii++)
+		datas[ii] = dup_user_data ? dup_user_data (user_data, NULL) : user_data;
+
+	jobs = g_new0 (ParallelSortJob, n_threads);
+	bounds = g_new (gint, n_threads + 1);
+	tmp = g_new (gint, n_indexes);
+
+	for (ii = 0; ii <= n_threads; ii++)
+		bounds[ii] = (gint) (((gint64) n_indexes) * ii / n_threads);
+
+	for (ii = 0; ii < n_threads; ii++) {
+		jobs[ii].indexes = indexes;
+		jobs[ii].tmp = tmp;
+		jobs[ii].start = bounds[ii];
+		jobs[ii].end = bounds[ii + 1];
+		jobs[ii].compare_func = compare_func;
+		jobs[ii].user_data = datas[ii];
+	}
+
+	parallel_sort_run_jobs (jobs, n_threads, parallel_sort_job_sort);
+
+	n_runs = n_threads;
+
+	while (n_runs > 1) {
+		gint n_pairs = n_runs / 2;
+
+		for (ii = 0; ii < n_pairs; ii++) {
+			jobs[ii].start = bounds[2 * ii];
+			jobs[ii].middle = bounds[2 * ii + 1];
+			jobs[ii].end = bounds[2 * ii + 2];
+			jobs[ii].user_data = datas[ii];
+		}
+
+		parallel_sort_run_jobs (jobs, n_pairs, parallel_sort_job_merge);
+
+		for (ii = 0; ii < n_pairs; ii++)
+			bounds[ii + 1] = bounds[2 * ii + 2];
+
+		/* An odd run is carried over to the next round as is. */
+		if (n_runs % 2 == 1) {
+			bounds[n_pairs + 1] = bounds[n_runs];
+			n_pairs++;
+		}
+
+		n_runs = n_pairs;
+	}
+
+	if (dup_user_data && free_user_data) {
+		for (ii = 1; ii < n_threads; ii++)
+			free_user_data (datas[ii]);
+	}
+
+	g_free (tmp);
+	g_free (bounds);
+	g_free (jobs);
+	g_free (datas);
+
+	return TRUE;
 }
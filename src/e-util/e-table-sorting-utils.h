@@ -62,6 +62,13 @@ void		e_table_sorting_utils_tree_sort	(ETreeModel *source,
 						 ETableHeader *full_header,
 						 ETreePath *map_table,
 						 gint count);
+void		e_table_sorting_utils_tree_sort_with_cmp_cache
+						(ETreeModel *source,
+						 ETableSortInfo *sort_info,
+						 ETableHeader *full_header,
+						 ETreePath *map_table,
+						 gint count,
+						 gpointer cmp_cache);
 gint		e_table_sorting_utils_tree_check_position
 						(ETreeModel *source,
 						 ETableSortInfo *sort_info,
@@ -81,6 +88,9 @@ gpointer	e_table_sorting_utils_create_cmp_cache
 						(void);
 void		e_table_sorting_utils_free_cmp_cache
 						(gpointer cmp_cache);
+void		e_table_sorting_utils_prune_cmp_cache
+						(gpointer cmp_cache,
+						 guint max_entries);
 void		e_table_sorting_utils_add_to_cmp_cache
 						(gpointer cmp_cache,
 						 const gchar *key,
@@ -88,6 +98,22 @@ void		e_table_sorting_utils_add_to_cmp_cache
 const gchar *	e_table_sorting_utils_lookup_cmp_cache
 						(gpointer cmp_cache,
 						 const gchar *key);
+const gchar *	e_table_sorting_utils_get_collate_key
+						(gpointer cmp_cache,
+						 const gchar *str,
+						 gboolean casefold);
+
+gint		e_table_sorting_utils_get_parallel_threshold
+						(void);
+void		e_table_sorting_utils_set_parallel_threshold
+						(gint threshold);
+gboolean	e_table_sorting_utils_parallel_sort
+						(gint *indexes,
+						 gint n_indexes,
+						 GCompareDataFunc compare_func,
+						 gpointer user_data,
+						 GCopyFunc dup_user_data,
+						 GDestroyNotify free_user_data);
 
 G_END_DECLS
 
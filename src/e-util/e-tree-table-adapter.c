@@ -70,6 +70,9 @@ struct _ETreeTableAdapterPrivate {
 
 	ETableHeader *header;
 
+	/* Collate keys kept between sorts */
+	gpointer cmp_cache;
+
 	gint n_map;
 	gint n_vals_allocated;
 	node_t **map_table;
@@ -248,7 +251,16 @@ resort_node (ETreeTableAdapter *etta,
 			use_sort_info = etta->priv->children_sort_info;
 		}
 
-		e_table_sorting_utils_tree_sort (etta->priv->source_model, use_sort_info, etta->priv->header, paths, count);
+		if (etta->priv->cmp_cache) {
+			/* The keys depend only on the compared strings, just do not let
+			 * the cache grow with strings the model does not contain anymore. */
+			e_table_sorting_utils_prune_cmp_cache (etta->priv->cmp_cache,
+				MAX (2 * g_hash_table_size (etta->priv->nodes) * e_table_sort_info_sorting_get_count (use_sort_info), 1024));
+		} else {
+			etta->priv->cmp_cache = e_table_sorting_utils_create_cmp_cache ();
+		}
+
+		e_table_sorting_utils_tree_sort_with_cmp_cache (etta->priv->source_model, use_sort_info, etta->priv->header, paths, count, etta->priv->cmp_cache);
 	}
 
 	prev = NULL;
@@ -596,6 +608,9 @@ tree_table_adapter_source_model_rebuilt_cb (ETreeModel *source_model,
 	etta->priv->root = NULL;
 
 	g_hash_table_remove_all (etta->priv->nodes);
+
+	if (etta->priv->cmp_cache)
+		e_table_sorting_utils_prune_cmp_cache (etta->priv->cmp_cache, 0);
 }
 
 static gboolean
@@ -847,6 +862,9 @@ tree_table_adapter_finalize (GObject *object)
 
 	g_hash_table_destroy (priv->nodes);
 
+	if (priv->cmp_cache)
+		e_table_sorting_utils_free_cmp_cache (priv->cmp_cache);
+
 	g_free (priv->map_table);
 
 	/* Chain up to parent's finalize() method. */
@@ -0,0 +1,288 @@
+/*
+ * test-bit-array.c
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Runs the same operations on EBitArray, both with bits and with runs
+ * of selected rows, and on a plain array of booleans, and checks that
+ * they all end up with the same selection. */
+
+#include "evolution-config.h"
+
+#include <e-util/e-util.h>
+
+#define N_RANDOM_STEPS 2000
+
+/* Plain model of the selection, one gboolean per row */
+typedef struct _Reference {
+	GArray *rows;
+} Reference;
+
+static void
+reference_change_range (Reference *ref,
+                        gint start,
+                        gint end,
+                        gboolean selected)
+{
+	gint ii;
+
+	for (ii = start; ii < end; ii++)
+		g_array_index (ref->rows, gboolean, ii) = selected;
+}
+
+static void
+reference_select_single_row (Reference *ref,
+                             gint row)
+{
+	reference_change_range (ref, 0, ref->rows->len, FALSE);
+	g_array_index (ref->rows, gboolean, row) = TRUE;
+}
+
+static void
+reference_insert (Reference *ref,
+                  gint row,
+                  gint count)
+{
+	gint ii;
+
+	row = CLAMP (row, 0, (gint) ref->rows->len);
+
+	for (ii = 0; ii < count; ii++) {
+		gboolean selected = FALSE;
+
+		g_array_insert_val (ref->rows, row, selected);
+	}
+}
+
+static void
+reference_delete (Reference *ref,
+                  gint row,
+                  gint count,
+                  gboolean single_mode)
+{
+	gboolean selected = FALSE;
+	gint ii;
+
+	if (row < 0 || count <= 0 || row >= ref->rows->len)
+		return;
+
+	count = MIN (count, ref->rows->len - row);
+
+	for (ii = row; ii < row + count; ii++)
+		selected = selected || g_array_index (ref->rows, gboolean, ii);
+
+	g_array_remove_range (ref->rows, row, count);
+
+	if (single_mode && selected && ref->rows->len > 0)
+		reference_select_single_row (ref, MIN (row, ref->rows->len - 1));
+}
+
+static void
+collect_rows_cb (gint row,
+                 gpointer user_data)
+{
+	GArray *rows = user_data;
+
+	g_array_append_val (rows, row);
+}
+
+static void
+check_same (EBitArray *bit_array,
+            Reference *ref)
+{
+	GArray *rows;
+	gint ii, count = 0;
+
+	g_assert_cmpint (e_bit_array_bit_count (bit_array), ==, ref->rows->len);
+
+	for (ii = 0; ii < ref->rows->len; ii++) {
+		gboolean expected = g_array_index (ref->rows, gboolean, ii);
+
+		g_assert_cmpint (e_bit_array_value_at (bit_array, ii) ? 1 : 0, ==, expected ? 1 : 0);
+
+		if (expected)
+			count++;
+	}
+
+	g_assert_false (e_bit_array_value_at (bit_array, ref->rows->len));
+	g_assert_false (e_bit_array_value_at (bit_array, -1));
+	g_assert_cmpint (e_bit_array_selected_count (bit_array), ==, count);
+
+	/* The foreach visits the selected rows in ascending order */
+	rows = g_array_new (FALSE, FALSE, sizeof (gint));
+	e_bit_array_foreach (bit_array, collect_rows_cb, rows);
+
+	g_assert_cmpint (rows->len, ==, count);
+
+	for (ii = 0, count = 0; ii < ref->rows->len; ii++) {
+		if (g_array_index (ref->rows, gboolean, ii))
+			g_assert_cmpint (g_array_index (rows, gint, count++), ==, ii);
+	}
+
+	g_array_unref (rows);
+}
+
+static void
+run_random_steps (gboolean use_ranges)
+{
+	EBitArray *bit_array;
+	Reference ref;
+	gint step;
+
+	bit_array = e_bit_array_new (100);
+	e_bit_array_set_use_ranges (bit_array, use_ranges);
+
+	ref.rows = g_array_new (FALSE, TRUE, sizeof (gboolean));
+	g_array_set_size (ref.rows, 100);
+
+	for (step = 0; step < N_RANDOM_STEPS; step++) {
+		gint len = ref.rows->len;
+		gint row, row2, count;
+		gboolean selected;
+
+		row = len > 0 ? g_test_rand_int_range (0, len) : 0;
+		row2 = g_test_rand_int_range (row, len + 1);
+		count = g_test_rand_int_range (1, 70);
+		selected = g_test_rand_bit ();
+
+		switch (len > 0 ? g_test_rand_int_range (0, 11) : 6) {
+		case 0:
+			e_bit_array_change_one_row (bit_array, row, selected);
+			reference_change_range (&ref, row, row + 1, selected);
+			break;
+		case 1:
+		case 2:
+			e_bit_array_change_range (bit_array, row, row2, selected);
+			reference_change_range (&ref, row, row2, selected);
+			break;
+		case 3:
+			e_bit_array_select_single_row (bit_array, row);
+			reference_select_single_row (&ref, row);
+			break;
+		case 4:
+			e_bit_array_toggle_single_row (bit_array, row);
+			reference_change_range (&ref, row, row + 1, !g_array_index (ref.rows, gboolean, row));
+			break;
+		case 5:
+			e_bit_array_select_all (bit_array);
+			reference_change_range (&ref, 0, len, TRUE);
+			break;
+		case 6:
+		case 7:
+			row = g_test_rand_int_range (0, len + 1);
+			e_bit_array_insert (bit_array, row, count);
+			reference_insert (&ref, row, count);
+			break;
+		case 8:
+			e_bit_array_delete (bit_array, row, count);
+			reference_delete (&ref, row, count, FALSE);
+			break;
+		case 9:
+			e_bit_array_delete_single_mode (bit_array, row, count);
+			reference_delete (&ref, row, count, TRUE);
+			break;
+		case 10:
+			row2 = g_test_rand_int_range (0, len);
+			e_bit_array_move_row (bit_array, row, row2);
+			reference_delete (&ref, row, 1, FALSE);
+			reference_insert (&ref, row2, 1);
+			break;
+		}
+
+		check_same (bit_array, &ref);
+
+		/* Keep the array from growing without limits */
+		if (ref.rows->len > 1000) {
+			e_bit_array_delete (bit_array, 0, 500);
+			reference_delete (&ref, 0, 500, FALSE);
+		}
+	}
+
+	/* Switching the storage keeps the selection */
+	e_bit_array_set_use_ranges (bit_array, !use_ranges);
+	check_same (bit_array, &ref);
+
+	g_array_unref (ref.rows);
+	g_object_unref (bit_array);
+}
+
+static void
+test_bit_array_bits (void)
+{
+	run_random_steps (FALSE);
+}
+
+static void
+test_bit_array_ranges (void)
+{
+	run_random_steps (TRUE);
+}
+
+static void
+test_bit_array_word_boundaries (void)
+{
+	gint use_ranges;
+
+	for (use_ranges = 0; use_ranges < 2; use_ranges++) {
+		EBitArray *bit_array;
+		Reference ref;
+
+		bit_array = e_bit_array_new (64);
+		e_bit_array_set_use_ranges (bit_array, use_ranges);
+
+		ref.rows = g_array_new (FALSE, TRUE, sizeof (gboolean));
+		g_array_set_size (ref.rows, 64);
+
+		/* The range ends on a word boundary at the end of the data */
+		e_bit_array_change_range (bit_array, 32, 64, TRUE);
+		reference_change_range (&ref, 32, 64, TRUE);
+		check_same (bit_array, &ref);
+
+		/* Rows shifted across the word boundaries */
+		e_bit_array_insert (bit_array, 31, 33);
+		reference_insert (&ref, 31, 33);
+		check_same (bit_array, &ref);
+
+		e_bit_array_change_range (bit_array, 0, 31, TRUE);
+		reference_change_range (&ref, 0, 31, TRUE);
+		e_bit_array_delete (bit_array, 30, 35);
+		reference_delete (&ref, 30, 35, FALSE);
+		check_same (bit_array, &ref);
+
+		e_bit_array_select_all (bit_array);
+		reference_change_range (&ref, 0, ref.rows->len, TRUE);
+		check_same (bit_array, &ref);
+
+		e_bit_array_change_range (bit_array, 1, ref.rows->len - 1, FALSE);
+		reference_change_range (&ref, 1, ref.rows->len - 1, FALSE);
+		check_same (bit_array, &ref);
+
+		g_array_unref (ref.rows);
+		g_object_unref (bit_array);
+	}
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/EBitArray/Bits", test_bit_array_bits);
+	g_test_add_func ("/EBitArray/Ranges", test_bit_array_ranges);
+	g_test_add_func ("/EBitArray/WordBoundaries", test_bit_array_word_boundaries);
+
+	return g_test_run ();
+}
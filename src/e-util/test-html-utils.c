@@ -0,0 +1,708 @@
+/*
+ * test-html-utils.c
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "evolution-config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <e-util/e-util.h>
+
+#define CITATION_COLOR 0x737373
+#define TIMING_TEXT_SIZE (4 * 1024 * 1024)
+
+static const struct {
+	const gchar *text;
+	guint flags;
+	const gchar *html;
+} conversions[] = {
+	{ "", 0, "" },
+	{ "plain text", 0, "plain text" },
+	{ "a < b & \"c\" > d", 0, "a &lt; b &amp; &quot;c&quot; &gt; d" },
+	{ "x", E_TEXT_TO_HTML_PRE, "<PRE>x</PRE>" },
+	{ "line1\nline2", 0, "line1\nline2" },
+	{ "line1\nline2", E_TEXT_TO_HTML_CONVERT_NL, "line1<br>\nline2" },
+	{ "a\tb", 0, "a\tb" },
+	{ "a\tb", E_TEXT_TO_HTML_CONVERT_SPACES, "a&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;b" },
+	{ "a  b", E_TEXT_TO_HTML_CONVERT_SPACES, "a&nbsp; b" },
+	{ "caf\xc3\xa9", 0, "caf&#233;" },
+	{ "caf\xc3\xa9", E_TEXT_TO_HTML_ESCAPE_8BIT, "caf?" },
+	{ "see http://www.foo.com/ ok", 0, "see http://www.foo.com/ ok" },
+	{ "see http://www.foo.com/ ok", E_TEXT_TO_HTML_CONVERT_URLS,
+	  "see <a href=\"http://www.foo.com/\">http://www.foo.com/</a> ok" },
+	{ "http://www.foo.com/", E_TEXT_TO_HTML_CONVERT_URLS | E_TEXT_TO_HTML_HIDE_URL_SCHEME,
+	  "<a href=\"http://www.foo.com/\">www.foo.com/</a>" },
+	{ "http://www.foo.com/;foo=bar&baz=quux", E_TEXT_TO_HTML_CONVERT_URLS,
+	  "<a href=\"http://www.foo.com/;foo=bar&amp;baz=quux\">http://www.foo.com/;foo=bar&amp;baz=quux</a>" },
+	{ "www.foo.com", E_TEXT_TO_HTML_CONVERT_URLS,
+	  "<a href=\"http://www.foo.com\">www.foo.com</a>" },
+	{ "src/www.c", E_TEXT_TO_HTML_CONVERT_URLS, "src/www.c" },
+	{ "mail bob@foo.com", 0, "mail bob@foo.com" },
+	{ "mail bob@foo.com", E_TEXT_TO_HTML_CONVERT_ADDRESSES,
+	  "mail <a href=\"mailto:bob@foo.com\">bob@foo.com</a>" },
+	{ "M@ke money", E_TEXT_TO_HTML_CONVERT_ADDRESSES, "M@ke money" },
+	{ "> quoted\nplain", E_TEXT_TO_HTML_MARK_CITATION,
+	  "<FONT COLOR=\"#737373\">&gt; quoted\n</FONT>plain" },
+	{ "a\nb", E_TEXT_TO_HTML_CITE, "&gt; a\n&gt; b" }
+};
+
+static void
+test_html_utils_conversions (void)
+{
+	guint ii;
+
+	for (ii = 0; ii < G_N_ELEMENTS (conversions); ii++) {
+		gchar *html;
+
+		html = e_text_to_html_full (conversions[ii].text, conversions[ii].flags, CITATION_COLOR);
+		g_assert_cmpstr (html, ==, conversions[ii].html);
+		g_free (html);
+	}
+}
+
+/* Whatever the flags are, the plain text runs are copied as they are */
+static void
+test_html_utils_plain_runs (void)
+{
+	GString *text;
+	gchar *html;
+	guint flags;
+
+	text = g_string_new (NULL);
+
+	while (text->len < 1024 * 1024)
+		g_string_append (text, "Plain,text-with.no;special/characters_at:all!");
+
+	for (flags = 0; flags < E_TEXT_TO_HTML_LAST_FLAG; flags++) {
+		if ((flags & (E_TEXT_TO_HTML_PRE | E_TEXT_TO_HTML_CITE)) != 0)
+			continue;
+
+		html = e_text_to_html_full (text->str, flags, CITATION_COLOR);
+		g_assert_cmpstr (html, ==, text->str);
+		g_free (html);
+	}
+
+	g_string_free (text, TRUE);
+}
+
+/* The implementation before the plain text runs were copied at once,
+ * the output of e_text_to_html_full() is compared with */
+
+static gchar *
+reference_check_size (gchar **buffer,
+                      gint *buffer_size,
+                      gchar *out,
+                      gint len)
+{
+	if (out + len + 1> *buffer + *buffer_size) {
+		gint index = out - *buffer;
+
+		*buffer_size = MAX (index + len + 1, *buffer_size * 2);
+		*buffer = g_realloc (*buffer, *buffer_size);
+		out = *buffer + index;
+	}
+	return out;
+}
+
+/* auto-urlification hints: the goal is not to be strictly RFC-compliant,
+ * but rather to accurately distinguish urls/addresses from non-urls/
+ * addresses in real-world email.
+ *
+ * 1 = non-email-address chars: ()<>@,;:\"[]`'{}|
+ * 2 = trailing url garbage:    ,.!?;:>)]}`'-_
+ * 4 = allowed dns chars
+ * 8 = non-url chars:           "|
+ */
+static gint reference_special_chars[] = {
+	9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,    /*  nul - 0x0f */
+	9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,    /* 0x10 - 0x1f */
+	9, 2, 9, 0, 0, 0, 0, 3, 1, 3, 0, 0, 3, 6, 6, 0,    /*   sp - /    */
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 3, 3, 1, 0, 3, 2,    /*    0 - ?    */
+	1, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,    /*    @ - O    */
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 1, 1, 3, 0, 2,    /*    P - _    */
+	3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,    /*    ` - o    */
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 1, 9, 3, 0, 3     /*    p - del  */
+};
+
+#define is_addr_char(c) (c < 128 && !(reference_special_chars[c] & 1))
+#define is_url_char(c) (c < 128 && !(reference_special_chars[c] & 8))
+#define is_trailing_garbage(c) (c > 127 || (reference_special_chars[c] & 2))
+#define is_domain_name_char(c) (c < 128 && (reference_special_chars[c] & 4))
+
+/* (http|https|ftp|nntp)://[^ "|/]+\.([^ "|]*[^ ,.!?;:>)\]}`'"|_-])+ */
+/* www\.[A-Za-z0-9.-]+(/([^ "|]*[^ ,.!?;:>)\]}`'"|_-])+)             */
+
+static gchar *
+reference_url_extract (const guchar **text,
+                       gboolean full_url,
+                       gboolean use_whole_text)
+{
+	const guchar *end = *text, *p;
+	gchar *out;
+
+	if (use_whole_text) {
+		end = (*text) + strlen ((const gchar *) (*text));
+	} else {
+		while (*end && is_url_char (*end))
+			end++;
+	}
+
+	/* Back up if we probably went too far. */
+	while (end > *text && is_trailing_garbage (*(end - 1)))
+		end--;
+
+	if (full_url) {
+		/* Make sure this really looks like a URL. */
+		p = memchr (*text, ':', end - *text);
+		if (!p || end - p < 4)
+			return NULL;
+	} else {
+		/* Make sure this really looks like a hostname. */
+		p = memchr (*text, '.', end - *text);
+		if (!p || p >= end - 2)
+			return NULL;
+		p = memchr (p + 2, '.', end - (p + 2));
+		if (!p || p >= end - 2)
+			return NULL;
+	}
+
+	out = g_strndup ((gchar *) * text, end - *text);
+	*text = end;
+	return out;
+}
+
+static gchar *
+reference_email_address_extract (const guchar **cur,
+                                 gchar **out,
+                                 const guchar *linestart)
+{
+	const guchar *start, *end, *dot;
+	gchar *addr;
+
+	/* *cur points to the '@'. Look backward for a valid local-part */
+	for (start = *cur; start - 1 >= linestart && is_addr_char (*(start - 1)); start--)
+		;
+	if (start == *cur)
+		return NULL;
+	if (start > linestart + 2 &&
+	    start[-1] == ':' && start[0] == '/' && start[1] == '/')
+		return NULL;
+
+	/* Now look forward for a valid domain part */
+	for (end = *cur + 1, dot = NULL; is_domain_name_char (*end); end++) {
+		if (*end == '.' && !dot)
+			dot = end;
+	}
+	if (!dot)
+		return NULL;
+
+	/* Remove trailing garbage */
+	while (is_trailing_garbage (*(end - 1)))
+		end--;
+	if (dot > end)
+		return NULL;
+
+	addr = g_strndup ((gchar *) start, end - start);
+	*out -= *cur - start;
+	*cur = end;
+
+	return addr;
+}
+
+static gboolean
+reference_is_citation (const guchar *c,
+                       gboolean saw_citation)
+{
+	const guchar *p;
+
+	if (*c != '>')
+		return FALSE;
+
+	/* A line that starts with a ">" is a citation, unless it's
+	 * just mbox From-mangling...
+	 */
+	if (strncmp ((const gchar *) c, ">From ", 6) != 0)
+		return TRUE;
+
+	/* If the previous line was a citation, then say this
+	 * one is too.
+	 */
+	if (saw_citation)
+		return TRUE;
+
+	/* Same if the next line is */
+	p = (const guchar *) strchr ((const gchar *) c, '\n');
+	if (p && *++p == '>')
+		return TRUE;
+
+	/* Otherwise, it was just an isolated ">From" line. */
+	return FALSE;
+}
+
+static gchar *
+reference_text_to_html_full (const gchar *input,
+                             guint flags,
+                             guint32 color)
+{
+	const guchar *cur, *next, *linestart;
+	gchar *buffer = NULL;
+	gchar *out = NULL;
+	gint buffer_size = 0, col;
+	gboolean colored = FALSE, saw_citation = FALSE;
+
+	/* Allocate a translation buffer.  */
+	buffer_size = strlen (input) * 2 + 5;
+	buffer = g_malloc (buffer_size);
+
+	out = buffer;
+	if (flags & E_TEXT_TO_HTML_PRE)
+		out += sprintf (out, "<PRE>");
+
+	col = 0;
+
+	for (cur = linestart = (const guchar *) input; cur && *cur; cur = next) {
+		gunichar u;
+
+		if (flags & E_TEXT_TO_HTML_MARK_CITATION && col == 0) {
+			saw_citation = reference_is_citation (cur, saw_citation);
+			if (saw_citation) {
+				if (!colored) {
+					gchar font[25];
+
+					g_snprintf (font, 25, "<FONT COLOR=\"#%06x\">", color);
+
+					out = reference_check_size (&buffer, &buffer_size, out, 25);
+					out += sprintf (out, "%s", font);
+					colored = TRUE;
+				}
+			} else if (colored) {
+				const gchar *no_font = "</FONT>";
+
+				out = reference_check_size (&buffer, &buffer_size, out, 9);
+				out += sprintf (out, "%s", no_font);
+				colored = FALSE;
+			}
+
+			/* Display mbox-mangled ">From" as "From" */
+			if (*cur == '>' && !saw_citation)
+				cur++;
+		} else if (flags & E_TEXT_TO_HTML_CITE && col == 0) {
+			out = reference_check_size (&buffer, &buffer_size, out, 5);
+			out += sprintf (out, "&gt; ");
+		}
+
+		u = g_utf8_get_char ((gchar *) cur);
+		if (g_unichar_isalpha (u) &&
+		    (flags & E_TEXT_TO_HTML_CONVERT_URLS)) {
+			gchar *tmpurl = NULL, *refurl = NULL, *dispurl = NULL;
+
+			if (!g_ascii_strncasecmp ((gchar *) cur, "http://", 7) ||
+			    !g_ascii_strncasecmp ((gchar *) cur, "https://", 8) ||
+			    !g_ascii_strncasecmp ((gchar *) cur, "ftp://", 6) ||
+			    !g_ascii_strncasecmp ((gchar *) cur, "nntp://", 7) ||
+			    !g_ascii_strncasecmp ((gchar *) cur, "mailto:", 7) ||
+			    !g_ascii_strncasecmp ((gchar *) cur, "news:", 5) ||
+			    !g_ascii_strncasecmp ((gchar *) cur, "file:", 5) ||
+			    !g_ascii_strncasecmp ((gchar *) cur, "callto:", 7) ||
+			    !g_ascii_strncasecmp ((gchar *) cur, "h323:", 5) ||
+			    !g_ascii_strncasecmp ((gchar *) cur, "sip:", 4) ||
+			    !g_ascii_strncasecmp ((gchar *) cur, "tel:", 4) ||
+			    !g_ascii_strncasecmp ((gchar *) cur, "webcal:", 7)) {
+				tmpurl = reference_url_extract (&cur, TRUE, (flags & E_TEXT_TO_HTML_URL_IS_WHOLE_TEXT) != 0);
+				if (tmpurl) {
+					refurl = e_text_to_html (tmpurl, 0);
+					if ((flags & E_TEXT_TO_HTML_HIDE_URL_SCHEME) != 0) {
+						const gchar *str;
+
+						str = strchr (refurl, ':');
+						if (str) {
+							str++;
+							if (g_ascii_strncasecmp (str, "//", 2) == 0) {
+								str += 2;
+							}
+
+							dispurl = g_strdup (str);
+						} else {
+							dispurl = g_strdup (refurl);
+						}
+					} else {
+						dispurl = g_strdup (refurl);
+					}
+				}
+			} else if (!g_ascii_strncasecmp ((gchar *) cur, "www.", 4) &&
+				   is_url_char (*(cur + 4))) {
+				tmpurl = reference_url_extract (&cur, FALSE, (flags & E_TEXT_TO_HTML_URL_IS_WHOLE_TEXT) != 0);
+				if (tmpurl) {
+					dispurl = e_text_to_html (tmpurl, 0);
+					refurl = g_strdup_printf (
+						"http://%s", dispurl);
+				}
+			}
+
+			if (tmpurl) {
+				if ((flags & E_TEXT_TO_HTML_URL_IS_WHOLE_TEXT) != 0) {
+					/* also remove any spaces in refurl */
+					gchar *replaced, **split_url;
+
+					split_url = g_strsplit (refurl, " ", 0);
+					replaced = g_strjoinv ("", split_url);
+					g_strfreev (split_url);
+
+					g_free (refurl);
+					refurl = replaced;
+				}
+
+				out = reference_check_size (
+					&buffer, &buffer_size, out,
+					strlen (refurl) +
+					strlen (dispurl) + 15);
+				out += sprintf (out,
+						"<a href=\"%s\">%s</a>",
+						refurl, dispurl);
+				col += strlen (tmpurl);
+				g_free (tmpurl);
+				g_free (refurl);
+				g_free (dispurl);
+			}
+
+			if (!*cur)
+				break;
+			u = g_utf8_get_char ((gchar *) cur);
+		}
+
+		if (u == '@' && (flags & E_TEXT_TO_HTML_CONVERT_ADDRESSES)) {
+			gchar *addr, *dispaddr, *outaddr;
+
+			addr = reference_email_address_extract (&cur, &out, linestart);
+			if (addr) {
+				dispaddr = e_text_to_html (addr, 0);
+				outaddr = g_strdup_printf (
+					"<a href=\"mailto:%s\">%s</a>",
+					addr, dispaddr);
+				out = reference_check_size (&buffer, &buffer_size, out, strlen (outaddr));
+				out += sprintf (out, "%s", outaddr);
+				col += strlen (addr);
+				g_free (addr);
+				g_free (dispaddr);
+				g_free (outaddr);
+
+				if (!*cur)
+					break;
+				u = g_utf8_get_char ((gchar *) cur);
+			}
+		}
+
+		if (!g_unichar_validate (u)) {
+			/* Sigh. Someone sent undeclared 8-bit data.
+			 * Assume it's iso-8859-1.
+			 */
+			u = *cur;
+			next = cur + 1;
+		} else
+			next = (const guchar *) g_utf8_next_char (cur);
+
+		out = reference_check_size (&buffer, &buffer_size, out, 10);
+
+		switch (u) {
+		case '<':
+			strcpy (out, "&lt;");
+			out += 4;
+			col++;
+			break;
+
+		case '>':
+			strcpy (out, "&gt;");
+			out += 4;
+			col++;
+			break;
+
+		case '&':
+			strcpy (out, "&amp;");
+			out += 5;
+			col++;
+			break;
+
+		case '"':
+			strcpy (out, "&quot;");
+			out += 6;
+			col++;
+			break;
+
+		case '\n':
+			if (flags & E_TEXT_TO_HTML_CONVERT_NL) {
+				strcpy (out, "<br>");
+				out += 4;
+			}
+			*out++ = *cur;
+			linestart = cur;
+			col = 0;
+			break;
+
+		case '\t':
+			if (flags & (E_TEXT_TO_HTML_CONVERT_SPACES |
+				     E_TEXT_TO_HTML_CONVERT_NL)) {
+				do {
+					out = reference_check_size (
+						&buffer, &buffer_size, out, 7);
+					strcpy (out, "&nbsp;");
+					out += 6;
+					col++;
+				} while (col % 8);
+				break;
+			}
+			/* otherwise, FALL THROUGH */
+
+		case ' ':
+			if (flags & E_TEXT_TO_HTML_CONVERT_SPACES) {
+				if (cur == (const guchar *) input ||
+				    *(cur + 1) == ' ' || *(cur + 1) == '\t' ||
+				    *(cur - 1) == '\n') {
+					strcpy (out, "&nbsp;");
+					out += 6;
+					col++;
+					break;
+				}
+			}
+			/* otherwise, FALL THROUGH */
+
+		default:
+			if ((u >= 0x20 && u < 0x80) ||
+			    (u == '\r' || u == '\t')) {
+				/* Default case, just copy. */
+				*out++ = u;
+			} else {
+				if (flags & E_TEXT_TO_HTML_ESCAPE_8BIT)
+					*out++ = '?';
+				else
+					out += g_snprintf (out, 9, "&#%d;", u);
+			}
+			col++;
+			break;
+		}
+	}
+
+	out = reference_check_size (&buffer, &buffer_size, out, 7);
+	if (flags & E_TEXT_TO_HTML_PRE)
+		strcpy (out, "</PRE>");
+	else
+		*out = '\0';
+
+	return buffer;
+}
+
+/* The link e_text_to_html() finds in the text, if any */
+static const struct {
+	const gchar *text;
+	const gchar *url;
+} url_tests[] = {
+	{ "bob@foo.com", "mailto:bob@foo.com" },
+	{ "Ends with bob@foo.com", "mailto:bob@foo.com" },
+	{ "bob@foo.com at start", "mailto:bob@foo.com" },
+	{ "bob@foo.com.", "mailto:bob@foo.com" },
+	{ "\"bob@foo.com\"", "mailto:bob@foo.com" },
+	{ "<bob@foo.com>", "mailto:bob@foo.com" },
+	{ "(bob@foo.com)", "mailto:bob@foo.com" },
+	{ "bob@foo.com, 555-9999", "mailto:bob@foo.com" },
+	{ "|bob@foo.com|555-9999|", "mailto:bob@foo.com" },
+	{ "bob@ no match bob@", NULL },
+	{ "@foo.com no match @foo.com", NULL },
+	{ "\"bob\"@foo.com", NULL },
+	{ "M@ke money fast!", NULL },
+	{ "ASCII art @_@ @>->-", NULL },
+
+	{ "http://www.foo.com", "http://www.foo.com" },
+	{ "Ends with http://www.foo.com", "http://www.foo.com" },
+	{ "http://www.foo.com at start", "http://www.foo.com" },
+	{ "http://www.foo.com.", "http://www.foo.com" },
+	{ "http://www.foo.com/.", "http://www.foo.com/" },
+	{ "<http://www.foo.com>", "http://www.foo.com" },
+	{ "(http://www.foo.com)", "http://www.foo.com" },
+	{ "http://www.foo.com, 555-9999", "http://www.foo.com" },
+	{ "|http://www.foo.com|555-9999|", "http://www.foo.com" },
+	{ "foo http://www.foo.com/ bar", "http://www.foo.com/" },
+	{ "foo http://www.foo.com/index.html bar",
+	  "http://www.foo.com/index.html" },
+	{ "foo http://www.foo.com/q?99 bar", "http://www.foo.com/q?99" },
+	{ "foo http://www.foo.com/;foo=bar&baz=quux bar",
+	  "http://www.foo.com/;foo=bar&baz=quux" },
+	{ "foo http://www.foo.com/index.html#anchor bar",
+	  "http://www.foo.com/index.html#anchor" },
+	{ "http://www.foo.com/index.html; foo",
+	  "http://www.foo.com/index.html" },
+	{ "http://www.foo.com/index.html: foo",
+	  "http://www.foo.com/index.html" },
+	{ "http://www.foo.com/index.html-- foo",
+	  "http://www.foo.com/index.html" },
+	{ "http://www.foo.com/index.html?",
+	  "http://www.foo.com/index.html" },
+	{ "http://www.foo.com/index.html!",
+	  "http://www.foo.com/index.html" },
+	{ "\"http://www.foo.com/index.html\"",
+	  "http://www.foo.com/index.html" },
+	{ "'http://www.foo.com/index.html'",
+	  "http://www.foo.com/index.html" },
+	{ "http://bob@www.foo.com/bar/baz/",
+	  "http://bob@www.foo.com/bar/baz/" },
+	{ "http no match http", NULL },
+	{ "http: no match http:", NULL },
+	{ "http:// no match http://", NULL },
+	{ "unrecognized://bob@foo.com/path", NULL },
+
+	{ "src/www.c", NULL },
+	{ "Ewwwwww.Gross.", NULL }
+};
+
+/* Converted with every combination of the flags by both implementations */
+static const gchar *equivalence_texts[] = {
+	"",
+	"Plain text without anything special",
+	"Escapes: <tag> & \"quoted\" text > less",
+	"Tabs\tand  spaces\t\tin  the\ttext\n\tindented line\n",
+	"> quoted line\n>> nested quote\nnot quoted\n> quoted again\n",
+	"Visit http://www.example.com/path?a=1&b=2, or www.example.org.\n",
+	"Mail bob@example.com or <alice@example.org>; mailto:carol@example.net\n",
+	"Schemes: https://a.b/c ftp://ftp.example.com/pub news:comp.lang.c "
+	"file:///tmp/x callto:someone h323:host sip:user@host tel:+123456 "
+	"webcal://cal.example.com/x.ics nntp://news.example.com/group\n",
+	"HTTP://UPPER.EXAMPLE.COM/ and WWW.UPPER.COM/Path\n",
+	"UTF-8: P\xc5\x99\xc3\xadli\xc5\xa1 \xc5\xbelu\xc5\xa5ou\xc4\x8dk\xc3\xbd "
+	"k\xc5\xaf\xc5\x88 \xe2\x82\xac \xf0\x9f\x98\x80\n",
+	"Not URLs: src/www.c Ewwwwww.Gross. http: no match, M@ke money, @_@\n",
+	"Carriage\r\nreturn\r\nlines\r\n",
+	"Mixed > citations\n> http://quoted.example.com/ bob@quoted.example.com\n\t> tab then gt\n",
+	"http://www.example.com/with space in whole text",
+	"bob@example.com"
+};
+
+/* Paragraph repeated into a multi-megabyte text, to time the conversion */
+static const gchar *timing_paragraph =
+	"> On Monday, Bob <bob@example.com> wrote:\n"
+	"> > See http://www.example.com/changes?id=42&view=full for details.\n"
+	"\n"
+	"Thanks, the patch at www.example.org/patches/fix.diff looks good to me.\n"
+	"\tIt changes \"e-html-utils.c\" & a few <other> files; a quick review\n"
+	"  should be enough.  Write to alice@example.net when you are done.\n"
+	"P\xc5\x99\xc3\xadli\xc5\xa1 \xc5\xbelu\xc5\xa5ou\xc4\x8dk\xc3\xbd k\xc5\xaf\xc5\x88 \xe2\x82\xac\n"
+	"\n";
+
+static void
+test_html_utils_urls (void)
+{
+	guint ii;
+
+	for (ii = 0; ii < G_N_ELEMENTS (url_tests); ii++) {
+		gchar *html, *url, *p;
+
+		html = e_text_to_html (
+			url_tests[ii].text,
+			E_TEXT_TO_HTML_CONVERT_URLS |
+			E_TEXT_TO_HTML_CONVERT_ADDRESSES);
+
+		url = strstr (html, "href=\"");
+		if (url) {
+			url += 6;
+			p = strchr (url, '"');
+			if (p)
+				*p = '\0';
+
+			while ((p = strstr (url, "&amp;")))
+				memmove (p + 1, p + 5, strlen (p + 5) + 1);
+		}
+
+		g_assert_cmpstr (url, ==, url_tests[ii].url);
+
+		g_free (html);
+	}
+}
+
+static void
+test_html_utils_equivalence (void)
+{
+	guint ii, flags;
+
+	for (ii = 0; ii < G_N_ELEMENTS (equivalence_texts); ii++) {
+		for (flags = 0; flags < E_TEXT_TO_HTML_LAST_FLAG; flags++) {
+			gchar *expected, *html;
+
+			expected = reference_text_to_html_full (equivalence_texts[ii], flags, CITATION_COLOR);
+			html = e_text_to_html_full (equivalence_texts[ii], flags, CITATION_COLOR);
+
+			g_assert_cmpstr (html, ==, expected);
+
+			g_free (expected);
+			g_free (html);
+		}
+	}
+}
+
+static void
+test_html_utils_timing (void)
+{
+	GString *text;
+	GTimer *timer;
+	gchar *expected, *html;
+	gdouble reference_time, time;
+	guint flags;
+
+	/* The flags the mail formatter uses for text/plain parts */
+	flags = E_TEXT_TO_HTML_CONVERT_NL | E_TEXT_TO_HTML_CONVERT_SPACES |
+		E_TEXT_TO_HTML_CONVERT_URLS | E_TEXT_TO_HTML_CONVERT_ADDRESSES |
+		E_TEXT_TO_HTML_MARK_CITATION;
+
+	text = g_string_sized_new (TIMING_TEXT_SIZE + strlen (timing_paragraph));
+	while (text->len < TIMING_TEXT_SIZE)
+		g_string_append (text, timing_paragraph);
+
+	timer = g_timer_new ();
+
+	g_timer_start (timer);
+	expected = reference_text_to_html_full (text->str, flags, CITATION_COLOR);
+	reference_time = g_timer_elapsed (timer, NULL);
+
+	g_timer_start (timer);
+	html = e_text_to_html_full (text->str, flags, CITATION_COLOR);
+	time = g_timer_elapsed (timer, NULL);
+
+	g_test_message (
+		"Converted %" G_GSIZE_FORMAT " bytes in %.3f seconds, previously in %.3f seconds",
+		text->len, time, reference_time);
+
+	g_assert_cmpstr (html, ==, expected);
+
+	g_timer_destroy (timer);
+	g_string_free (text, TRUE);
+	g_free (expected);
+	g_free (html);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/EHtmlUtils/Conversions", test_html_utils_conversions);
+	g_test_add_func ("/EHtmlUtils/PlainRuns", test_html_utils_plain_runs);
+	g_test_add_func ("/EHtmlUtils/URLs", test_html_utils_urls);
+	g_test_add_func ("/EHtmlUtils/Equivalence", test_html_utils_equivalence);
+
+	/* Run with -m perf to compare the speed with the previous implementation */
+	if (g_test_perf ())
+		g_test_add_func ("/EHtmlUtils/Timing", test_html_utils_timing);
+
+	return g_test_run ();
+}
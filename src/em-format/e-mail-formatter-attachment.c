@@ -199,7 +199,18 @@ emfe_attachment_format (EMailFormatterExtension *extension,
 		icon_height = 16;
 	}
 
-	if (extensions != NULL) {
+	e_mail_part_attachment_set_content_deferred (empa, FALSE);
+
+	if (extensions != NULL && !e_mail_part_should_show_inline (part) &&
+	    empa->part_id_with_attachment == NULL &&
+	    e_mail_extension_registry_get_for_mime_type (registry, empa->snoop_mime_type)) {
+		/* A collapsed attachment with its own formatter; its content
+		 * is formatted only when the user expands it, which keeps
+		 * large attachments from holding back the message itself. */
+		e_mail_part_attachment_set_content_deferred (empa, TRUE);
+		e_mail_part_attachment_set_expandable (empa, TRUE);
+
+	} else if (extensions != NULL) {
 		gboolean success = FALSE;
 
 		content_stream = g_memory_output_stream_new_resizable ();
@@ -314,6 +325,15 @@ emfe_attachment_format (EMailFormatterExtension *extension,
 		g_string_append (buffer, "</div></td></tr>");
 
 		g_free (wrapper_element_id);
+
+	} else if (e_mail_part_attachment_get_content_deferred (empa)) {
+		/* EMailDisplay fills the content in when expanding it. */
+		g_string_append_printf (
+			buffer,
+			"<tr><td colspan=\"2\">"
+			"<div class=\"attachment-wrapper\" id=\"attachment-wrapper-%p\""
+			" related-part-id=\"%s\"></div></td></tr>",
+			attachment_ptr, attachment_part_id);
 	}
 
 	g_clear_object (&content_stream);
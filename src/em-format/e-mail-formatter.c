@@ -40,6 +40,7 @@
 	"evo-file://" EVOLUTION_PRIVDATADIR "/theme/webview.css"
 
 typedef struct _AsyncContext AsyncContext;
+typedef struct _FormatChunkedData FormatChunkedData;
 
 struct _EMailFormatterPrivate {
 	EImageLoadingPolicy image_loading_policy;
@@ -61,6 +62,19 @@ struct _AsyncContext {
 	EMailFormatterMode mode;
 };
 
+struct _FormatChunkedData {
+	EMailFormatter *formatter;
+	EMailFormatterContext *context;
+	GCancellable *cancellable;
+	GQueue queue;
+	GList *link;
+	gboolean started;
+
+	EMailFormatterChunkFunc chunk_func;
+	gpointer user_data;
+	GDestroyNotify user_data_free;
+};
+
 /* internal formatter extensions */
 GType e_mail_formatter_attachment_get_type (void);
 GType e_mail_formatter_audio_get_type (void);
@@ -380,107 +394,122 @@ e_mail_formatter_constructed (GObject *object)
 	e_extensible_load_extensions (E_EXTENSIBLE (object));
 }
 
-static void
-mail_formatter_run (EMailFormatter *formatter,
-                    EMailFormatterContext *context,
-                    GOutputStream *stream,
-                    GCancellable *cancellable)
+/* Formats the part at @link and returns the link of the next part to
+ * format, or %NULL when there is nothing more to be written. */
+static GList *
+mail_formatter_run_link (EMailFormatter *formatter,
+                         EMailFormatterContext *context,
+                         GList *link,
+                         GOutputStream *stream,
+                         GCancellable *cancellable)
 {
-	GQueue queue = G_QUEUE_INIT;
-	GList *head, *link;
-	gchar *hdr;
-	const gchar *string;
+	EMailPart *part = link->data;
+	const gchar *part_id;
+	gboolean ok;
 
-	hdr = e_mail_formatter_get_html_header (formatter);
-	g_output_stream_write_all (
-		stream, hdr, strlen (hdr), NULL, cancellable, NULL);
-	g_free (hdr);
+	part_id = e_mail_part_get_id (part);
 
-	e_mail_part_list_queue_parts (context->part_list, NULL, &queue);
+	if (g_cancellable_is_cancelled (cancellable))
+		return NULL;
 
-	head = g_queue_peek_head_link (&queue);
+	if (part->is_hidden && !part->is_error) {
+		if (e_mail_part_id_has_suffix (part, ".rfc822")) {
+			link = e_mail_formatter_find_rfc822_end_iter (link);
+		}
 
-	for (link = head; link != NULL; link = g_list_next (link)) {
-		EMailPart *part = link->data;
-		const gchar *part_id;
-		gboolean ok;
+		if (link == NULL)
+			return NULL;
 
-		part_id = e_mail_part_get_id (part);
+		return g_list_next (link);
+	}
 
-		if (g_cancellable_is_cancelled (cancellable))
-			break;
+	/* Force formatting as source if needed */
+	if (context->mode != E_MAIL_FORMATTER_MODE_SOURCE) {
+		const gchar *mime_type;
+
+		mime_type = e_mail_part_get_mime_type (part);
+		if (mime_type == NULL)
+			return g_list_next (link);
+
+		ok = e_mail_formatter_format_as (
+			formatter, context, part, stream,
+			mime_type, cancellable);
 
-		if (part->is_hidden && !part->is_error) {
-			if (e_mail_part_id_has_suffix (part, ".rfc822")) {
-				link = e_mail_formatter_find_rfc822_end_iter (link);
-			}
+		/* If the written part was message/rfc822 then
+		 * jump to the end of the message, because content
+		 * of the whole message has been formatted by
+		 * message_rfc822 formatter */
+		if (ok && e_mail_part_id_has_suffix (part, ".rfc822")) {
+			link = e_mail_formatter_find_rfc822_end_iter (link);
 
 			if (link == NULL)
-				break;
+				return NULL;
 
-			continue;
+			return g_list_next (link);
 		}
 
-		/* Force formatting as source if needed */
-		if (context->mode != E_MAIL_FORMATTER_MODE_SOURCE) {
-			const gchar *mime_type;
+	} else {
+		ok = FALSE;
+	}
+
+	if (!ok) {
+		/* We don't want to source these */
+		if (e_mail_part_id_has_suffix (part, ".headers"))
+			return g_list_next (link);
 
-			mime_type = e_mail_part_get_mime_type (part);
-			if (mime_type == NULL)
-				continue;
+		e_mail_formatter_format_as (
+			formatter, context, part, stream,
+			"application/vnd.evolution.source", cancellable);
 
-			ok = e_mail_formatter_format_as (
-				formatter, context, part, stream,
-				mime_type, cancellable);
+		/* .message is the entire message. There's nothing more
+		 * to be written. */
+		if (g_strcmp0 (part_id, ".message") == 0)
+			return NULL;
 
-			/* If the written part was message/rfc822 then
-			 * jump to the end of the message, because content
-			 * of the whole message has been formatted by
-			 * message_rfc822 formatter */
-			if (ok && e_mail_part_id_has_suffix (part, ".rfc822")) {
-				link = e_mail_formatter_find_rfc822_end_iter (link);
+		/* If we just wrote source of a rfc822 message, then jump
+		 * behind the message (otherwise source of all parts
+		 * would be rendered twice) */
+		if (e_mail_part_id_has_suffix (part, ".rfc822")) {
 
-				if (link == NULL)
+			do {
+				part = link->data;
+				if (e_mail_part_id_has_suffix (part, ".rfc822.end"))
 					break;
 
-				continue;
-			}
+				link = g_list_next (link);
+			} while (link != NULL);
 
-		} else {
-			ok = FALSE;
+			if (link == NULL)
+				return NULL;
 		}
+	}
 
-		if (!ok) {
-			/* We don't want to source these */
-			if (e_mail_part_id_has_suffix (part, ".headers"))
-				continue;
-
-			e_mail_formatter_format_as (
-				formatter, context, part, stream,
-				"application/vnd.evolution.source", cancellable);
+	return g_list_next (link);
+}
 
-			/* .message is the entire message. There's nothing more
-			 * to be written. */
-			if (g_strcmp0 (part_id, ".message") == 0)
-				break;
+static void
+mail_formatter_run (EMailFormatter *formatter,
+                    EMailFormatterContext *context,
+                    GOutputStream *stream,
+                    GCancellable *cancellable)
+{
+	GQueue queue = G_QUEUE_INIT;
+	GList *link;
+	gchar *hdr;
+	const gchar *string;
 
-			/* If we just wrote source of a rfc822 message, then jump
-			 * behind the message (otherwise source of all parts
-			 * would be rendered twice) */
-			if (e_mail_part_id_has_suffix (part, ".rfc822")) {
+	hdr = e_mail_formatter_get_html_header (formatter);
+	g_output_stream_write_all (
+		stream, hdr, strlen (hdr), NULL, cancellable, NULL);
+	g_free (hdr);
 
-				do {
-					part = link->data;
-					if (e_mail_part_id_has_suffix (part, ".rfc822.end"))
-						break;
+	e_mail_part_list_queue_parts (context->part_list, NULL, &queue);
 
-					link = g_list_next (link);
-				} while (link != NULL);
+	link = g_queue_peek_head_link (&queue);
 
-				if (link == NULL)
-					break;
-			}
-		}
+	while (link != NULL) {
+		link = mail_formatter_run_link (
+			formatter, context, link, stream, cancellable);
 	}
 
 	while (!g_queue_is_empty (&queue))
@@ -953,6 +982,165 @@ e_mail_formatter_format_finish (EMailFormatter *formatter,
 	return !g_simple_async_result_propagate_error (simple, error);
 }
 
+static void
+format_chunked_data_free (gpointer ptr)
+{
+	FormatChunkedData *fcd = ptr;
+
+	if (fcd) {
+		while (!g_queue_is_empty (&fcd->queue))
+			g_object_unref (g_queue_pop_head (&fcd->queue));
+
+		if (fcd->user_data_free)
+			fcd->user_data_free (fcd->user_data);
+
+		mail_formatter_free_context (fcd->context);
+		g_clear_object (&fcd->cancellable);
+		g_clear_object (&fcd->formatter);
+		g_slice_free (FormatChunkedData, fcd);
+	}
+}
+
+/* Formats the next part; returns whether there is anything left */
+static gboolean
+mail_formatter_format_next_chunk (FormatChunkedData *fcd)
+{
+	EMailFormatterClass *class;
+	GOutputStream *stream;
+	GBytes *bytes;
+	gboolean done = FALSE;
+
+	class = E_MAIL_FORMATTER_GET_CLASS (fcd->formatter);
+
+	stream = g_memory_output_stream_new_resizable ();
+
+	if (class->run != mail_formatter_run) {
+		/* Derived formatters write the whole message at once. */
+		class->run (fcd->formatter, fcd->context, stream, fcd->cancellable);
+		done = TRUE;
+	} else {
+		if (!fcd->started) {
+			gchar *hdr;
+
+			hdr = e_mail_formatter_get_html_header (fcd->formatter);
+			g_output_stream_write_all (
+				stream, hdr, strlen (hdr),
+				NULL, fcd->cancellable, NULL);
+			g_free (hdr);
+
+			e_mail_part_list_queue_parts (fcd->context->part_list, NULL, &fcd->queue);
+
+			fcd->link = g_queue_peek_head_link (&fcd->queue);
+			fcd->started = TRUE;
+		} else if (fcd->link) {
+			fcd->link = mail_formatter_run_link (
+				fcd->formatter, fcd->context, fcd->link,
+				stream, fcd->cancellable);
+		}
+
+		if (!fcd->link) {
+			const gchar *string = "</body></html>";
+
+			g_output_stream_write_all (
+				stream, string, strlen (string),
+				NULL, fcd->cancellable, NULL);
+			done = TRUE;
+		}
+	}
+
+	g_output_stream_close (stream, NULL, NULL);
+
+	bytes = g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (stream));
+
+	if (g_bytes_get_size (bytes) > 0 &&
+	    !fcd->chunk_func (fcd->formatter, bytes, fcd->user_data))
+		done = TRUE;
+
+	g_bytes_unref (bytes);
+	g_object_unref (stream);
+
+	if (done)
+		fcd->chunk_func (fcd->formatter, NULL, fcd->user_data);
+
+	return !done;
+}
+
+static void
+mail_formatter_format_chunked_thread (GSimpleAsyncResult *simple,
+                                      GObject *object,
+                                      GCancellable *cancellable)
+{
+	FormatChunkedData *fcd;
+
+	fcd = g_simple_async_result_get_op_res_gpointer (simple);
+
+	while (mail_formatter_format_next_chunk (fcd)) {
+		/* Continue with the next part */
+	}
+}
+
+/**
+ * e_mail_formatter_format_chunked:
+ * @formatter: an #EMailFormatter
+ * @part_list: an #EMailPartList
+ * @flags: #EMailFormatterHeaderFlags
+ * @mode: an #EMailFormatterMode
+ * @cancellable: (nullable): an optional #GCancellable
+ * @chunk_func: an #EMailFormatterChunkFunc to pass the output to
+ * @user_data: user data for @chunk_func
+ * @user_data_free: (nullable): a #GDestroyNotify to free @user_data
+ *
+ * Formats the @part_list the same way as e_mail_formatter_format_sync()
+ * does, only in a dedicated thread, passing the output of each part
+ * to the @chunk_func as soon as the part is formatted; the @chunk_func
+ * is called from that thread.  This lets the output be shown before the whole message
+ * is formatted.  The @chunk_func returns %FALSE to stop the formatting;
+ * it is called one last time with a %NULL chunk when the formatting
+ * is finished or stopped.
+ **/
+void
+e_mail_formatter_format_chunked (EMailFormatter *formatter,
+                                 EMailPartList *part_list,
+                                 EMailFormatterHeaderFlags flags,
+                                 EMailFormatterMode mode,
+                                 GCancellable *cancellable,
+                                 EMailFormatterChunkFunc chunk_func,
+                                 gpointer user_data,
+                                 GDestroyNotify user_data_free)
+{
+	FormatChunkedData *fcd;
+	GSimpleAsyncResult *simple;
+
+	g_return_if_fail (E_IS_MAIL_FORMATTER (formatter));
+	g_return_if_fail (E_IS_MAIL_PART_LIST (part_list));
+	g_return_if_fail (chunk_func != NULL);
+
+	fcd = g_slice_new0 (FormatChunkedData);
+	fcd->formatter = g_object_ref (formatter);
+	fcd->context = mail_formatter_create_context (formatter, part_list, mode, flags);
+	fcd->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+	fcd->chunk_func = chunk_func;
+	fcd->user_data = user_data;
+	fcd->user_data_free = user_data_free;
+
+	simple = g_simple_async_result_new (
+		G_OBJECT (formatter), NULL, NULL,
+		e_mail_formatter_format_chunked);
+
+	g_simple_async_result_set_op_res_gpointer (
+		simple, fcd, format_chunked_data_free);
+
+	/* Large parts can take long to format, thus keep it off the main
+	 * thread; the output is shown while the rest is being formatted.
+	 * The @cancellable is not passed here, the thread should always run,
+	 * for the @chunk_func to be called with the final NULL chunk. */
+	g_simple_async_result_run_in_thread (
+		simple, mail_formatter_format_chunked_thread,
+		G_PRIORITY_DEFAULT, NULL);
+
+	g_object_unref (simple);
+}
+
 /**
  * e_mail_formatter_format_as:
  * @formatter: an #EMailFormatter
@@ -50,6 +50,10 @@ typedef struct _EMailFormatterClass EMailFormatterClass;
 typedef struct _EMailFormatterPrivate EMailFormatterPrivate;
 typedef struct _EMailFormatterContext EMailFormatterContext;
 
+typedef gboolean (*EMailFormatterChunkFunc)	(EMailFormatter *formatter,
+						 GBytes *chunk,
+						 gpointer user_data);
+
 struct _EMailFormatterContext {
 	EMailPartList *part_list;
 	EMailFormatterMode mode;
@@ -116,6 +120,15 @@ gboolean	e_mail_formatter_format_finish	(EMailFormatter *formatter,
 						 GAsyncResult *result,
 						 GError **error);
 
+void		e_mail_formatter_format_chunked	(EMailFormatter *formatter,
+						 EMailPartList *part_list,
+						 EMailFormatterHeaderFlags flags,
+						 EMailFormatterMode mode,
+						 GCancellable *cancellable,
+						 EMailFormatterChunkFunc chunk_func,
+						 gpointer user_data,
+						 GDestroyNotify user_data_free);
+
 gboolean	e_mail_formatter_format_as	(EMailFormatter *formatter,
 						 EMailFormatterContext *context,
 						 EMailPart *part,
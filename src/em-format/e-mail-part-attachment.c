@@ -24,6 +24,7 @@
 struct _EMailPartAttachmentPrivate {
 	EAttachment *attachment;
 	gboolean expandable;
+	gboolean content_deferred;
 };
 
 enum {
@@ -226,3 +227,22 @@ e_mail_part_attachment_get_expandable (EMailPartAttachment *part)
 
 	return part->priv->expandable;
 }
+
+/* Set by the attachment formatter when it leaves the content of
+ * a collapsed attachment to be formatted once it is expanded. */
+void
+e_mail_part_attachment_set_content_deferred (EMailPartAttachment *part,
+					     gboolean content_deferred)
+{
+	g_return_if_fail (E_IS_MAIL_PART_ATTACHMENT (part));
+
+	part->priv->content_deferred = content_deferred;
+}
+
+gboolean
+e_mail_part_attachment_get_content_deferred (EMailPartAttachment *part)
+{
+	g_return_val_if_fail (E_IS_MAIL_PART_ATTACHMENT (part), FALSE);
+
+	return part->priv->content_deferred;
+}
@@ -73,6 +73,11 @@ void		e_mail_part_attachment_set_expandable
 						 gboolean expandable);
 gboolean	e_mail_part_attachment_get_expandable
 						(EMailPartAttachment *part);
+void		e_mail_part_attachment_set_content_deferred
+						(EMailPartAttachment *part,
+						 gboolean content_deferred);
+gboolean	e_mail_part_attachment_get_content_deferred
+						(EMailPartAttachment *part);
 
 G_END_DECLS
 
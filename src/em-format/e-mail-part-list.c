@@ -434,3 +434,187 @@ e_mail_part_list_get_registry (void)
 
 	return registry;
 }
+
+/* The registry only holds weak references, thus a part list is gone as
+ * soon as no EMailDisplay shows it.  The most recently shown part lists
+ * are kept alive here, for a re-selected message to be displayed without
+ * being fetched and parsed (and possibly decrypted) again. */
+
+#define RECENT_MAX_ITEMS 8
+#define RECENT_MAX_SIZE (32 * 1024 * 1024)
+
+typedef struct _RecentItem {
+	EMailPartList *part_list;
+	gsize size;
+} RecentItem;
+
+typedef struct _RecentFolder {
+	gulong changed_handler_id;
+	guint n_items;
+} RecentFolder;
+
+/* Must hold the recent lock to access these. */
+static GQueue recent_items = G_QUEUE_INIT; /* RecentItem *, most recent first */
+static GHashTable *recent_folders = NULL; /* CamelFolder * ~> RecentFolder * */
+static gsize recent_size = 0;
+G_LOCK_DEFINE_STATIC (recent);
+
+static void mail_part_list_recent_folder_changed_cb (CamelFolder *folder,
+						     CamelFolderChangeInfo *changes,
+						     gpointer user_data);
+
+/* The part lists are returned in the @drop_part_lists, to be
+ * unreferenced once the lock is released. */
+static void
+mail_part_list_recent_drop_locked (GList *link,
+                                   GSList **drop_part_lists)
+{
+	RecentItem *item = link->data;
+	RecentFolder *rf;
+	CamelFolder *folder;
+
+	g_queue_delete_link (&recent_items, link);
+
+	folder = item->part_list->priv->folder;
+	rf = g_hash_table_lookup (recent_folders, folder);
+	if (rf && !--rf->n_items) {
+		g_signal_handler_disconnect (folder, rf->changed_handler_id);
+		g_hash_table_remove (recent_folders, folder);
+	}
+
+	recent_size -= item->size;
+
+	*drop_part_lists = g_slist_prepend (*drop_part_lists, item->part_list);
+	g_slice_free (RecentItem, item);
+}
+
+static void
+mail_part_list_recent_folder_changed_cb (CamelFolder *folder,
+                                         CamelFolderChangeInfo *changes,
+                                         gpointer user_data)
+{
+	GSList *drop_part_lists = NULL;
+	GHashTable *removed;
+	GList *link;
+	guint ii;
+
+	if (!changes || !changes->uid_removed || !changes->uid_removed->len)
+		return;
+
+	removed = g_hash_table_new (g_str_hash, g_str_equal);
+
+	for (ii = 0; ii < changes->uid_removed->len; ii++)
+		g_hash_table_add (removed, changes->uid_removed->pdata[ii]);
+
+	G_LOCK (recent);
+
+	link = g_queue_peek_head_link (&recent_items);
+	while (link) {
+		RecentItem *item = link->data;
+		GList *next = g_list_next (link);
+
+		if (item->part_list->priv->folder == folder &&
+		    g_hash_table_contains (removed, item->part_list->priv->message_uid))
+			mail_part_list_recent_drop_locked (link, &drop_part_lists);
+
+		link = next;
+	}
+
+	G_UNLOCK (recent);
+
+	g_hash_table_destroy (removed);
+	g_slist_free_full (drop_part_lists, g_object_unref);
+}
+
+/**
+ * e_mail_part_list_keep_recent:
+ * @part_list: an #EMailPartList
+ *
+ * Marks the @part_list as the most recently shown one.  A few of the most
+ * recently shown part lists, up to a total message size, are referenced,
+ * for them to stay in the registry returned by
+ * e_mail_part_list_get_registry() even when nothing else uses them.
+ * A part list is released once its message is removed from its folder.
+ * The @part_list is ignored when it has no folder or message UID set.
+ *
+ * Since: 3.32
+ **/
+void
+e_mail_part_list_keep_recent (EMailPartList *part_list)
+{
+	GSList *drop_part_lists = NULL;
+	CamelMessageInfo *info;
+	CamelFolder *folder;
+	RecentFolder *rf;
+	RecentItem *item = NULL;
+	GList *link;
+	gsize size = 0;
+
+	g_return_if_fail (E_IS_MAIL_PART_LIST (part_list));
+
+	folder = part_list->priv->folder;
+
+	if (!folder || !part_list->priv->message_uid)
+		return;
+
+	info = camel_folder_get_message_info (folder, part_list->priv->message_uid);
+	if (info) {
+		size = camel_message_info_get_size (info);
+		g_object_unref (info);
+	}
+
+	G_LOCK (recent);
+
+	if (!recent_folders)
+		recent_folders = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+
+	link = g_queue_peek_head_link (&recent_items);
+	while (link) {
+		RecentItem *adept = link->data;
+		GList *next = g_list_next (link);
+
+		if (adept->part_list == part_list) {
+			item = adept;
+			g_queue_unlink (&recent_items, link);
+			g_queue_push_head_link (&recent_items, link);
+		} else if (adept->part_list->priv->folder == folder &&
+			   g_strcmp0 (adept->part_list->priv->message_uid, part_list->priv->message_uid) == 0) {
+			/* The message had been parsed again. */
+			mail_part_list_recent_drop_locked (link, &drop_part_lists);
+		}
+
+		link = next;
+	}
+
+	if (!item) {
+		item = g_slice_new0 (RecentItem);
+		item->part_list = g_object_ref (part_list);
+		item->size = size;
+
+		g_queue_push_head (&recent_items, item);
+		recent_size += size;
+
+		rf = g_hash_table_lookup (recent_folders, folder);
+		if (!rf) {
+			rf = g_new0 (RecentFolder, 1);
+			rf->changed_handler_id = g_signal_connect (
+				folder, "changed",
+				G_CALLBACK (mail_part_list_recent_folder_changed_cb), NULL);
+
+			g_hash_table_insert (recent_folders, folder, rf);
+		}
+
+		rf->n_items++;
+	}
+
+	/* Evict the least recently shown, but always keep the current one. */
+	while (g_queue_get_length (&recent_items) > 1 &&
+	       (g_queue_get_length (&recent_items) > RECENT_MAX_ITEMS ||
+		recent_size > RECENT_MAX_SIZE)) {
+		mail_part_list_recent_drop_locked (g_queue_peek_tail_link (&recent_items), &drop_part_lists);
+	}
+
+	G_UNLOCK (recent);
+
+	g_slist_free_full (drop_part_lists, g_object_unref);
+}
@@ -75,6 +75,7 @@ gboolean	e_mail_part_list_is_empty	(EMailPartList *part_list);
 
 CamelObjectBag *
 		e_mail_part_list_get_registry	(void);
+void		e_mail_part_list_keep_recent	(EMailPartList *part_list);
 
 G_END_DECLS
 
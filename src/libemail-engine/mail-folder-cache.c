@@ -57,6 +57,7 @@
 
 typedef struct _StoreInfo StoreInfo;
 typedef struct _FolderInfo FolderInfo;
+typedef struct _FolderIndex FolderIndex;
 typedef struct _AsyncContext AsyncContext;
 typedef struct _UpdateClosure UpdateClosure;
 
@@ -138,6 +139,22 @@ struct _FolderInfo {
 
 	GWeakRef folder;
 	gulong folder_changed_handler_id;
+
+	/* Message-ID index of the 'folder', built on the first lookup
+	 * and then kept up to date from the folder's "changed" signal.
+	 * The 'index' is NULL when it is not built. The lock is never
+	 * held while reading the message infos. */
+	GMutex index_lock;
+	FolderIndex *index;
+	gboolean index_building;
+	guint index_stamp;		/* increased when the index is dropped */
+	GHashTable *index_pending_uids;	/* const gchar *uid, changed since the index was updated */
+};
+
+struct _FolderIndex {
+	GHashTable *uids;		/* const gchar *uid ~> GArray { guint64 msgid, guint64 references... } */
+	GHashTable *msgids;		/* guint64 *msgid ~> GPtrArray { const gchar *uid }, messages with the msgid */
+	GHashTable *references;		/* guint64 *msgid ~> GPtrArray { const gchar *uid }, messages referencing the msgid */
 };
 
 struct _AsyncContext {
@@ -204,6 +221,9 @@ folder_info_new (CamelStore *store,
 	folder_info->flags = flags;
 
 	g_mutex_init (&folder_info->lock);
+	g_mutex_init (&folder_info->index_lock);
+	folder_info->index_pending_uids = g_hash_table_new_full (g_str_hash, g_str_equal,
+		(GDestroyNotify) camel_pstring_free, NULL);
 
 	return folder_info;
 }
@@ -219,6 +239,370 @@ folder_info_ref (FolderInfo *folder_info)
 	return folder_info;
 }
 
+static FolderIndex *
+folder_index_new (void)
+{
+	FolderIndex *index;
+
+	index = g_slice_new0 (FolderIndex);
+	index->uids = g_hash_table_new_full (g_str_hash, g_str_equal,
+		(GDestroyNotify) camel_pstring_free, (GDestroyNotify) g_array_unref);
+	index->msgids = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+		g_free, (GDestroyNotify) g_ptr_array_unref);
+	index->references = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+		g_free, (GDestroyNotify) g_ptr_array_unref);
+
+	return index;
+}
+
+static void
+folder_index_free (FolderIndex *index)
+{
+	if (index) {
+		g_hash_table_destroy (index->uids);
+		g_hash_table_destroy (index->msgids);
+		g_hash_table_destroy (index->references);
+		g_slice_free (FolderIndex, index);
+	}
+}
+
+static void
+folder_index_insert (GHashTable *table,
+		     guint64 msgid,
+		     const gchar *uid)
+{
+	GPtrArray *uids;
+
+	uids = g_hash_table_lookup (table, &msgid);
+	if (!uids) {
+		uids = g_ptr_array_new_with_free_func ((GDestroyNotify) camel_pstring_free);
+		g_hash_table_insert (table, g_memdup (&msgid, sizeof (guint64)), uids);
+	}
+
+	g_ptr_array_add (uids, (gpointer) camel_pstring_strdup (uid));
+}
+
+/* The 'uid' is a camel_pstring, thus it can be compared by pointer */
+static void
+folder_index_drop (GHashTable *table,
+		   guint64 msgid,
+		   const gchar *uid)
+{
+	GPtrArray *uids;
+
+	uids = g_hash_table_lookup (table, &msgid);
+	if (uids) {
+		g_ptr_array_remove_fast (uids, (gpointer) uid);
+		if (!uids->len)
+			g_hash_table_remove (table, &msgid);
+	}
+}
+
+/* Takes ownership of the 'msgids', the message's Message-ID followed by its references */
+static void
+folder_index_add_uid (FolderIndex *index,
+		      const gchar *uid,
+		      GArray *msgids)
+{
+	const gchar *key;
+	guint ii;
+
+	key = camel_pstring_strdup (uid);
+
+	if (msgids->len > 0 && g_array_index (msgids, guint64, 0))
+		folder_index_insert (index->msgids, g_array_index (msgids, guint64, 0), key);
+
+	for (ii = 1; ii < msgids->len; ii++) {
+		folder_index_insert (index->references, g_array_index (msgids, guint64, ii), key);
+	}
+
+	g_hash_table_insert (index->uids, (gpointer) key, msgids);
+}
+
+static void
+folder_index_remove_uid (FolderIndex *index,
+			 const gchar *uid)
+{
+	gpointer key = NULL, value = NULL;
+	GArray *msgids;
+	guint ii;
+
+	if (!g_hash_table_lookup_extended (index->uids, uid, &key, &value))
+		return;
+
+	msgids = value;
+
+	if (msgids->len > 0 && g_array_index (msgids, guint64, 0))
+		folder_index_drop (index->msgids, g_array_index (msgids, guint64, 0), key);
+
+	for (ii = 1; ii < msgids->len; ii++) {
+		folder_index_drop (index->references, g_array_index (msgids, guint64, ii), key);
+	}
+
+	g_hash_table_remove (index->uids, key);
+}
+
+/* Returns the Message-ID of the message followed by its references,
+   or NULL when the 'uid' is not in the 'folder' */
+static GArray *
+folder_index_read_msgids (CamelFolder *folder,
+			  const gchar *uid)
+{
+	CamelMessageInfo *info;
+	GArray *msgids, *references;
+	guint64 msgid;
+	guint ii;
+
+	info = camel_folder_get_message_info (folder, uid);
+	if (!info)
+		return NULL;
+
+	msgid = camel_message_info_get_message_id (info);
+	references = camel_message_info_dup_references (info);
+
+	msgids = g_array_sized_new (FALSE, FALSE, sizeof (guint64), 1 + (references ? references->len : 0));
+	g_array_append_val (msgids, msgid);
+
+	for (ii = 0; references && ii < references->len; ii++) {
+		guint64 refr_msgid = g_array_index (references, guint64, ii);
+
+		if (refr_msgid)
+			g_array_append_val (msgids, refr_msgid);
+	}
+
+	if (references)
+		g_array_unref (references);
+	g_object_unref (info);
+
+	return msgids;
+}
+
+static void
+folder_index_msgids_free (gpointer ptr)
+{
+	GArray *msgids = ptr;
+
+	if (msgids)
+		g_array_unref (msgids);
+}
+
+/* Builds the index of the 'folder' from its message infos, which
+   are loaded into the memory at once. Called without the
+   folder_info->index_lock held. */
+static FolderIndex *
+folder_index_build (CamelFolder *folder)
+{
+	FolderIndex *index;
+	CamelFolderSummary *summary;
+	GPtrArray *uids;
+	guint ii;
+
+	index = folder_index_new ();
+
+	uids = camel_folder_get_uids (folder);
+	if (!uids)
+		return index;
+
+	/* Loads the infos in one pass, not one by one */
+	summary = camel_folder_get_folder_summary (folder);
+	if (summary)
+		camel_folder_summary_prepare_fetch_all (summary, NULL);
+
+	for (ii = 0; ii < uids->len; ii++) {
+		const gchar *uid = uids->pdata[ii];
+		GArray *msgids;
+
+		msgids = folder_index_read_msgids (folder, uid);
+		if (msgids)
+			folder_index_add_uid (index, uid, msgids);
+	}
+
+	camel_folder_free_uids (folder, uids);
+
+	return index;
+}
+
+/* Called with the folder_info->index_lock held */
+static void
+folder_info_index_free (FolderInfo *folder_info)
+{
+	g_clear_pointer (&folder_info->index, folder_index_free);
+	g_hash_table_remove_all (folder_info->index_pending_uids);
+
+	/* Any index being built now misses changes */
+	folder_info->index_stamp++;
+}
+
+/* Only remembers the changed messages, which is cheap enough
+   for the main thread; the index is updated in a worker thread
+   by folder_info_index_flush(). */
+static void
+folder_info_index_note_changes (FolderInfo *folder_info,
+				CamelFolderChangeInfo *changes)
+{
+	GPtrArray *arrays[3];
+	guint ii, jj;
+
+	arrays[0] = changes->uid_removed;
+	arrays[1] = changes->uid_changed;
+	arrays[2] = changes->uid_added;
+
+	g_mutex_lock (&folder_info->index_lock);
+
+	/* Only update the index when it is used */
+	if (folder_info->index || folder_info->index_building) {
+		for (ii = 0; ii < G_N_ELEMENTS (arrays); ii++) {
+			for (jj = 0; arrays[ii] && jj < arrays[ii]->len; jj++) {
+				g_hash_table_add (folder_info->index_pending_uids,
+					(gpointer) camel_pstring_strdup (arrays[ii]->pdata[jj]));
+			}
+		}
+	}
+
+	g_mutex_unlock (&folder_info->index_lock);
+}
+
+/* Updates the index with the noted changes; the message infos
+   are read without the folder_info->index_lock held. */
+static void
+folder_info_index_flush (FolderInfo *folder_info,
+			 CamelFolder *folder)
+{
+	while (TRUE) {
+		GHashTable *pending;
+		GHashTable *msgids; /* const gchar *uid ~> GArray { guint64 msgid, ... }, NULL when removed */
+		GHashTableIter iter;
+		gpointer key, value;
+		guint stamp;
+
+		g_mutex_lock (&folder_info->index_lock);
+
+		if (!folder_info->index || !g_hash_table_size (folder_info->index_pending_uids)) {
+			g_mutex_unlock (&folder_info->index_lock);
+			break;
+		}
+
+		pending = folder_info->index_pending_uids;
+		folder_info->index_pending_uids = g_hash_table_new_full (g_str_hash, g_str_equal,
+			(GDestroyNotify) camel_pstring_free, NULL);
+		stamp = folder_info->index_stamp;
+
+		g_mutex_unlock (&folder_info->index_lock);
+
+		msgids = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, folder_index_msgids_free);
+
+		/* The headers can be downloaded later than the message is known,
+		   thus the changed messages are read again too */
+		g_hash_table_iter_init (&iter, pending);
+		while (g_hash_table_iter_next (&iter, &key, NULL)) {
+			g_hash_table_insert (msgids, key, folder_index_read_msgids (folder, key));
+		}
+
+		g_mutex_lock (&folder_info->index_lock);
+
+		if (folder_info->index && folder_info->index_stamp == stamp) {
+			g_hash_table_iter_init (&iter, msgids);
+			while (g_hash_table_iter_next (&iter, &key, &value)) {
+				folder_index_remove_uid (folder_info->index, key);
+
+				if (value) {
+					g_hash_table_iter_steal (&iter);
+					folder_index_add_uid (folder_info->index, key, value);
+				}
+			}
+		}
+
+		g_mutex_unlock (&folder_info->index_lock);
+
+		g_hash_table_destroy (msgids);
+		g_hash_table_destroy (pending);
+	}
+}
+
+/* Returns NULL when the 'folder' is not the folder watched by the 'folder_info',
+   or when another thread is building its index, otherwise an array of UIDs of
+   messages with the 'msgid', or referencing it when 'by_references' is TRUE.
+   The index is built, if not built yet. */
+static GPtrArray *
+folder_info_index_dup_uids (FolderInfo *folder_info,
+			    CamelFolder *folder,
+			    gboolean by_references,
+			    guint64 msgid)
+{
+	CamelFolder *watched_folder;
+	GPtrArray *uids = NULL;
+	gboolean indexed;
+
+	watched_folder = g_weak_ref_get (&folder_info->folder);
+	if (watched_folder != folder) {
+		g_clear_object (&watched_folder);
+		return NULL;
+	}
+
+	g_mutex_lock (&folder_info->index_lock);
+
+	if (!folder_info->index && !folder_info->index_building) {
+		FolderIndex *index;
+		guint stamp;
+
+		/* Changes from now on are applied after the index is built */
+		g_hash_table_remove_all (folder_info->index_pending_uids);
+		folder_info->index_building = TRUE;
+		stamp = folder_info->index_stamp;
+
+		g_mutex_unlock (&folder_info->index_lock);
+
+		index = folder_index_build (folder);
+
+		g_mutex_lock (&folder_info->index_lock);
+
+		folder_info->index_building = FALSE;
+
+		/* Dropped while it was being built */
+		if (folder_info->index_stamp == stamp)
+			folder_info->index = index;
+		else
+			folder_index_free (index);
+	}
+
+	indexed = folder_info->index != NULL;
+
+	g_mutex_unlock (&folder_info->index_lock);
+
+	if (!indexed) {
+		g_object_unref (watched_folder);
+		return NULL;
+	}
+
+	folder_info_index_flush (folder_info, folder);
+
+	g_mutex_lock (&folder_info->index_lock);
+
+	if (msgid && folder_info->index) {
+		GPtrArray *found;
+
+		found = g_hash_table_lookup (by_references ? folder_info->index->references : folder_info->index->msgids, &msgid);
+		if (found) {
+			guint ii;
+
+			uids = g_ptr_array_new_full (found->len, (GDestroyNotify) camel_pstring_free);
+
+			for (ii = 0; ii < found->len; ii++) {
+				g_ptr_array_add (uids, (gpointer) camel_pstring_strdup (found->pdata[ii]));
+			}
+		}
+	}
+
+	g_mutex_unlock (&folder_info->index_lock);
+
+	g_object_unref (watched_folder);
+
+	if (!uids)
+		uids = g_ptr_array_new_with_free_func ((GDestroyNotify) camel_pstring_free);
+
+	return uids;
+}
+
 static void
 folder_info_clear_folder (FolderInfo *folder_info)
 {
@@ -241,6 +625,10 @@ folder_info_clear_folder (FolderInfo *folder_info)
 		g_object_unref (folder);
 	}
 
+	g_mutex_lock (&folder_info->index_lock);
+	folder_info_index_free (folder_info);
+	g_mutex_unlock (&folder_info->index_lock);
+
 	g_mutex_unlock (&folder_info->lock);
 }
 
@@ -257,6 +645,8 @@ folder_info_unref (FolderInfo *folder_info)
 		g_free (folder_info->full_name);
 
 		g_mutex_clear (&folder_info->lock);
+		g_mutex_clear (&folder_info->index_lock);
+		g_hash_table_destroy (folder_info->index_pending_uids);
 
 		g_slice_free (FolderInfo, folder_info);
 	}
@@ -931,22 +1321,159 @@ update_1folder (MailFolderCache *cache,
 #define IGNORE_THREAD_VALUE_IN_PROGRESS	GINT_TO_POINTER (2)
 #define IGNORE_THREAD_VALUE_DONE	GINT_TO_POINTER (3)
 
+/* How many Message-IDs are looked up by one folder search */
+#define IGNORE_THREAD_MSGID_SEARCH_CHUNK 500
+
+static void
+folder_cache_search_msgid_uids (CamelFolder *folder,
+				GHashTable *msgid_uids,
+				const gchar *expr,
+				GCancellable *cancellable,
+				GError **error)
+{
+	GPtrArray *uids;
+	guint ii;
+
+	uids = camel_folder_search_by_expression (folder, expr, cancellable, error);
+	if (!uids)
+		return;
+
+	for (ii = 0; ii < uids->len; ii++) {
+		const gchar *refruid = uids->pdata[ii];
+		CamelMessageInfo *refrinfo;
+		GPtrArray *msgid_uids_array;
+		guint64 msgid;
+
+		refrinfo = camel_folder_get_message_info (folder, refruid);
+		if (!refrinfo)
+			continue;
+
+		msgid = camel_message_info_get_message_id (refrinfo);
+		msgid_uids_array = g_hash_table_lookup (msgid_uids, &msgid);
+		if (msgid_uids_array)
+			g_ptr_array_add (msgid_uids_array, (gpointer) camel_pstring_strdup (refruid));
+
+		g_clear_object (&refrinfo);
+	}
+
+	camel_folder_search_free (folder, uids);
+}
+
+/* Resolves all Message-IDs referenced by the added messages to the message
+   UIDs at once, instead of searching the folder for each added message.
+   The folder's Message-ID index is used when available.
+   Returns a hash table guint64 msgid ~> GPtrArray { const gchar *uid } */
+static GHashTable *
+folder_cache_gather_ignore_thread_msgids (MailFolderCache *cache,
+					  CamelFolder *folder,
+					  CamelFolderChangeInfo *changes,
+					  GCancellable *cancellable,
+					  GError **error)
+{
+	GHashTable *msgid_uids;
+	GString *expr = NULL;
+	GError *local_error = NULL;
+	gboolean use_index = TRUE;
+	guint n_in_expr = 0;
+	guint ii, jj;
+
+	msgid_uids = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+
+	for (ii = 0; ii < changes->uid_added->len && !local_error; ii++) {
+		CamelMessageInfo *info;
+		GArray *references;
+
+		if (g_cancellable_set_error_if_cancelled (cancellable, &local_error))
+			break;
+
+		info = camel_folder_get_message_info (folder, changes->uid_added->pdata[ii]);
+		if (!info)
+			continue;
+
+		references = camel_message_info_dup_references (info);
+
+		for (jj = 0; references && jj < references->len; jj++) {
+			CamelSummaryMessageID msgid;
+
+			msgid.id.id = g_array_index (references, guint64, jj);
+			if (!msgid.id.id || g_hash_table_contains (msgid_uids, &msgid.id.id))
+				continue;
+
+			if (use_index) {
+				GPtrArray *uids;
+
+				uids = mail_folder_cache_dup_uids_by_message_id (cache, folder, msgid.id.id);
+				if (uids) {
+					g_hash_table_insert (msgid_uids, g_memdup (&msgid.id.id, sizeof (guint64)), uids);
+					continue;
+				}
+
+				/* The folder is not indexed */
+				use_index = FALSE;
+			}
+
+			g_hash_table_insert (msgid_uids, g_memdup (&msgid.id.id, sizeof (guint64)),
+				g_ptr_array_new_with_free_func ((GDestroyNotify) camel_pstring_free));
+
+			if (!expr)
+				expr = g_string_new ("(match-all (or ");
+
+			g_string_append_printf (expr, "(= \"msgid\" \"%lu %lu\")",
+				(gulong) msgid.id.part.hi,
+				(gulong) msgid.id.part.lo);
+			n_in_expr++;
+
+			if (n_in_expr >= IGNORE_THREAD_MSGID_SEARCH_CHUNK) {
+				g_string_append (expr, "))");
+				folder_cache_search_msgid_uids (folder, msgid_uids, expr->str, cancellable, &local_error);
+				g_string_free (expr, TRUE);
+				expr = NULL;
+				n_in_expr = 0;
+
+				if (local_error)
+					break;
+			}
+		}
+
+		if (references)
+			g_array_unref (references);
+
+		g_clear_object (&info);
+	}
+
+	if (expr) {
+		if (!local_error) {
+			g_string_append (expr, "))");
+			folder_cache_search_msgid_uids (folder, msgid_uids, expr->str, cancellable, &local_error);
+		}
+
+		g_string_free (expr, TRUE);
+	}
+
+	if (local_error) {
+		g_propagate_error (error, local_error);
+		g_hash_table_destroy (msgid_uids);
+		msgid_uids = NULL;
+	}
+
+	return msgid_uids;
+}
+
 static gboolean
 folder_cache_check_ignore_thread (CamelFolder *folder,
 				  CamelMessageInfo *info,
 				  GHashTable *added_uids, /* gchar *uid ~> IGNORE_THREAD_VALUE_... */
-				  GCancellable *cancellable,
-				  GError **error)
+				  GHashTable *msgid_uids) /* guint64 msgid ~> GPtrArray { const gchar *uid } */
 {
 	GArray *references;
 	gboolean has_ignore_thread = FALSE, first_ignore_thread = FALSE, found_first_msgid = FALSE;
 	guint64 first_msgid;
-	GString *expr = NULL;
-	guint ii;
+	guint ii, jj;
 
 	g_return_val_if_fail (CAMEL_IS_FOLDER (folder), FALSE);
 	g_return_val_if_fail (info != NULL, FALSE);
 	g_return_val_if_fail (added_uids != NULL, FALSE);
+	g_return_val_if_fail (msgid_uids != NULL, FALSE);
 	g_return_val_if_fail (camel_message_info_get_uid (info) != NULL, FALSE);
 
 	if (g_hash_table_lookup (added_uids, camel_message_info_get_uid (info)) == IGNORE_THREAD_VALUE_DONE)
@@ -961,81 +1488,60 @@ folder_cache_check_ignore_thread (CamelFolder *folder,
 
 	first_msgid = g_array_index (references, guint64, 0);
 
-	for (ii = 0; ii < references->len; ii++) {
-		CamelSummaryMessageID msgid;
+	for (ii = 0; ii < references->len && !found_first_msgid; ii++) {
+		guint64 msgid = g_array_index (references, guint64, ii);
+		GPtrArray *refruids;
 
-		msgid.id.id = g_array_index (references, guint64, ii);
-		if (!msgid.id.id)
+		if (!msgid)
 			continue;
 
-		if (!expr)
-			expr = g_string_new ("(match-all (or ");
-
-		g_string_append_printf (expr, "(= \"msgid\" \"%lu %lu\")",
-			(gulong) msgid.id.part.hi,
-			(gulong) msgid.id.part.lo);
-	}
-
-	if (expr) {
-		GPtrArray *uids;
-
-		g_string_append (expr, "))");
-
-		uids = camel_folder_search_by_expression (folder, expr->str, cancellable, error);
-		if (uids) {
-			for (ii = 0; ii < uids->len; ii++) {
-				const gchar *refruid = uids->pdata[ii];
-				CamelMessageInfo *refrinfo;
-				gpointer cached_value;
+		refruids = g_hash_table_lookup (msgid_uids, &msgid);
+		if (!refruids)
+			continue;
 
-				refrinfo = camel_folder_get_message_info (folder, refruid);
-				if (!refrinfo)
-					continue;
+		for (jj = 0; jj < refruids->len; jj++) {
+			const gchar *refruid = refruids->pdata[jj];
+			CamelMessageInfo *refrinfo;
+			gpointer cached_value;
 
-				/* This is for cases when a subthread is received and the order of UIDs
-				   doesn't match the order in the thread (parent before child). */
-				cached_value = g_hash_table_lookup (added_uids, refruid);
-				if (cached_value == IGNORE_THREAD_VALUE_TODO) {
-					GError *local_error = NULL;
+			refrinfo = camel_folder_get_message_info (folder, refruid);
+			if (!refrinfo)
+				continue;
 
-					/* To avoid infinite recursion */
-					g_hash_table_insert (added_uids, (gpointer) camel_pstring_strdup (refruid), IGNORE_THREAD_VALUE_IN_PROGRESS);
+			/* This is for cases when a subthread is received and the order of UIDs
+			   doesn't match the order in the thread (parent before child). The parents
+			   are resolved first, thus the flag propagates in the thread order. */
+			cached_value = g_hash_table_lookup (added_uids, refruid);
+			if (cached_value == IGNORE_THREAD_VALUE_TODO) {
+				/* To avoid infinite recursion */
+				g_hash_table_insert (added_uids, (gpointer) camel_pstring_strdup (refruid), IGNORE_THREAD_VALUE_IN_PROGRESS);
 
-					if (folder_cache_check_ignore_thread (folder, refrinfo, added_uids, cancellable, &local_error))
-						camel_message_info_set_user_flag (refrinfo, "ignore-thread", TRUE);
+				if (folder_cache_check_ignore_thread (folder, refrinfo, added_uids, msgid_uids))
+					camel_message_info_set_user_flag (refrinfo, "ignore-thread", TRUE);
 
-					if (local_error) {
-						g_clear_error (&local_error);
-					} else {
-						cached_value = IGNORE_THREAD_VALUE_DONE;
-						g_hash_table_insert (added_uids, (gpointer) camel_pstring_strdup (refruid), IGNORE_THREAD_VALUE_DONE);
-					}
-				}
+				cached_value = IGNORE_THREAD_VALUE_DONE;
+				g_hash_table_insert (added_uids, (gpointer) camel_pstring_strdup (refruid), IGNORE_THREAD_VALUE_DONE);
+			}
 
-				if (!cached_value)
-					cached_value = IGNORE_THREAD_VALUE_DONE;
+			if (!cached_value)
+				cached_value = IGNORE_THREAD_VALUE_DONE;
 
-				if (first_msgid && camel_message_info_get_message_id (refrinfo) == first_msgid) {
-					/* The first msgid in the references is In-Reply-To, which is the master;
-					   the rest is just a guess. */
-					first_ignore_thread = camel_message_info_get_user_flag (refrinfo, "ignore-thread");
-					found_first_msgid = first_ignore_thread || cached_value == IGNORE_THREAD_VALUE_DONE;
+			if (first_msgid && msgid == first_msgid) {
+				/* The first msgid in the references is In-Reply-To, which is the master;
+				   the rest is just a guess. */
+				first_ignore_thread = camel_message_info_get_user_flag (refrinfo, "ignore-thread");
+				found_first_msgid = first_ignore_thread || cached_value == IGNORE_THREAD_VALUE_DONE;
 
-					if (found_first_msgid) {
-						g_clear_object (&refrinfo);
-						break;
-					}
+				if (found_first_msgid) {
+					g_clear_object (&refrinfo);
+					break;
 				}
-
-				has_ignore_thread = has_ignore_thread || camel_message_info_get_user_flag (refrinfo, "ignore-thread");
-
-				g_clear_object (&refrinfo);
 			}
 
-			camel_folder_search_free (folder, uids);
-		}
+			has_ignore_thread = has_ignore_thread || camel_message_info_get_user_flag (refrinfo, "ignore-thread");
 
-		g_string_free (expr, TRUE);
+			g_clear_object (&refrinfo);
+		}
 	}
 
 	g_array_unref (references);
@@ -1075,6 +1581,19 @@ folder_cache_process_folder_changes_thread (CamelFolder *folder,
 	parent_store = camel_folder_get_parent_store (folder);
 	session = camel_service_ref_session (CAMEL_SERVICE (parent_store));
 
+	/* Update the index before the changes are processed, the processing uses it */
+	folder_info = mail_folder_cache_ref_folder_info (cache, parent_store, full_name);
+	if (folder_info) {
+		CamelFolder *watched_folder;
+
+		watched_folder = g_weak_ref_get (&folder_info->folder);
+		if (watched_folder == folder)
+			folder_info_index_flush (folder_info, folder);
+
+		g_clear_object (&watched_folder);
+		folder_info_unref (folder_info);
+	}
+
 	g_mutex_lock (&last_newmail_per_folder_mutex);
 	if (last_newmail_per_folder == NULL)
 		last_newmail_per_folder = g_hash_table_new (
@@ -1099,6 +1618,8 @@ folder_cache_process_folder_changes_thread (CamelFolder *folder,
 	    && folder != local_sent
 	    && changes && (changes->uid_added->len > 0)) {
 		GHashTable *added_uids; /* gchar *uid ~> IGNORE_THREAD_VALUE_... */
+		GHashTable *msgid_uids; /* guint64 msgid ~> GPtrArray { const gchar *uid } */
+		GError *local_error = NULL;
 
 		/* The messages can be received in a wrong order (by UID), the same as the In-Reply-To
 		   message can be a new message here, in which case it might not be already updated,
@@ -1112,18 +1633,20 @@ folder_cache_process_folder_changes_thread (CamelFolder *folder,
 				g_hash_table_insert (added_uids, (gpointer) camel_pstring_strdup (uid), IGNORE_THREAD_VALUE_TODO);
 		}
 
+		/* On failure the messages are still counted, only without the ignore-thread check */
+		msgid_uids = folder_cache_gather_ignore_thread_msgids (cache, folder, changes, cancellable, &local_error);
+
 		/* for each added message, check to see that it is
 		 * brand new, not junk and not already deleted */
 		for (i = 0; i < changes->uid_added->len && !g_cancellable_is_cancelled (cancellable); i++) {
 			info = camel_folder_get_message_info (
 				folder, changes->uid_added->pdata[i]);
 			if (info) {
-				GError *local_error = NULL;
-
 				flags = camel_message_info_get_flags (info);
 				if (((flags & CAMEL_MESSAGE_SEEN) == 0) &&
 				    ((flags & CAMEL_MESSAGE_DELETED) == 0) &&
-				    folder_cache_check_ignore_thread (folder, info, added_uids, cancellable, &local_error)) {
+				    msgid_uids &&
+				    folder_cache_check_ignore_thread (folder, info, added_uids, msgid_uids)) {
 					camel_message_info_set_flags (info, CAMEL_MESSAGE_SEEN, CAMEL_MESSAGE_SEEN);
 					camel_message_info_set_user_flag (info, "ignore-thread", TRUE);
 					flags = flags | CAMEL_MESSAGE_SEEN;
@@ -1152,14 +1675,14 @@ folder_cache_process_folder_changes_thread (CamelFolder *folder,
 				}
 
 				g_clear_object (&info);
-
-				if (local_error) {
-					g_propagate_error (error, local_error);
-					break;
-				}
 			}
 		}
 
+		if (local_error)
+			g_propagate_error (error, local_error);
+
+		if (msgid_uids)
+			g_hash_table_destroy (msgid_uids);
 		g_hash_table_destroy (added_uids);
 	}
 
@@ -1190,15 +1713,28 @@ folder_cache_process_folder_changes_thread (CamelFolder *folder,
 #undef IGNORE_THREAD_VALUE_TODO
 #undef IGNORE_THREAD_VALUE_IN_PROGRESS
 #undef IGNORE_THREAD_VALUE_DONE
+#undef IGNORE_THREAD_MSGID_SEARCH_CHUNK
 
 static void
 folder_changed_cb (CamelFolder *folder,
                    CamelFolderChangeInfo *changes,
                    MailFolderCache *cache)
 {
+	FolderInfo *folder_info;
+
 	if (!changes)
 		return;
 
+	/* Note the changes for the index before they are processed,
+	 * the index is updated in the thread, which also uses it */
+	folder_info = mail_folder_cache_ref_folder_info (cache,
+		camel_folder_get_parent_store (folder),
+		camel_folder_get_full_name (folder));
+	if (folder_info) {
+		folder_info_index_note_changes (folder_info, changes);
+		folder_info_unref (folder_info);
+	}
+
 	mail_process_folder_changes (folder, changes,
 		folder_cache_process_folder_changes_thread,
 		g_object_unref, g_object_ref (cache));
@@ -2395,6 +2931,11 @@ mail_folder_cache_note_folder (MailFolderCache *cache,
 		g_object_unref (cached_folder);
 	}
 
+	/* The index could miss changes while the folder was not watched */
+	g_mutex_lock (&folder_info->index_lock);
+	folder_info_index_free (folder_info);
+	g_mutex_unlock (&folder_info->index_lock);
+
 	g_weak_ref_set (&folder_info->folder, folder);
 
 	update_1folder (cache, folder_info, 0, NULL, NULL, NULL, NULL);
@@ -2482,6 +3023,89 @@ mail_folder_cache_ref_folder (MailFolderCache *cache,
 	return folder;
 }
 
+static GPtrArray *
+mail_folder_cache_dup_indexed_uids (MailFolderCache *cache,
+				    CamelFolder *folder,
+				    gboolean by_references,
+				    guint64 message_id)
+{
+	FolderInfo *folder_info;
+	GPtrArray *uids = NULL;
+
+	folder_info = mail_folder_cache_ref_folder_info (cache,
+		camel_folder_get_parent_store (folder),
+		camel_folder_get_full_name (folder));
+	if (folder_info != NULL) {
+		uids = folder_info_index_dup_uids (folder_info, folder, by_references, message_id);
+		folder_info_unref (folder_info);
+	}
+
+	return uids;
+}
+
+/**
+ * mail_folder_cache_dup_uids_by_message_id:
+ * @cache: a #MailFolderCache
+ * @folder: a #CamelFolder
+ * @message_id: a Message-ID hash, as returned by camel_message_info_get_message_id()
+ *
+ * Looks up messages in @folder with the @message_id in the folder's
+ * Message-ID index, which is built on the first call for the @folder
+ * and then maintained from the folder changes.  It can be used instead
+ * of a folder search for the "msgid" header.
+ *
+ * Only folders watched by the @cache, see mail_folder_cache_note_folder(),
+ * are indexed.  For other folders the function returns %NULL and the caller
+ * should fall back to camel_folder_search_by_expression().
+ *
+ * Free the returned #GPtrArray with g_ptr_array_unref() when done with it.
+ *
+ * Returns: (transfer container) (element-type utf8) (nullable): a #GPtrArray
+ *    with UIDs of the messages with the @message_id, which can be empty,
+ *    or %NULL when the @folder is not indexed
+ **/
+GPtrArray *
+mail_folder_cache_dup_uids_by_message_id (MailFolderCache *cache,
+					  CamelFolder *folder,
+					  guint64 message_id)
+{
+	g_return_val_if_fail (MAIL_IS_FOLDER_CACHE (cache), NULL);
+	g_return_val_if_fail (CAMEL_IS_FOLDER (folder), NULL);
+
+	return mail_folder_cache_dup_indexed_uids (cache, folder, FALSE, message_id);
+}
+
+/**
+ * mail_folder_cache_dup_uids_by_reference:
+ * @cache: a #MailFolderCache
+ * @folder: a #CamelFolder
+ * @message_id: a Message-ID hash, as returned by camel_message_info_get_message_id()
+ *
+ * Looks up messages in @folder which reference the @message_id in their
+ * References or In-Reply-To headers, thus the replies to the message and
+ * their descendants.  It can be used instead of a folder search for the
+ * "references" header, without its false positives.
+ *
+ * The same as for mail_folder_cache_dup_uids_by_message_id(), only folders
+ * watched by the @cache are indexed, for other folders %NULL is returned.
+ *
+ * Free the returned #GPtrArray with g_ptr_array_unref() when done with it.
+ *
+ * Returns: (transfer container) (element-type utf8) (nullable): a #GPtrArray
+ *    with UIDs of the messages referencing the @message_id, which can be empty,
+ *    or %NULL when the @folder is not indexed
+ **/
+GPtrArray *
+mail_folder_cache_dup_uids_by_reference (MailFolderCache *cache,
+					 CamelFolder *folder,
+					 guint64 message_id)
+{
+	g_return_val_if_fail (MAIL_IS_FOLDER_CACHE (cache), NULL);
+	g_return_val_if_fail (CAMEL_IS_FOLDER (folder), NULL);
+
+	return mail_folder_cache_dup_indexed_uids (cache, folder, TRUE, message_id);
+}
+
 /**
  * mail_folder_cache_get_folder_info_flags:
  * @cache: a #MailFolderCache
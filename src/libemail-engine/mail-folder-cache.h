@@ -121,6 +121,14 @@ gboolean	mail_folder_cache_has_folder_info
 CamelFolder *	mail_folder_cache_ref_folder	(MailFolderCache *cache,
 						 CamelStore *store,
 						 const gchar *folder_name);
+GPtrArray *	mail_folder_cache_dup_uids_by_message_id
+						(MailFolderCache *cache,
+						 CamelFolder *folder,
+						 guint64 message_id);
+GPtrArray *	mail_folder_cache_dup_uids_by_reference
+						(MailFolderCache *cache,
+						 CamelFolder *folder,
+						 guint64 message_id);
 gboolean	mail_folder_cache_get_folder_info_flags
 						(MailFolderCache *cache,
 						 CamelStore *store,
@@ -394,6 +394,55 @@ mail_msg_proxy (MailMsg *msg)
 	G_UNLOCK (idle_source_id);
 }
 
+/* Messages pushed to the worker threads are run by one shared set of
+ * workers rather than by a thread pool per push function, so a busy lane
+ * borrows the threads other lanes are not using.  An idle worker takes
+ * the highest priority ready message of the first lane which has one.
+ * Messages pushed with the same serial key run one at a time, in the
+ * order they were pushed; only the message at the head of a serial queue
+ * is ever ready.  Background messages may not occupy every worker, which
+ * keeps a long fetch from holding back interactive work. */
+
+#define MAIL_MSG_MAX_WORKERS 10
+#define MAIL_MSG_RESERVED_WORKERS 2
+
+typedef struct _MailMsgLaneStats MailMsgLaneStats;
+
+struct _MailMsgLaneStats {
+	guint queued;			/* messages waiting to run */
+	guint max_queued;		/* most messages ever waiting at once */
+	guint running;			/* messages running now */
+	guint64 n_done;			/* messages run to completion */
+	guint64 total_wait_usec;	/* summed time from push to start */
+	guint64 max_wait_usec;		/* longest time from push to start */
+	guint64 total_exec_usec;	/* summed time spent running */
+};
+
+typedef struct _MailMsgTask MailMsgTask;
+
+struct _MailMsgTask {
+	MailMsg *msg;
+	guint seq;			/* copy of msg->seq, the msg can be freed once it ran */
+	MailMsgLane lane;
+	gconstpointer serial_key;
+	gint64 push_time;
+};
+
+/* Serial keys of the ordered lanes. */
+static const gchar fast_ordered_key[] = "fast-ordered";
+static const gchar slow_ordered_key[] = "slow-ordered";
+
+/* Must hold executor_lock to access any of these. */
+static GMutex executor_lock;
+static GCond executor_cond;
+static GQueue executor_ready[MAIL_MSG_N_LANES];
+static GHashTable *executor_serial; /* serial key ~> GQueue * of MailMsgTask */
+static MailMsgLaneStats executor_stats[MAIL_MSG_N_LANES];
+static guint executor_n_ready;
+static guint executor_n_workers;
+static guint executor_n_idle;
+static guint executor_n_background;
+
 void
 mail_msg_init (void)
 {
@@ -405,6 +454,15 @@ mail_msg_init (void)
 
 	mail_msg_active_table = g_hash_table_new (NULL, NULL);
 	main_thread = g_thread_self ();
+
+	g_mutex_init (&executor_lock);
+	g_cond_init (&executor_cond);
+
+	executor_serial = g_hash_table_new_full (
+		(GHashFunc) g_direct_hash,
+		(GEqualFunc) g_direct_equal,
+		(GDestroyNotify) NULL,
+		(GDestroyNotify) g_queue_free);
 }
 
 static gint
@@ -420,21 +478,6 @@ mail_msg_compare (const MailMsg *msg1,
 	return (priority1 < priority2) ? 1 : -1;
 }
 
-static gpointer
-create_thread_pool (gpointer data)
-{
-	GThreadPool *thread_pool;
-	gint max_threads = GPOINTER_TO_INT (data);
-
-	/* once created, run forever */
-	thread_pool = g_thread_pool_new (
-		(GFunc) mail_msg_proxy, NULL, max_threads, FALSE, NULL);
-	g_thread_pool_set_sort_function (
-		thread_pool, (GCompareDataFunc) mail_msg_compare, NULL);
-
-	return thread_pool;
-}
-
 void
 mail_msg_main_loop_push (gpointer msg)
 {
@@ -451,34 +494,235 @@ mail_msg_main_loop_push (gpointer msg)
 	G_UNLOCK (idle_source_id);
 }
 
-void
-mail_msg_unordered_push (gpointer msg)
+static void
+executor_ready_task_locked (MailMsgTask *task)
 {
-	static GOnce once = G_ONCE_INIT;
+	GQueue *queue = &executor_ready[task->lane];
+	GList *link;
 
-	g_once (&once, (GThreadFunc) create_thread_pool, GINT_TO_POINTER (10));
+	/* Keep the lane sorted by priority, first come first served
+	 * within the same priority, which is also the common case. */
+	for (link = g_queue_peek_tail_link (queue); link; link = g_list_previous (link)) {
+		MailMsgTask *other = link->data;
 
-	g_thread_pool_push ((GThreadPool *) once.retval, msg, NULL);
+		if (other->msg->priority >= task->msg->priority)
+			break;
+	}
+
+	if (link)
+		g_queue_insert_after (queue, link, task);
+	else
+		g_queue_push_head (queue, task);
+
+	executor_n_ready++;
 }
 
+static MailMsgTask *
+executor_take_task_locked (void)
+{
+	MailMsgTask *task = NULL;
+	gint lane;
+
+	for (lane = 0; lane < MAIL_MSG_N_LANES && !task; lane++) {
+		if (lane == MAIL_MSG_LANE_BACKGROUND &&
+		    executor_n_background >= MAIL_MSG_MAX_WORKERS - MAIL_MSG_RESERVED_WORKERS)
+			continue;
+
+		task = g_queue_pop_head (&executor_ready[lane]);
+	}
+
+	if (task) {
+		MailMsgLaneStats *stats = &executor_stats[task->lane];
+		guint64 wait_usec;
+
+		executor_n_ready--;
+		if (task->lane == MAIL_MSG_LANE_BACKGROUND)
+			executor_n_background++;
+
+		wait_usec = g_get_monotonic_time () - task->push_time;
+
+		stats->queued--;
+		stats->running++;
+		stats->total_wait_usec += wait_usec;
+		stats->max_wait_usec = MAX (stats->max_wait_usec, wait_usec);
+	}
+
+	return task;
+}
+
+static void
+executor_finish_task_locked (MailMsgTask *task,
+                             guint64 exec_usec)
+{
+	MailMsgLaneStats *stats = &executor_stats[task->lane];
+
+	if (task->lane == MAIL_MSG_LANE_BACKGROUND)
+		executor_n_background--;
+
+	stats->running--;
+	stats->n_done++;
+	stats->total_exec_usec += exec_usec;
+
+	if (task->serial_key) {
+		GQueue *waiting;
+		MailMsgTask *next;
+
+		waiting = g_hash_table_lookup (executor_serial, task->serial_key);
+		next = waiting ? g_queue_pop_head (waiting) : NULL;
+
+		if (next)
+			executor_ready_task_locked (next);
+		else
+			g_hash_table_remove (executor_serial, task->serial_key);
+	}
+
+	/* This worker takes one of the ready messages itself, wake
+	 * another one for whatever is left. */
+	if (executor_n_ready > 1)
+		g_cond_signal (&executor_cond);
+
+	/* Run with CAMEL_DEBUG=mail-mt to see how the lanes keep up */
+	if (camel_debug ("mail-mt")) {
+		guint64 n_done = MAX (stats->n_done, 1);
+
+		printf (
+			"mail-mt: lane %d done msg %u after %" G_GUINT64_FORMAT " us; "
+			"%u queued (at most %u), %u running, %" G_GUINT64_FORMAT " done, "
+			"wait avg %" G_GUINT64_FORMAT " us (at most %" G_GUINT64_FORMAT " us), "
+			"run avg %" G_GUINT64_FORMAT " us\n",
+			task->lane, task->seq, exec_usec,
+			stats->queued, stats->max_queued, stats->running, stats->n_done,
+			stats->total_wait_usec / n_done, stats->max_wait_usec,
+			stats->total_exec_usec / n_done);
+	}
+}
+
+static gpointer
+executor_worker_thread (gpointer user_data)
+{
+	g_mutex_lock (&executor_lock);
+
+	/* once created, run forever */
+	while (TRUE) {
+		MailMsgTask *task;
+		gint64 start_time;
+
+		task = executor_take_task_locked ();
+		if (!task) {
+			executor_n_idle++;
+			g_cond_wait (&executor_cond, &executor_lock);
+			executor_n_idle--;
+			continue;
+		}
+
+		g_mutex_unlock (&executor_lock);
+
+		start_time = g_get_monotonic_time ();
+		mail_msg_proxy (task->msg);
+
+		g_mutex_lock (&executor_lock);
+
+		executor_finish_task_locked (task, g_get_monotonic_time () - start_time);
+		g_slice_free (MailMsgTask, task);
+	}
+
+	return NULL;
+}
+
+/**
+ * mail_msg_push:
+ * @msg: a #MailMsg
+ * @lane: a #MailMsgLane to run the @msg in
+ * @serial_key: (nullable): a key to serialize the @msg by, or %NULL
+ *
+ * Queues the @msg to be run in one of the worker threads.  Messages with
+ * the same non-%NULL @serial_key, for example a #CamelService, run one
+ * after another in the order they were pushed, whichever lane they are
+ * in.  A %NULL @serial_key in an ordered lane means the lane's own key.
+ **/
 void
-mail_msg_fast_ordered_push (gpointer msg)
+mail_msg_push (gpointer msg,
+               MailMsgLane lane,
+               gconstpointer serial_key)
 {
-	static GOnce once = G_ONCE_INIT;
+	MailMsgTask *task;
+	MailMsgLaneStats *stats;
 
-	g_once (&once, (GThreadFunc) create_thread_pool, GINT_TO_POINTER (1));
+	g_return_if_fail (msg != NULL);
+	g_return_if_fail (lane < MAIL_MSG_N_LANES);
 
-	g_thread_pool_push ((GThreadPool *) once.retval, msg, NULL);
+	if (!serial_key) {
+		if (lane == MAIL_MSG_LANE_FAST_ORDERED)
+			serial_key = fast_ordered_key;
+		else if (lane == MAIL_MSG_LANE_SLOW_ORDERED)
+			serial_key = slow_ordered_key;
+	}
+
+	task = g_slice_new0 (MailMsgTask);
+	task->msg = msg;
+	task->seq = ((MailMsg *) msg)->seq;
+	task->lane = lane;
+	task->serial_key = serial_key;
+	task->push_time = g_get_monotonic_time ();
+
+	g_mutex_lock (&executor_lock);
+
+	stats = &executor_stats[lane];
+	stats->queued++;
+	stats->max_queued = MAX (stats->max_queued, stats->queued);
+
+	if (serial_key) {
+		GQueue *waiting;
+
+		waiting = g_hash_table_lookup (executor_serial, serial_key);
+		if (waiting) {
+			/* Readied once the one before it finishes. */
+			g_queue_push_tail (waiting, task);
+			task = NULL;
+		} else {
+			g_hash_table_insert (
+				executor_serial, (gpointer) serial_key,
+				g_queue_new ());
+		}
+	}
+
+	if (task) {
+		executor_ready_task_locked (task);
+
+		if (executor_n_ready > executor_n_idle &&
+		    executor_n_workers < MAIL_MSG_MAX_WORKERS) {
+			GThread *thread;
+
+			thread = g_thread_new (
+				"mail-msg-worker",
+				executor_worker_thread, NULL);
+			g_thread_unref (thread);
+
+			executor_n_workers++;
+		} else {
+			g_cond_signal (&executor_cond);
+		}
+	}
+
+	g_mutex_unlock (&executor_lock);
 }
 
 void
-mail_msg_slow_ordered_push (gpointer msg)
+mail_msg_unordered_push (gpointer msg)
 {
-	static GOnce once = G_ONCE_INIT;
+	mail_msg_push (msg, MAIL_MSG_LANE_BACKGROUND, NULL);
+}
 
-	g_once (&once, (GThreadFunc) create_thread_pool, GINT_TO_POINTER (1));
+void
+mail_msg_fast_ordered_push (gpointer msg)
+{
+	mail_msg_push (msg, MAIL_MSG_LANE_FAST_ORDERED, NULL);
+}
 
-	g_thread_pool_push ((GThreadPool *) once.retval, msg, NULL);
+void
+mail_msg_slow_ordered_push (gpointer msg)
+{
+	mail_msg_push (msg, MAIL_MSG_LANE_SLOW_ORDERED, NULL);
 }
 
 gboolean
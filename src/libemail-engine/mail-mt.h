@@ -69,6 +69,16 @@ struct _MailMsgInfo {
 	MailMsgFreeFunc free;
 };
 
+/* Lanes of the worker threads, in the order idle workers serve them.
+ * The ordered lanes run one message at a time, in the order pushed. */
+typedef enum {
+	MAIL_MSG_LANE_INTERACTIVE,
+	MAIL_MSG_LANE_FAST_ORDERED,
+	MAIL_MSG_LANE_SLOW_ORDERED,
+	MAIL_MSG_LANE_BACKGROUND,
+	MAIL_MSG_N_LANES
+} MailMsgLane;
+
 /* Just till we move this out to EDS */
 EAlertSink *	mail_msg_get_alert_sink (void);
 
@@ -99,6 +109,9 @@ void mail_msg_main_loop_push (gpointer msg);
 void mail_msg_unordered_push (gpointer msg);
 void mail_msg_fast_ordered_push (gpointer msg);
 void mail_msg_slow_ordered_push (gpointer msg);
+void mail_msg_push (gpointer msg,
+		    MailMsgLane lane,
+		    gconstpointer serial_key);
 
 /* Call a function in the GUI thread, wait for it to return, type is
  * the marshaller to use.  FIXME This thing is horrible, please put
@@ -521,7 +521,7 @@ mail_fetch_mail (CamelStore *store,
 	if (status)
 		camel_filter_driver_set_status_func (fm->driver, status, status_data);
 
-	mail_msg_unordered_push (m);
+	mail_msg_push (m, MAIL_MSG_LANE_BACKGROUND, store);
 
 	g_object_unref (session);
 }
@@ -1193,7 +1193,7 @@ mail_send_queue (EMailSession *session,
 	m->driver = camel_session_get_filter_driver (CAMEL_SESSION (session), type, queue, NULL);
 	camel_filter_driver_set_folder_func (m->driver, get_folder, get_data);
 
-	mail_msg_unordered_push (m);
+	mail_msg_push (m, MAIL_MSG_LANE_BACKGROUND, transport);
 }
 
 /* ** TRANSFER MESSAGES **************************************************** */
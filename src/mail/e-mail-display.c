@@ -627,6 +627,155 @@ setup_dom_bindings (EMailDisplay *display)
 	}
 }
 
+typedef struct _DeferredContentData {
+	GWeakRef display; /* EMailDisplay */
+	EAttachment *attachment;
+	EMailPartAttachment *part;
+	gchar *element_id;
+} DeferredContentData;
+
+static void
+deferred_content_data_free (gpointer ptr)
+{
+	DeferredContentData *dcd = ptr;
+
+	if (dcd) {
+		g_weak_ref_clear (&dcd->display);
+		g_clear_object (&dcd->attachment);
+		g_clear_object (&dcd->part);
+		g_free (dcd->element_id);
+		g_slice_free (DeferredContentData, dcd);
+	}
+}
+
+static void
+mail_display_deferred_content_ready_cb (GObject *source_object,
+					GAsyncResult *result,
+					gpointer user_data)
+{
+	DeferredContentData *dcd = user_data;
+	EMailDisplay *display;
+	GInputStream *stream = NULL;
+	gint64 stream_length = -1;
+	gchar *mime_type = NULL;
+	gboolean success = FALSE;
+
+	display = g_weak_ref_get (&dcd->display);
+
+	if (e_content_request_process_finish (E_CONTENT_REQUEST (source_object), result,
+		&stream, &stream_length, &mime_type, NULL) && stream_length > 0 && display) {
+		gchar *html;
+		gsize bytes_read = 0;
+
+		html = g_malloc0 (stream_length + 1);
+
+		/* Part requests return an in-memory stream, thus this does not block */
+		if (g_input_stream_read_all (stream, html, stream_length, &bytes_read, NULL, NULL)) {
+			html[bytes_read] = '\0';
+
+			e_web_view_set_element_attribute (E_WEB_VIEW (display), dcd->element_id, NULL, "inner-html-data", html);
+			success = TRUE;
+		}
+
+		g_free (html);
+	}
+
+	/* Try again the next time the attachment is expanded */
+	if (!success)
+		e_mail_part_attachment_set_content_deferred (dcd->part, TRUE);
+
+	/* The web extension uses the content when the wrapper is being
+	 * unhidden, thus unhide it only now, if still expanded. */
+	if (display && g_hash_table_contains (display->priv->attachment_flags, dcd->attachment)) {
+		guint flags;
+
+		flags = GPOINTER_TO_UINT (g_hash_table_lookup (display->priv->attachment_flags, dcd->attachment));
+
+		if ((flags & E_ATTACHMENT_FLAG_VISIBLE) != 0)
+			e_web_view_set_element_hidden (E_WEB_VIEW (display), dcd->element_id, FALSE);
+	}
+
+	g_clear_object (&display);
+	g_clear_object (&stream);
+	g_free (mime_type);
+	deferred_content_data_free (dcd);
+}
+
+/* Formats the content of an attachment, which the formatter left out
+ * while the attachment was collapsed, and hands it to the wrapper
+ * element, which shows it once it is unhidden.  Returns whether the
+ * content is being loaded; the wrapper is unhidden when it's ready. */
+static gboolean
+mail_display_load_deferred_content (EMailDisplay *display,
+				    EAttachment *attachment,
+				    const gchar *element_id)
+{
+	EMailPartAttachment *empa = NULL;
+	GQueue queue = G_QUEUE_INIT;
+	GList *head, *link;
+
+	if (!display->priv->part_list)
+		return FALSE;
+
+	e_mail_part_list_queue_parts (display->priv->part_list, NULL, &queue);
+	head = g_queue_peek_head_link (&queue);
+
+	for (link = head; link != NULL && !empa; link = g_list_next (link)) {
+		EMailPart *part = E_MAIL_PART (link->data);
+
+		if (E_IS_MAIL_PART_ATTACHMENT (part) &&
+		    e_mail_part_attachment_get_content_deferred (E_MAIL_PART_ATTACHMENT (part))) {
+			EAttachment *adept;
+
+			adept = e_mail_part_attachment_ref_attachment (E_MAIL_PART_ATTACHMENT (part));
+			if (adept == attachment)
+				empa = g_object_ref (part);
+			g_clear_object (&adept);
+		}
+	}
+
+	while (!g_queue_is_empty (&queue))
+		g_object_unref (g_queue_pop_head (&queue));
+
+	if (empa) {
+		EContentRequest *request;
+		DeferredContentData *dcd;
+		gchar *uri;
+
+		uri = e_mail_part_build_uri (
+			e_mail_part_list_get_folder (display->priv->part_list),
+			e_mail_part_list_get_message_uid (display->priv->part_list),
+			"part_id", G_TYPE_STRING, e_mail_part_get_id (E_MAIL_PART (empa)),
+			"mime_type", G_TYPE_STRING, empa->snoop_mime_type,
+			"mode", G_TYPE_INT, display->priv->mode,
+			NULL);
+
+		/* Formatted only once, even when expanded again before it's done */
+		e_mail_part_attachment_set_content_deferred (empa, FALSE);
+
+		dcd = g_slice_new0 (DeferredContentData);
+		g_weak_ref_init (&dcd->display, display);
+		dcd->attachment = g_object_ref (attachment);
+		dcd->part = g_object_ref (empa);
+		dcd->element_id = g_strdup (element_id);
+
+		/* The attachment was deferred because it is large,
+		 * thus format it in a thread, not to block the UI. */
+		request = e_mail_request_new ();
+
+		e_content_request_process (request, uri, G_OBJECT (display), NULL,
+			mail_display_deferred_content_ready_cb, dcd);
+
+		g_object_unref (request);
+		g_object_unref (empa);
+		g_free (uri);
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
 static void
 mail_display_change_one_attachment_visibility (EMailDisplay *display,
 					       EAttachment *attachment,
@@ -655,7 +804,8 @@ mail_display_change_one_attachment_visibility (EMailDisplay *display,
 	g_hash_table_insert (display->priv->attachment_flags, attachment, GUINT_TO_POINTER (flags));
 
 	element_id = g_strdup_printf ("attachment-wrapper-%p", attachment);
-	e_web_view_set_element_hidden (E_WEB_VIEW (display), element_id, !show);
+	if (!show || !mail_display_load_deferred_content (display, attachment, element_id))
+		e_web_view_set_element_hidden (E_WEB_VIEW (display), element_id, !show);
 	g_free (element_id);
 
 	element_id = g_strdup_printf ("attachment-expander-img-%p", attachment);
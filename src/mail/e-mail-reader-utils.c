@@ -1075,6 +1075,7 @@ summary_msgid_equal (gconstpointer a,
 
 typedef struct {
 	CamelFolder *folder;
+	MailFolderCache *folder_cache;
 	GSList *uids;
 	EIgnoreThreadKind kind;
 } MarkIgnoreThreadData;
@@ -1086,6 +1087,7 @@ mark_ignore_thread_data_free (gpointer ptr)
 
 	if (mit) {
 		g_clear_object (&mit->folder);
+		g_clear_object (&mit->folder_cache);
 		g_slist_free_full (mit->uids, (GDestroyNotify) camel_pstring_free);
 		g_free (mit);
 	}
@@ -1108,6 +1110,7 @@ insert_to_checked_msgids (GHashTable *checked_msgids,
 
 static gboolean
 mark_ignore_thread_traverse_uids (CamelFolder *folder,
+				  MailFolderCache *folder_cache,
 				  const gchar *in_uid,
 				  GHashTable *checked_uids,
 				  GHashTable *checked_msgids,
@@ -1176,6 +1179,22 @@ mark_ignore_thread_traverse_uids (CamelFolder *folder,
 
 					insert_to_checked_msgids (checked_msgids, ref_msgid);
 
+					/* Prefer the folder's Message-ID index over the search */
+					uids = mail_folder_cache_dup_uids_by_message_id (folder_cache, folder, ref_msgid.id.id);
+					if (uids) {
+						guint jj;
+
+						for (jj = 0; jj < uids->len; jj++) {
+							const gchar *refruid = uids->pdata[jj];
+
+							if (refruid && !g_hash_table_contains (checked_uids, refruid))
+								to_check = g_slist_prepend (to_check, (gpointer) camel_pstring_strdup (refruid));
+						}
+
+						g_ptr_array_unref (uids);
+						continue;
+					}
+
 					if (!expr)
 						expr = g_string_new ("(match-all (or ");
 
@@ -1214,9 +1233,34 @@ mark_ignore_thread_traverse_uids (CamelFolder *folder,
 			}
 		}
 
-		/* Search for children */
-		sexp = g_strdup_printf ("(match-all (= \"references\" \"%lu %lu\"))", (gulong) msgid.id.part.hi, (gulong) msgid.id.part.lo);
-		uids = camel_folder_search_by_expression (folder, sexp, cancellable, &local_error);
+		/* Search for children; the index has no false positives */
+		uids = mail_folder_cache_dup_uids_by_reference (folder_cache, folder, msgid.id.id);
+		if (uids) {
+			for (ii = 0; ii < uids->len; ii++) {
+				const gchar *refruid = uids->pdata[ii];
+
+				if (refruid && !g_hash_table_contains (checked_uids, refruid)) {
+					CamelMessageInfo *refrmi = camel_folder_get_message_info (folder, refruid);
+					guint64 msg_id = 0;
+
+					if (refrmi)
+						msg_id = camel_message_info_get_message_id (refrmi);
+
+					if (msg_id && !g_hash_table_contains (checked_msgids, &msg_id))
+						to_check = g_slist_prepend (to_check, (gpointer) camel_pstring_strdup (refruid));
+
+					g_clear_object (&refrmi);
+				}
+			}
+
+			g_ptr_array_unref (uids);
+			uids = NULL;
+			sexp = NULL;
+		} else {
+			sexp = g_strdup_printf ("(match-all (= \"references\" \"%lu %lu\"))", (gulong) msgid.id.part.hi, (gulong) msgid.id.part.lo);
+			uids = camel_folder_search_by_expression (folder, sexp, cancellable, &local_error);
+		}
+
 		if (uids) {
 			for (ii = 0; ii < uids->len; ii++) {
 				const gchar *refruid = uids->pdata[ii];
@@ -1296,7 +1340,7 @@ mail_reader_utils_mark_ignore_thread_thread (EAlertSinkThreadJobData *job_data,
 	checked_msgids = g_hash_table_new_full (summary_msgid_hash, summary_msgid_equal, g_free, NULL);
 
 	for (link = mit->uids; link; link = g_slist_next (link)) {
-		if (!mark_ignore_thread_traverse_uids (mit->folder, link->data, checked_uids, checked_msgids,
+		if (!mark_ignore_thread_traverse_uids (mit->folder, mit->folder_cache, link->data, checked_uids, checked_msgids,
 			whole_thread, ignore_thread, cancellable, error)) {
 			break;
 		}
@@ -1350,6 +1394,8 @@ e_mail_reader_mark_selected_ignore_thread (EMailReader *reader,
 
 			mit = g_new0 (MarkIgnoreThreadData, 1);
 			mit->folder = g_object_ref (folder);
+			mit->folder_cache = g_object_ref (e_mail_session_get_folder_cache (
+				e_mail_backend_get_session (e_mail_reader_get_backend (reader))));
 			mit->kind = kind;
 
 			for (ii = 0; ii < uids->len; ii++) {
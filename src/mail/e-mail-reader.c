@@ -83,6 +83,11 @@ struct _EMailReaderPrivate {
 	 * message is selected before the retrieval has completed. */
 	GCancellable *retrieving_message;
 
+	/* Messages around the displayed one being parsed in advance,
+	 * cancelled when the cursor moves to neither of them. */
+	GCancellable *prefetching;
+	GPtrArray *prefetch_uids;
+
 	/* These flags work to prevent a folder switch from
 	 * automatically marking the message as read. We only want
 	 * that to happen when the -user- selects a message. */
@@ -161,6 +166,14 @@ mail_reader_private_free (EMailReaderPrivate *priv)
 		priv->retrieving_message = NULL;
 	}
 
+	if (priv->prefetching != NULL) {
+		g_cancellable_cancel (priv->prefetching);
+		g_object_unref (priv->prefetching);
+		priv->prefetching = NULL;
+	}
+
+	g_clear_pointer (&priv->prefetch_uids, g_ptr_array_unref);
+
 	g_slice_free (EMailReaderPrivate, priv);
 }
 
@@ -3617,9 +3630,45 @@ mail_reader_message_selected_timeout_cb (gpointer user_data)
 			EMailReaderClosure *closure;
 			GCancellable *cancellable;
 			CamelFolder *folder;
+			CamelMimeMessage *message = NULL;
 			EActivity *activity;
 			gchar *string;
 
+			folder = e_mail_reader_ref_folder (reader);
+
+			if (folder) {
+				EMailPartList *recent;
+				gchar *mail_uri;
+
+				mail_uri = e_mail_part_build_uri (folder, cursor_uid, NULL, NULL);
+				recent = camel_object_bag_peek (e_mail_part_list_get_registry (), mail_uri);
+				g_free (mail_uri);
+
+				if (recent) {
+					message = e_mail_part_list_get_message (recent);
+					if (message)
+						g_object_ref (message);
+					g_object_unref (recent);
+				}
+			}
+
+			if (message) {
+				/* The message is still parsed from when it was shown
+				 * recently, neither fetch nor parse it again. */
+				mail_reader_manage_followup_flag (reader, folder, cursor_uid);
+
+				g_signal_emit (
+					reader, signals[MESSAGE_LOADED], 0,
+					cursor_uid, message);
+
+				g_object_unref (message);
+				g_clear_object (&folder);
+
+				priv->message_selected_timeout_id = 0;
+
+				return FALSE;
+			}
+
 			string = g_strdup_printf (
 				_("Retrieving message “%s”"), cursor_uid);
 			e_mail_display_set_part_list (display, NULL);
@@ -3635,8 +3684,6 @@ mail_reader_message_selected_timeout_cb (gpointer user_data)
 			closure->reader = g_object_ref (reader);
 			closure->message_uid = g_strdup (cursor_uid);
 
-			folder = e_mail_reader_ref_folder (reader);
-
 			camel_folder_get_message (
 				folder, cursor_uid, G_PRIORITY_DEFAULT,
 				cancellable, (GAsyncReadyCallback)
@@ -3669,6 +3716,20 @@ mail_reader_message_selected_cb (EMailReader *reader,
 	/* Cancel the previous message retrieval activity. */
 	g_cancellable_cancel (priv->retrieving_message);
 
+	/* Let the prefetch finish only when it is for the newly
+	 * selected message, otherwise it is no longer of any use. */
+	if (priv->prefetching) {
+		gboolean is_prefetched = FALSE;
+		guint ii;
+
+		for (ii = 0; message_uid && priv->prefetch_uids && ii < priv->prefetch_uids->len && !is_prefetched; ii++) {
+			is_prefetched = g_strcmp0 (message_uid, g_ptr_array_index (priv->prefetch_uids, ii)) == 0;
+		}
+
+		if (!is_prefetched)
+			mail_reader_cancel_prefetch (reader);
+	}
+
 	/* Cancel the message selected timer. */
 	if (priv->message_selected_timeout_id > 0) {
 		g_source_remove (priv->message_selected_timeout_id);
@@ -3909,6 +3970,110 @@ mail_reader_folder_loaded (EMailReader *reader)
 	e_mail_reader_update_actions (reader, state);
 }
 
+/* How many messages below and above the displayed one are fetched
+ * in advance, for keyboard triage to not wait on the server. */
+#define PREFETCH_N_NEXT 2
+#define PREFETCH_N_PREV 1
+
+struct _prefetch_msg {
+	MailMsg base;
+
+	CamelFolder *folder;
+	GPtrArray *uids;
+};
+
+static void
+prefetch_exec (struct _prefetch_msg *m,
+               GCancellable *cancellable,
+               GError **error)
+{
+	guint ii;
+
+	/* Only fetches the messages, which makes them available locally.
+	 * They are not parsed, because parsing can decrypt the message
+	 * and ask for a passphrase, and the parsed messages would take
+	 * the place of those the user had shown in the recent list. */
+	for (ii = 0; ii < m->uids->len && !g_cancellable_is_cancelled (cancellable); ii++) {
+		const gchar *uid = g_ptr_array_index (m->uids, ii);
+		CamelMimeMessage *message;
+
+		message = camel_folder_get_message_sync (m->folder, uid, cancellable, NULL);
+		g_clear_object (&message);
+	}
+}
+
+static void
+prefetch_free (struct _prefetch_msg *m)
+{
+	g_clear_object (&m->folder);
+	g_ptr_array_unref (m->uids);
+}
+
+static MailMsgInfo prefetch_info = {
+	sizeof (struct _prefetch_msg),
+	(MailMsgDescFunc) NULL,
+	(MailMsgExecFunc) prefetch_exec,
+	(MailMsgDoneFunc) NULL,
+	(MailMsgFreeFunc) prefetch_free
+};
+
+static void
+mail_reader_cancel_prefetch (EMailReader *reader)
+{
+	EMailReaderPrivate *priv;
+
+	priv = E_MAIL_READER_GET_PRIVATE (reader);
+
+	if (priv->prefetching) {
+		g_cancellable_cancel (priv->prefetching);
+		g_clear_object (&priv->prefetching);
+	}
+
+	g_clear_pointer (&priv->prefetch_uids, g_ptr_array_unref);
+}
+
+static void
+mail_reader_prefetch_neighbours (EMailReader *reader)
+{
+	EMailReaderPrivate *priv;
+	GtkWidget *message_list;
+	CamelFolder *folder;
+	GPtrArray *uids;
+	struct _prefetch_msg *m;
+
+	priv = E_MAIL_READER_GET_PRIVATE (reader);
+
+	mail_reader_cancel_prefetch (reader);
+
+	message_list = e_mail_reader_get_message_list (reader);
+	if (!message_list)
+		return;
+
+	folder = e_mail_reader_ref_folder (reader);
+	if (!folder)
+		return;
+
+	uids = message_list_get_neighbour_uids (
+		MESSAGE_LIST (message_list),
+		PREFETCH_N_NEXT, PREFETCH_N_PREV);
+
+	if (!uids->len) {
+		g_ptr_array_unref (uids);
+		g_object_unref (folder);
+		return;
+	}
+
+	m = mail_msg_new (&prefetch_info);
+	m->folder = folder;
+	m->uids = g_ptr_array_ref (uids);
+
+	priv->prefetching = g_object_ref (m->base.cancellable);
+	priv->prefetch_uids = uids;
+
+	/* One prefetch per reader at a time, behind the interactive work. */
+	mail_msg_push (m, MAIL_MSG_LANE_BACKGROUND, reader);
+}
+
 static void
 set_mail_display_part_list (GObject *object,
                             GAsyncResult *result,
@@ -3935,8 +4100,12 @@ set_mail_display_part_list (GObject *object,
 	e_mail_display_set_part_list (display, part_list);
 	e_mail_display_load (display, NULL);
 
+	e_mail_part_list_keep_recent (part_list);
+	mail_reader_prefetch_neighbours (reader);
+
 	/* Remove the reference added when parts list was
-	 * created, so that only owners are EMailDisplays. */
+	 * created, so that only owners are EMailDisplays
+	 * and the list of recently shown messages. */
 	g_object_unref (part_list);
 }
 
@@ -3969,7 +4138,10 @@ mail_reader_set_display_formatter_for_message (EMailReader *reader,
 	} else {
 		e_mail_display_set_part_list (display, parts);
 		e_mail_display_load (display, NULL);
+		e_mail_part_list_keep_recent (parts);
 		g_object_unref (parts);
+
+		mail_reader_prefetch_neighbours (reader);
 	}
 }
 
@@ -5199,6 +5371,8 @@ e_mail_reader_dispose (EMailReader *reader)
 	if (priv->retrieving_message)
 		g_cancellable_cancel (priv->retrieving_message);
 
+	mail_reader_cancel_prefetch (reader);
+
 	ongoing_operations = g_slist_copy_deep (priv->ongoing_operations, (GCopyFunc) g_object_ref, NULL);
 	g_slist_free (priv->ongoing_operations);
 	priv->ongoing_operations = NULL;
@@ -84,6 +84,218 @@ save_gicon_to_stream (GIcon *icon,
 	g_object_unref (icon);
 }
 
+/* A GInputStream fed with the chunks of a message being formatted,
+ * for the web view to show the beginning of the message while the rest
+ * of it is still being formatted.  Reads block until the next chunk
+ * arrives; GInputStream runs the asynchronous reads in a thread. */
+
+typedef struct _EMailRequestStream EMailRequestStream;
+typedef struct _EMailRequestStreamClass EMailRequestStreamClass;
+
+struct _EMailRequestStream {
+	GInputStream parent;
+
+	GMutex lock;
+	GCond cond;
+	GQueue chunks;		/* GBytes * */
+	gsize chunk_offset;	/* read bytes of the head chunk */
+	gboolean eof;
+	gboolean closed;
+};
+
+struct _EMailRequestStreamClass {
+	GInputStreamClass parent_class;
+};
+
+GType e_mail_request_stream_get_type (void);
+
+G_DEFINE_TYPE (EMailRequestStream, e_mail_request_stream, G_TYPE_INPUT_STREAM)
+
+static gssize
+mail_request_stream_read (GInputStream *stream,
+			  gpointer buffer,
+			  gsize count,
+			  GCancellable *cancellable,
+			  GError **error)
+{
+	EMailRequestStream *rs = (EMailRequestStream *) stream;
+	GBytes *bytes;
+	gsize n_read = 0;
+
+	g_mutex_lock (&rs->lock);
+
+	while (g_queue_is_empty (&rs->chunks) && !rs->eof && !rs->closed) {
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			g_mutex_unlock (&rs->lock);
+			return -1;
+		}
+
+		/* Wake up now and then to notice the cancellation. */
+		g_cond_wait_until (&rs->cond, &rs->lock, g_get_monotonic_time () + G_TIME_SPAN_SECOND / 10);
+	}
+
+	while (n_read < count && (bytes = g_queue_peek_head (&rs->chunks)) != NULL) {
+		const gchar *data;
+		gsize size, n_copy;
+
+		data = g_bytes_get_data (bytes, &size);
+		n_copy = MIN (count - n_read, size - rs->chunk_offset);
+
+		memcpy (((gchar *) buffer) + n_read, data + rs->chunk_offset, n_copy);
+
+		n_read += n_copy;
+		rs->chunk_offset += n_copy;
+
+		if (rs->chunk_offset == size) {
+			g_bytes_unref (g_queue_pop_head (&rs->chunks));
+			rs->chunk_offset = 0;
+		}
+	}
+
+	g_mutex_unlock (&rs->lock);
+
+	return n_read;
+}
+
+static gboolean
+mail_request_stream_close (GInputStream *stream,
+			   GCancellable *cancellable,
+			   GError **error)
+{
+	EMailRequestStream *rs = (EMailRequestStream *) stream;
+
+	g_mutex_lock (&rs->lock);
+
+	rs->closed = TRUE;
+
+	while (!g_queue_is_empty (&rs->chunks))
+		g_bytes_unref (g_queue_pop_head (&rs->chunks));
+
+	g_cond_broadcast (&rs->cond);
+	g_mutex_unlock (&rs->lock);
+
+	return TRUE;
+}
+
+static void
+mail_request_stream_finalize (GObject *object)
+{
+	EMailRequestStream *rs = (EMailRequestStream *) object;
+
+	while (!g_queue_is_empty (&rs->chunks))
+		g_bytes_unref (g_queue_pop_head (&rs->chunks));
+
+	g_mutex_clear (&rs->lock);
+	g_cond_clear (&rs->cond);
+
+	/* Chain up to parent's finalize() method. */
+	G_OBJECT_CLASS (e_mail_request_stream_parent_class)->finalize (object);
+}
+
+static void
+e_mail_request_stream_class_init (EMailRequestStreamClass *class)
+{
+	GObjectClass *object_class;
+	GInputStreamClass *input_stream_class;
+
+	object_class = G_OBJECT_CLASS (class);
+	object_class->finalize = mail_request_stream_finalize;
+
+	input_stream_class = G_INPUT_STREAM_CLASS (class);
+	input_stream_class->read_fn = mail_request_stream_read;
+	input_stream_class->close_fn = mail_request_stream_close;
+}
+
+static void
+e_mail_request_stream_init (EMailRequestStream *rs)
+{
+	g_mutex_init (&rs->lock);
+	g_cond_init (&rs->cond);
+}
+
+/* Adds a chunk to be read, or marks the end of the stream when
+ * the @bytes is %NULL.  Returns %FALSE when the stream had been
+ * closed by the reader and nothing more should be added. */
+static gboolean
+mail_request_stream_push (EMailRequestStream *rs,
+			  GBytes *bytes)
+{
+	gboolean closed;
+
+	g_mutex_lock (&rs->lock);
+
+	closed = rs->closed;
+
+	if (!closed) {
+		if (bytes)
+			g_queue_push_tail (&rs->chunks, g_bytes_ref (bytes));
+		else
+			rs->eof = TRUE;
+
+		g_cond_broadcast (&rs->cond);
+	}
+
+	g_mutex_unlock (&rs->lock);
+
+	return !closed;
+}
+
+typedef struct _StreamChunksData {
+	GWeakRef stream; /* EMailRequestStream */
+	gboolean any_written;
+} StreamChunksData;
+
+static void
+stream_chunks_data_free (gpointer ptr)
+{
+	StreamChunksData *scd = ptr;
+
+	if (scd) {
+		g_weak_ref_clear (&scd->stream);
+		g_slice_free (StreamChunksData, scd);
+	}
+}
+
+static gboolean
+mail_request_stream_chunk_cb (EMailFormatter *formatter,
+			      GBytes *chunk,
+			      gpointer user_data)
+{
+	StreamChunksData *scd = user_data;
+	EMailRequestStream *rs;
+	gboolean success = FALSE;
+
+	/* The web view dropped the stream, nobody is interested
+	 * in the rest of the message anymore. */
+	rs = g_weak_ref_get (&scd->stream);
+	if (!rs)
+		return FALSE;
+
+	if (chunk) {
+		scd->any_written = TRUE;
+		success = mail_request_stream_push (rs, chunk);
+	} else {
+		if (!scd->any_written) {
+			gchar *data;
+
+			data = g_strdup_printf (
+				"<p align='center'>%s</p>",
+				_("The message has no text content."));
+
+			/* Takes ownership of the string. */
+			chunk = g_bytes_new_take (data, strlen (data));
+			mail_request_stream_push (rs, chunk);
+			g_bytes_unref (chunk);
+		}
+
+		mail_request_stream_push (rs, NULL);
+	}
+
+	g_object_unref (rs);
+
+	return success;
+}
+
 static gboolean
 mail_request_process_mail_sync (EContentRequest *request,
 				SoupURI *suri,
@@ -254,9 +466,32 @@ mail_request_process_mail_sync (EContentRequest *request,
 		g_object_unref (part);
 
 	} else {
-		e_mail_formatter_format_sync (
-			formatter, part_list, output_stream,
-			context.flags, context.mode, cancellable);
+		EMailRequestStream *rs;
+		StreamChunksData *scd;
+
+		rs = g_object_new (e_mail_request_stream_get_type (), NULL);
+
+		scd = g_slice_new0 (StreamChunksData);
+		g_weak_ref_init (&scd->stream, rs);
+
+		/* The message is formatted part by part in a dedicated thread,
+		 * each part being passed to the stream when it is done. */
+		e_mail_formatter_format_chunked (
+			formatter, part_list, context.flags, context.mode,
+			cancellable, mail_request_stream_chunk_cb,
+			scd, stream_chunks_data_free);
+
+		*out_stream = G_INPUT_STREAM (rs);
+		*out_stream_length = -1;
+		*out_mime_type = g_strdup ("text/html");
+
+		g_clear_object (&context.part_list);
+		g_object_unref (output_stream);
+		g_object_unref (part_list);
+		g_object_unref (formatter);
+		g_free (context.uri);
+
+		return TRUE;
 	}
 
  no_part:
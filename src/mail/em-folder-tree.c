@@ -2369,7 +2369,7 @@ static void
 tree_drag_data_action (struct _DragDataReceivedAsync *m)
 {
 	m->move = m->action == GDK_ACTION_MOVE;
-	mail_msg_unordered_push (m);
+	mail_msg_push (m, MAIL_MSG_LANE_INTERACTIVE, NULL);
 }
 
 static void
@@ -371,7 +371,7 @@ em_folder_utils_copy_folders (CamelStore *fromstore,
 	m->delete = delete;
 	seq = m->base.seq;
 
-	mail_msg_unordered_push (m);
+	mail_msg_push (m, MAIL_MSG_LANE_INTERACTIVE, NULL);
 
 	return seq;
 }
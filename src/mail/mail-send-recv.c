@@ -1539,7 +1539,7 @@ receive_update_got_folderinfo (GObject *source_object,
 		m->info = send_info;
 		m->finfo = info;  /* takes ownership */
 
-		mail_msg_unordered_push (m);
+		mail_msg_push (m, MAIL_MSG_LANE_BACKGROUND, send_info->service);
 
 	} else {
 		receive_done (send_info);
@@ -1650,7 +1650,7 @@ maybe_delete_junk_or_expunge_local_store (EMailSession *session)
 	m->delete_junk = delete_junk;
 	m->expunge_trash = expunge_trash;
 
-	mail_msg_unordered_push (m);
+	mail_msg_push (m, MAIL_MSG_LANE_BACKGROUND, store);
 }
 
 static CamelService *
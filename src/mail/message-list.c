@@ -160,6 +160,16 @@ struct _RegenData {
 	gboolean folder_changed;
 	GHashTable *removed_uids; /* gchar *~>NULL */
 
+	/* Set when the regen is only due to folder changes, which can
+	 * be applied to the existing tree instead of rebuilding it. */
+	gboolean incremental;
+	gboolean expand_state_deferred;
+	CamelFolderChangeInfo *changes;
+	GPtrArray *incr_add_infos; /* CamelMessageInfo *, matching the search */
+	GHashTable *incr_drop_uids; /* gchar *uid ~> NULL, not matching the search anymore */
+	GHashTable *incr_parent_uids; /* guint64 *msgid ~> gchar *uid, referenced by the added messages */
+	GHashTable *incr_child_uids; /* gchar *uid ~> NULL, referencing the added messages */
+
 	CamelFolder *folder;
 	GPtrArray *summary;
 
@@ -551,6 +561,22 @@ regen_data_unref (RegenData *regen_data)
 
 		if (regen_data->removed_uids)
 			g_hash_table_destroy (regen_data->removed_uids);
+
+		if (regen_data->changes)
+			camel_folder_change_info_free (regen_data->changes);
+
+		if (regen_data->incr_add_infos)
+			g_ptr_array_unref (regen_data->incr_add_infos);
+
+		if (regen_data->incr_drop_uids)
+			g_hash_table_destroy (regen_data->incr_drop_uids);
+
+		if (regen_data->incr_parent_uids)
+			g_hash_table_destroy (regen_data->incr_parent_uids);
+
+		if (regen_data->incr_child_uids)
+			g_hash_table_destroy (regen_data->incr_child_uids);
+
 		g_clear_object (&regen_data->folder);
 
 		if (regen_data->expand_state != NULL)
@@ -707,6 +733,46 @@ message_list_tree_model_remove (MessageList *message_list,
 		e_tree_model_node_deleted (tree_model, node);
 }
 
+/* Moves the node, together with its subtree, under the new parent,
+ * in front of the sibling, or as the last child when it's NULL. */
+static void
+message_list_tree_model_move (MessageList *message_list,
+                              GNode *node,
+                              GNode *new_parent,
+                              GNode *sibling)
+{
+	ETreeModel *tree_model;
+	GNode *old_parent;
+	gboolean tree_model_frozen;
+	gint old_position = 0;
+
+	g_return_if_fail (node != NULL);
+	g_return_if_fail (node->parent != NULL);
+	g_return_if_fail (new_parent != NULL);
+
+	tree_model = E_TREE_MODEL (message_list);
+	tree_model_frozen = (message_list->priv->tree_model_frozen > 0);
+	old_parent = node->parent;
+
+	if (!tree_model_frozen) {
+		e_tree_model_pre_change (tree_model);
+		old_position = g_node_child_position (old_parent, node);
+	}
+
+	extended_g_node_unlink (node);
+
+	if (!tree_model_frozen)
+		e_tree_model_node_removed (
+			tree_model, old_parent, node, old_position);
+
+	extended_g_node_insert_before (new_parent, sibling, node);
+
+	if (!tree_model_frozen) {
+		e_tree_model_pre_change (tree_model);
+		e_tree_model_node_inserted (tree_model, new_parent, node);
+	}
+}
+
 static gint
 address_compare (gconstpointer address1,
                  gconstpointer address2,
@@ -2697,7 +2763,7 @@ static void
 ml_drop_action (struct _drop_msg *m)
 {
 	m->move = m->action == GDK_ACTION_MOVE;
-	mail_msg_unordered_push (m);
+	mail_msg_push (m, MAIL_MSG_LANE_INTERACTIVE, NULL);
 }
 
 static void
@@ -5906,86 +5972,136 @@ message_list_set_search (MessageList *message_list,
 	}
 }
 
+/* How values of a sort column are kept during the sort. */
+typedef enum {
+	SORT_KEY_VALUE,		/* compared with the column's compare function */
+	SORT_KEY_NUMBER,	/* "integer" and "pointer-integer64" compares */
+	SORT_KEY_STRING		/* "string", "collate" and "stringcase" compares */
+} SortKeyKind;
+
 struct sort_column_data {
 	ETableCol *col;
 	GtkSortType sort_type;
-};
+	SortKeyKind kind;
 
-struct sort_message_info_data {
-	CamelMessageInfo *mi;
-	GPtrArray *values; /* read values so far, in order of sort_array_data::sort_columns */
+	/* Dense arrays indexed by the position in the sorted UID array */
+	gpointer *values; /* as returned by ml_tree_value_at_ex() */
+	gint64 *numbers; /* for SORT_KEY_NUMBER */
+	gchar **keys; /* for SORT_KEY_STRING, either the values or their collation keys */
+	gboolean keys_allocated;
 };
 
 struct sort_array_data {
-	MessageList *message_list;
 	CamelFolder *folder;
+	GPtrArray *uids;
 	GPtrArray *sort_columns; /* struct sort_column_data in order of sorting */
-	GHashTable *message_infos; /* uid -> struct sort_message_info_data */
 	gpointer cmp_cache;
 	GCancellable *cancellable;
 };
 
+static SortKeyKind
+sort_column_get_key_kind (ETableCol *col)
+{
+	const gchar *compare = col->spec->compare;
+
+	if (g_strcmp0 (compare, "integer") == 0 ||
+	    g_strcmp0 (compare, "pointer-integer64") == 0)
+		return SORT_KEY_NUMBER;
+
+	if (g_strcmp0 (compare, "string") == 0 ||
+	    g_strcmp0 (compare, "collate") == 0 ||
+	    g_strcmp0 (compare, "stringcase") == 0)
+		return SORT_KEY_STRING;
+
+	return SORT_KEY_VALUE;
+}
+
+/* Reads the sort key of one message, which is done only once per message,
+ * thus the comparison function does not need to read any values. */
+static void
+sort_column_set_key (struct sort_column_data *scol,
+                     guint index,
+                     CamelMessageInfo *mi,
+                     MessageList *message_list)
+{
+	gint col = scol->col->spec->compare_col;
+	gpointer value;
+
+	camel_message_info_property_lock (mi);
+	value = ml_tree_value_at_ex (NULL, NULL, col, mi, message_list);
+	camel_message_info_property_unlock (mi);
+
+	switch (scol->kind) {
+	case SORT_KEY_NUMBER:
+		if (g_strcmp0 (scol->col->spec->compare, "integer") == 0)
+			scol->numbers[index] = GPOINTER_TO_INT (value);
+		/* Unset values sort before set, as e_int64ptr_compare() does */
+		else if (value)
+			scol->numbers[index] = *((gint64 *) value);
+		else
+			scol->numbers[index] = G_MININT64;
+
+		message_list_free_value ((ETreeModel *) message_list, col, value);
+		break;
+	case SORT_KEY_STRING:
+		scol->values[index] = value;
+
+		if (!value) {
+			scol->keys[index] = NULL;
+		} else if (g_strcmp0 (scol->col->spec->compare, "collate") == 0) {
+			scol->keys[index] = g_utf8_collate_key (value, -1);
+		} else if (g_strcmp0 (scol->col->spec->compare, "stringcase") == 0) {
+			gchar *tmp = g_utf8_casefold (value, -1);
+			scol->keys[index] = g_utf8_collate_key (tmp, -1);
+			g_free (tmp);
+		} else {
+			scol->keys[index] = value;
+		}
+		break;
+	case SORT_KEY_VALUE:
+		scol->values[index] = value;
+		break;
+	}
+}
+
 static gint
 cmp_array_uids (gconstpointer a,
                 gconstpointer b,
                 gpointer user_data)
 {
-	const gchar *uid1 = *(const gchar **) a;
-	const gchar *uid2 = *(const gchar **) b;
+	guint index1 = *(const guint *) a;
+	guint index2 = *(const guint *) b;
 	struct sort_array_data *sort_data = user_data;
 	gint i, res = 0;
-	struct sort_message_info_data *md1, *md2;
-
-	g_return_val_if_fail (sort_data != NULL, 0);
-
-	md1 = g_hash_table_lookup (sort_data->message_infos, uid1);
-	md2 = g_hash_table_lookup (sort_data->message_infos, uid2);
-
-	g_return_val_if_fail (md1 != NULL, 0);
-	g_return_val_if_fail (md1->mi != NULL, 0);
-	g_return_val_if_fail (md2 != NULL, 0);
-	g_return_val_if_fail (md2->mi != NULL, 0);
 
 	if (g_cancellable_is_cancelled (sort_data->cancellable))
 		return 0;
 
-	for (i = 0;
-	     res == 0
-	     && i < sort_data->sort_columns->len
-	     && !g_cancellable_is_cancelled (sort_data->cancellable);
-	     i++) {
-		gpointer v1, v2;
+	for (i = 0; res == 0 && i < sort_data->sort_columns->len; i++) {
 		struct sort_column_data *scol = g_ptr_array_index (sort_data->sort_columns, i);
+		gconstpointer v1, v2;
 
-		if (md1->values->len <= i) {
-			camel_message_info_property_lock (md1->mi);
-			v1 = ml_tree_value_at_ex (
-				NULL, NULL,
-				scol->col->spec->compare_col,
-				md1->mi, sort_data->message_list);
-			camel_message_info_property_unlock (md1->mi);
-			g_ptr_array_add (md1->values, v1);
-		} else {
-			v1 = g_ptr_array_index (md1->values, i);
-		}
-
-		if (md2->values->len <= i) {
-			camel_message_info_property_lock (md2->mi);
-			v2 = ml_tree_value_at_ex (
-				NULL, NULL,
-				scol->col->spec->compare_col,
-				md2->mi, sort_data->message_list);
-			camel_message_info_property_unlock (md2->mi);
+		if (scol->kind == SORT_KEY_NUMBER) {
+			gint64 n1 = scol->numbers[index1], n2 = scol->numbers[index2];
 
-			g_ptr_array_add (md2->values, v2);
+			res = (n1 == n2) ? 0 : (n1 < n2) ? -1 : 1;
 		} else {
-			v2 = g_ptr_array_index (md2->values, i);
-		}
+			if (scol->kind == SORT_KEY_STRING) {
+				v1 = scol->keys[index1];
+				v2 = scol->keys[index2];
+			} else {
+				v1 = scol->values[index1];
+				v2 = scol->values[index2];
+			}
 
-		if (v1 != NULL && v2 != NULL) {
-			res = (*scol->col->compare) (v1, v2, sort_data->cmp_cache);
-		} else if (v1 != NULL || v2 != NULL) {
-			res = v1 == NULL ? -1 : 1;
+			if (v1 != NULL && v2 != NULL) {
+				if (scol->kind == SORT_KEY_STRING)
+					res = strcmp (v1, v2);
+				else
+					res = (*scol->col->compare) (v1, v2, sort_data->cmp_cache);
+			} else if (v1 != NULL || v2 != NULL) {
+				res = v1 == NULL ? -1 : 1;
+			}
 		}
 
 		if (scol->sort_type == GTK_SORT_DESCENDING)
@@ -5993,32 +6109,41 @@ cmp_array_uids (gconstpointer a,
 	}
 
 	if (res == 0)
-		res = camel_folder_cmp_uids (sort_data->folder, uid1, uid2);
+		res = camel_folder_cmp_uids (
+			sort_data->folder,
+			g_ptr_array_index (sort_data->uids, index1),
+			g_ptr_array_index (sort_data->uids, index2));
 
 	return res;
 }
 
 static void
-free_message_info_data (gpointer uid,
-                        struct sort_message_info_data *data,
-                        struct sort_array_data *sort_data)
+free_sort_column_data (struct sort_column_data *scol,
+                       MessageList *message_list,
+                       guint n_values)
 {
-	if (data->values) {
-		gint ii;
-
-		for (ii = 0; ii < sort_data->sort_columns->len && ii < data->values->len; ii++) {
-			struct sort_column_data *scol = g_ptr_array_index (sort_data->sort_columns, ii);
+	guint ii;
 
-			message_list_free_value ((ETreeModel *) sort_data->message_list,
-				scol->col->spec->compare_col,
-				g_ptr_array_index (data->values, ii));
+	if (scol->values) {
+		for (ii = 0; ii < n_values; ii++) {
+			if (scol->values[ii])
+				message_list_free_value ((ETreeModel *) message_list,
+					scol->col->spec->compare_col,
+					scol->values[ii]);
 		}
 
-		g_ptr_array_free (data->values, TRUE);
+		g_free (scol->values);
+	}
+
+	if (scol->keys && scol->keys_allocated) {
+		for (ii = 0; ii < n_values; ii++) {
+			g_free (scol->keys[ii]);
+		}
 	}
 
-	g_clear_object (&data->mi);
-	g_free (data);
+	g_free (scol->keys);
+	g_free (scol->numbers);
+	g_free (scol);
 }
 
 static void
@@ -6030,6 +6155,8 @@ ml_sort_uids_by_tree (MessageList *message_list,
 {
 	CamelFolder *folder;
 	struct sort_array_data sort_data;
+	guint *indexes;
+	gpointer *sorted_uids;
 	guint i, len;
 
 	if (g_cancellable_is_cancelled (cancellable))
@@ -6048,10 +6175,9 @@ ml_sort_uids_by_tree (MessageList *message_list,
 
 	len = e_table_sort_info_sorting_get_count (sort_info);
 
-	sort_data.message_list = message_list;
 	sort_data.folder = folder;
+	sort_data.uids = uids;
 	sort_data.sort_columns = g_ptr_array_sized_new (len);
-	sort_data.message_infos = g_hash_table_new (g_str_hash, g_str_equal);
 	sort_data.cmp_cache = e_table_sorting_utils_create_cmp_cache ();
 	sort_data.cancellable = cancellable;
 
@@ -6073,56 +6199,81 @@ ml_sort_uids_by_tree (MessageList *message_list,
 			data->col = e_table_header_get_column (full_header, last);
 		}
 
+		/* One allocation per column, not per message */
+		data->kind = sort_column_get_key_kind (data->col);
+
+		if (data->kind == SORT_KEY_NUMBER) {
+			data->numbers = g_new0 (gint64, uids->len);
+		} else {
+			data->values = g_new0 (gpointer, uids->len);
+
+			if (data->kind == SORT_KEY_STRING) {
+				data->keys = g_new0 (gchar *, uids->len);
+				data->keys_allocated = g_strcmp0 (data->col->spec->compare, "string") != 0;
+			}
+		}
+
 		g_ptr_array_add (sort_data.sort_columns, data);
 	}
 
 	camel_folder_summary_prepare_fetch_all (camel_folder_get_folder_summary (folder), NULL);
 
+	indexes = g_new (guint, uids->len);
+
 	for (i = 0;
 	     i < uids->len
 	     && !g_cancellable_is_cancelled (cancellable);
 	     i++) {
-		gchar *uid;
 		CamelMessageInfo *mi;
-		struct sort_message_info_data *md;
+		guint j;
 
-		uid = g_ptr_array_index (uids, i);
-		mi = camel_folder_get_message_info (folder, uid);
+		indexes[i] = i;
+
+		mi = camel_folder_get_message_info (folder, g_ptr_array_index (uids, i));
 
 		/* This can happen when the folder is updated and messages moved
-		   elsewhere or deleted while the message list regeneration is running. */
+		   elsewhere or deleted while the message list regeneration is running.
+		   Such messages keep empty keys. */
 		if (!mi)
 			continue;
 
-		md = g_new0 (struct sort_message_info_data, 1);
-		md->mi = mi;
-		md->values = g_ptr_array_sized_new (len);
+		for (j = 0; j < sort_data.sort_columns->len; j++) {
+			sort_column_set_key (g_ptr_array_index (sort_data.sort_columns, j), i, mi, message_list);
+		}
 
-		g_hash_table_insert (sort_data.message_infos, uid, md);
+		g_object_unref (mi);
 	}
 
-	if (!g_cancellable_is_cancelled (cancellable))
+	if (!g_cancellable_is_cancelled (cancellable)) {
 		g_qsort_with_data (
-			uids->pdata,
+			indexes,
 			uids->len,
-			sizeof (gpointer),
+			sizeof (guint),
 			cmp_array_uids,
 			&sort_data);
 
+		sorted_uids = g_new (gpointer, uids->len);
+
+		for (i = 0; i < uids->len; i++) {
+			sorted_uids[i] = uids->pdata[indexes[i]];
+		}
+
+		memcpy (uids->pdata, sorted_uids, sizeof (gpointer) * uids->len);
+
+		g_free (sorted_uids);
+	}
+
 	camel_folder_summary_unlock (camel_folder_get_folder_summary (folder));
 
-	/* FIXME Teach the hash table to destroy its own data. */
-	g_hash_table_foreach (
-		sort_data.message_infos,
-		(GHFunc) free_message_info_data,
-		&sort_data);
-	g_hash_table_destroy (sort_data.message_infos);
+	for (i = 0; i < sort_data.sort_columns->len; i++) {
+		free_sort_column_data (g_ptr_array_index (sort_data.sort_columns, i), message_list, uids->len);
+	}
 
-	g_ptr_array_foreach (sort_data.sort_columns, (GFunc) g_free, NULL);
 	g_ptr_array_free (sort_data.sort_columns, TRUE);
 
 	e_table_sorting_utils_free_cmp_cache (sort_data.cmp_cache);
 
+	g_free (indexes);
 	g_object_unref (folder);
 }
 
@@ -6187,6 +6338,297 @@ message_list_regen_tweak_search_results (MessageList *message_list,
 	g_clear_object (&info);
 }
 
+static void
+ml_msgid_expr_append (GString **pexpr,
+                      const gchar *header,
+                      guint64 msgid)
+{
+	CamelSummaryMessageID summary_msgid;
+
+	summary_msgid.id.id = msgid;
+
+	if (!*pexpr)
+		*pexpr = g_string_new ("(match-all (or ");
+
+	g_string_append_printf (*pexpr, "(= \"%s\" \"%lu %lu\")",
+		header,
+		(gulong) summary_msgid.id.part.hi,
+		(gulong) summary_msgid.id.part.lo);
+}
+
+/* The same as message_list_regen_incremental_threads(), only using
+ * the folder's Message-ID index instead of searching the folder.
+ * Returns FALSE when the folder is not indexed. */
+static gboolean
+message_list_regen_incremental_threads_indexed (RegenData *regen_data)
+{
+	CamelFolder *folder = regen_data->folder;
+	MailFolderCache *folder_cache;
+	GPtrArray *uids;
+	guint ii, jj, kk;
+
+	folder_cache = e_mail_session_get_folder_cache (
+		message_list_get_session (regen_data->message_list));
+
+	/* Builds the index, if needed */
+	uids = mail_folder_cache_dup_uids_by_message_id (folder_cache, folder, 0);
+	if (!uids)
+		return FALSE;
+
+	g_ptr_array_unref (uids);
+
+	for (ii = 0; ii < regen_data->incr_add_infos->len; ii++) {
+		CamelMessageInfo *info = g_ptr_array_index (regen_data->incr_add_infos, ii);
+		GArray *references;
+		guint64 msgid;
+
+		msgid = camel_message_info_get_message_id (info);
+		if (msgid) {
+			uids = mail_folder_cache_dup_uids_by_reference (folder_cache, folder, msgid);
+			for (jj = 0; uids && jj < uids->len; jj++) {
+				if (!regen_data->incr_child_uids)
+					regen_data->incr_child_uids = g_hash_table_new_full (g_str_hash, g_str_equal, (GDestroyNotify) camel_pstring_free, NULL);
+
+				g_hash_table_add (regen_data->incr_child_uids, (gpointer) camel_pstring_strdup (uids->pdata[jj]));
+			}
+
+			if (uids)
+				g_ptr_array_unref (uids);
+		}
+
+		references = camel_message_info_dup_references (info);
+		if (!references)
+			continue;
+
+		for (jj = 0; jj < references->len; jj++) {
+			msgid = g_array_index (references, guint64, jj);
+			if (!msgid)
+				continue;
+
+			if (!regen_data->incr_parent_uids)
+				regen_data->incr_parent_uids = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, (GDestroyNotify) camel_pstring_free);
+			else if (g_hash_table_contains (regen_data->incr_parent_uids, &msgid))
+				continue;
+
+			uids = mail_folder_cache_dup_uids_by_message_id (folder_cache, folder, msgid);
+			for (kk = 0; uids && kk < uids->len; kk++) {
+				g_hash_table_insert (regen_data->incr_parent_uids,
+					g_memdup (&msgid, sizeof (guint64)),
+					(gpointer) camel_pstring_strdup (uids->pdata[kk]));
+			}
+
+			if (uids)
+				g_ptr_array_unref (uids);
+		}
+
+		g_array_unref (references);
+	}
+
+	return TRUE;
+}
+
+/* Finds messages referenced by the messages to be added, and messages
+ * referencing them, thus they can be put into the right place of the
+ * thread tree without threading the whole folder again. */
+static gboolean
+message_list_regen_incremental_threads (RegenData *regen_data,
+                                        GCancellable *cancellable,
+                                        GError **error)
+{
+	CamelFolder *folder = regen_data->folder;
+	GString *parents_expr = NULL, *children_expr = NULL;
+	GPtrArray *uids;
+	guint ii, jj;
+
+	if (message_list_regen_incremental_threads_indexed (regen_data))
+		return TRUE;
+
+	for (ii = 0; ii < regen_data->incr_add_infos->len; ii++) {
+		CamelMessageInfo *info = g_ptr_array_index (regen_data->incr_add_infos, ii);
+		GArray *references;
+		guint64 msgid;
+
+		msgid = camel_message_info_get_message_id (info);
+		if (msgid)
+			ml_msgid_expr_append (&children_expr, "references", msgid);
+
+		references = camel_message_info_dup_references (info);
+		if (references) {
+			for (jj = 0; jj < references->len; jj++) {
+				msgid = g_array_index (references, guint64, jj);
+				if (msgid)
+					ml_msgid_expr_append (&parents_expr, "msgid", msgid);
+			}
+
+			g_array_unref (references);
+		}
+	}
+
+	if (parents_expr) {
+		g_string_append (parents_expr, "))");
+
+		uids = camel_folder_search_by_expression (folder, parents_expr->str, cancellable, error);
+
+		g_string_free (parents_expr, TRUE);
+
+		if (!uids) {
+			if (children_expr)
+				g_string_free (children_expr, TRUE);
+			return FALSE;
+		}
+
+		regen_data->incr_parent_uids = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, (GDestroyNotify) camel_pstring_free);
+
+		for (ii = 0; ii < uids->len; ii++) {
+			CamelMessageInfo *info;
+			guint64 msgid;
+
+			info = camel_folder_get_message_info (folder, uids->pdata[ii]);
+			if (!info)
+				continue;
+
+			msgid = camel_message_info_get_message_id (info);
+			if (msgid) {
+				g_hash_table_insert (regen_data->incr_parent_uids,
+					g_memdup (&msgid, sizeof (guint64)),
+					(gpointer) camel_pstring_strdup (uids->pdata[ii]));
+			}
+
+			g_object_unref (info);
+		}
+
+		camel_folder_search_free (folder, uids);
+	}
+
+	if (children_expr) {
+		g_string_append (children_expr, "))");
+
+		uids = camel_folder_search_by_expression (folder, children_expr->str, cancellable, error);
+
+		g_string_free (children_expr, TRUE);
+
+		if (!uids)
+			return FALSE;
+
+		regen_data->incr_child_uids = g_hash_table_new_full (g_str_hash, g_str_equal, (GDestroyNotify) camel_pstring_free, NULL);
+
+		for (ii = 0; ii < uids->len; ii++) {
+			g_hash_table_add (regen_data->incr_child_uids, (gpointer) camel_pstring_strdup (uids->pdata[ii]));
+		}
+
+		camel_folder_search_free (folder, uids);
+	}
+
+	return TRUE;
+}
+
+/* Evaluates the search expression only against the added and changed
+ * messages, collecting what needs to be added to or dropped from the
+ * existing tree.  Returns FALSE when the changes cannot be applied
+ * in place and a full regen should be done instead. */
+static gboolean
+message_list_regen_incremental (RegenData *regen_data,
+                                const gchar *expr,
+                                GCancellable *cancellable,
+                                GError **error)
+{
+	CamelFolder *folder = regen_data->folder;
+	CamelFolderChangeInfo *changes = regen_data->changes;
+	GHashTable *removed, *matched = NULL;
+	GPtrArray *candidates;
+	guint ii;
+
+	if (!changes)
+		return FALSE;
+
+	/* Threading by subject can join otherwise unrelated
+	 * threads, which needs to see the whole folder. */
+	if (regen_data->group_by_threads && regen_data->thread_subject)
+		return FALSE;
+
+	/* When a large part of the folder changed, then
+	 * the full search is cheaper than the partial one. */
+	if (changes->uid_added->len + changes->uid_changed->len >
+	    camel_folder_get_message_count (folder) / 4)
+		return FALSE;
+
+	removed = g_hash_table_new (g_str_hash, g_str_equal);
+
+	for (ii = 0; ii < changes->uid_removed->len; ii++) {
+		g_hash_table_add (removed, changes->uid_removed->pdata[ii]);
+	}
+
+	candidates = g_ptr_array_sized_new (changes->uid_added->len + changes->uid_changed->len);
+
+	for (ii = 0; ii < changes->uid_added->len; ii++) {
+		if (!g_hash_table_contains (removed, changes->uid_added->pdata[ii]))
+			g_ptr_array_add (candidates, changes->uid_added->pdata[ii]);
+	}
+
+	for (ii = 0; ii < changes->uid_changed->len; ii++) {
+		if (!g_hash_table_contains (removed, changes->uid_changed->pdata[ii]))
+			g_ptr_array_add (candidates, changes->uid_changed->pdata[ii]);
+	}
+
+	g_hash_table_destroy (removed);
+
+	if (candidates->len > 0 && *expr) {
+		GPtrArray *found;
+		GError *local_error = NULL;
+
+		found = camel_folder_search_by_uids (folder, expr, candidates, cancellable, &local_error);
+		if (!found) {
+			g_ptr_array_free (candidates, TRUE);
+
+			if (!local_error)
+				return FALSE;
+
+			g_propagate_error (error, local_error);
+
+			return TRUE;
+		}
+
+		matched = g_hash_table_new_full (g_str_hash, g_str_equal, (GDestroyNotify) camel_pstring_free, NULL);
+
+		for (ii = 0; ii < found->len; ii++) {
+			g_hash_table_add (matched, (gpointer) camel_pstring_strdup (found->pdata[ii]));
+		}
+
+		camel_folder_search_free (folder, found);
+	}
+
+	regen_data->incr_add_infos = g_ptr_array_new_with_free_func (g_object_unref);
+	regen_data->incr_drop_uids = g_hash_table_new_full (g_str_hash, g_str_equal, (GDestroyNotify) camel_pstring_free, NULL);
+
+	for (ii = 0; ii < candidates->len && !g_cancellable_is_cancelled (cancellable); ii++) {
+		const gchar *uid = candidates->pdata[ii];
+		CamelMessageInfo *info = NULL;
+
+		if (!matched || g_hash_table_contains (matched, uid))
+			info = camel_folder_get_message_info (folder, uid);
+
+		if (info)
+			g_ptr_array_add (regen_data->incr_add_infos, info);
+		else
+			g_hash_table_add (regen_data->incr_drop_uids, (gpointer) camel_pstring_strdup (uid));
+	}
+
+	if (matched)
+		g_hash_table_destroy (matched);
+
+	g_ptr_array_free (candidates, TRUE);
+
+	if (regen_data->group_by_threads && regen_data->incr_add_infos->len > 0 &&
+	    !g_cancellable_is_cancelled (cancellable)) {
+		GError *local_error = NULL;
+
+		if (!message_list_regen_incremental_threads (regen_data, cancellable, &local_error) && local_error)
+			g_propagate_error (error, local_error);
+	}
+
+	return TRUE;
+}
+
 static void
 message_list_regen_thread (GSimpleAsyncResult *simple,
                            GObject *source_object,
@@ -6194,7 +6636,7 @@ message_list_regen_thread (GSimpleAsyncResult *simple,
 {
 	MessageList *message_list;
 	RegenData *regen_data;
-	GPtrArray *uids, *searchuids = NULL;
+	GPtrArray *uids = NULL, *searchuids = NULL;
 	CamelMessageInfo *info;
 	CamelFolder *folder;
 	GNode *cursor;
@@ -6253,6 +6695,27 @@ message_list_regen_thread (GSimpleAsyncResult *simple,
 		}
 	}
 
+	if (regen_data->incremental) {
+		if (message_list_regen_incremental (regen_data, expr->str, cancellable, &local_error)) {
+			g_string_free (expr, TRUE);
+
+			if (local_error == NULL) {
+				/* coverity[unchecked_value] */
+				if (g_cancellable_set_error_if_cancelled (cancellable, &local_error)) {
+					;
+				}
+			}
+
+			if (local_error != NULL)
+				g_simple_async_result_take_error (simple, local_error);
+
+			goto exit;
+		}
+
+		/* The changes cannot be applied in place, thus rebuild the whole list. */
+		regen_data->incremental = FALSE;
+	}
+
 	/* Execute the search. */
 
 	if (expr->len == 0) {
@@ -6471,6 +6934,295 @@ message_list_correct_row_for_remove_in_selection (MessageList *message_list,
 	return best_row;
 }
 
+/* Replies to a removed message are moved one level up,
+ * the same as the thread builder does for missing parents. */
+static void
+ml_incremental_remove_node (MessageList *message_list,
+                            GNode *node)
+{
+	CamelMessageInfo *info;
+
+	while (node->children)
+		message_list_tree_model_move (message_list, node->children, node->parent, node);
+
+	info = node->data;
+
+	message_list_tree_model_remove (message_list, node);
+
+	g_return_if_fail (info);
+	ml_uid_nodemap_remove (message_list, info);
+}
+
+/* Returns the thread parent of the message being added, which is the node
+ * of its closest reference shown in the tree.  Sets out_pending when
+ * a closer reference is waiting to be added in the same batch. */
+static GNode *
+ml_incremental_find_parent (MessageList *message_list,
+                            RegenData *regen_data,
+                            CamelMessageInfo *info,
+                            GHashTable *pending_msgids,
+                            gboolean *out_pending)
+{
+	GArray *references;
+	GNode *parent = NULL;
+	guint ii;
+
+	*out_pending = FALSE;
+
+	if (!regen_data->incr_parent_uids)
+		return NULL;
+
+	references = camel_message_info_dup_references (info);
+	if (!references)
+		return NULL;
+
+	for (ii = 0; ii < references->len && !parent; ii++) {
+		guint64 msgid = g_array_index (references, guint64, ii);
+		const gchar *uid;
+
+		if (!msgid)
+			continue;
+
+		if (g_hash_table_contains (pending_msgids, &msgid)) {
+			*out_pending = TRUE;
+			break;
+		}
+
+		uid = g_hash_table_lookup (regen_data->incr_parent_uids, &msgid);
+		if (uid)
+			parent = g_hash_table_lookup (message_list->uid_nodemap, uid);
+	}
+
+	g_array_unref (references);
+
+	return parent;
+}
+
+/* Returns the newly added node the existing node should be moved under,
+ * or NULL when its current parent is a closer reference. */
+static GNode *
+ml_incremental_find_new_parent (GNode *node,
+                                GHashTable *added_nodes)
+{
+	GArray *references;
+	GNode *new_parent = NULL;
+	guint64 parent_msgid = 0;
+	guint ii;
+
+	references = camel_message_info_dup_references (node->data);
+	if (!references)
+		return NULL;
+
+	if (node->parent && !G_NODE_IS_ROOT (node->parent))
+		parent_msgid = camel_message_info_get_message_id (node->parent->data);
+
+	for (ii = 0; ii < references->len && !new_parent; ii++) {
+		guint64 msgid = g_array_index (references, guint64, ii);
+
+		if (!msgid)
+			continue;
+
+		if (msgid == parent_msgid)
+			break;
+
+		new_parent = g_hash_table_lookup (added_nodes, &msgid);
+	}
+
+	g_array_unref (references);
+
+	return new_parent;
+}
+
+static void
+message_list_regen_apply_incremental (MessageList *message_list,
+                                      RegenData *regen_data)
+{
+	CamelFolderChangeInfo *changes = regen_data->changes;
+	ETreeModel *tree_model;
+	ETableItem *table_item;
+	GHashTable *pending_msgids = NULL;
+	GHashTable *added_nodes = NULL;
+	GHashTableIter iter;
+	GPtrArray *pending;
+	gpointer key;
+	gboolean freeze, force = FALSE;
+	guint ii;
+#ifdef TIMEIT
+	struct timeval start, end;
+	gulong diff;
+
+	printf ("Applying changes\n");
+	gettimeofday (&start, NULL);
+#endif
+
+	g_return_if_fail (changes != NULL);
+	g_return_if_fail (regen_data->incr_add_infos != NULL);
+	g_return_if_fail (regen_data->incr_drop_uids != NULL);
+
+	tree_model = E_TREE_MODEL (message_list);
+	table_item = e_tree_get_item (E_TREE (message_list));
+
+	/* Each inserted node makes the tree view re-sort all its siblings,
+	 * which is expensive with large folders, thus let the view pick up
+	 * the whole new state at once whenever anything is to be added.
+	 * A few removals or changes are cheaper without freezing. */
+	freeze = changes->uid_removed->len +
+		g_hash_table_size (regen_data->incr_drop_uids) +
+		regen_data->incr_add_infos->len > 10;
+
+	for (ii = 0; !freeze && ii < regen_data->incr_add_infos->len; ii++) {
+		CamelMessageInfo *info = g_ptr_array_index (regen_data->incr_add_infos, ii);
+
+		freeze = !g_hash_table_contains (message_list->uid_nodemap, camel_message_info_get_uid (info));
+	}
+
+	if (table_item)
+		e_table_item_freeze (table_item);
+
+	if (freeze)
+		message_list_tree_model_freeze (message_list);
+
+	for (ii = 0; ii < changes->uid_removed->len; ii++) {
+		GNode *node;
+
+		node = g_hash_table_lookup (message_list->uid_nodemap, changes->uid_removed->pdata[ii]);
+		if (node)
+			ml_incremental_remove_node (message_list, node);
+	}
+
+	g_hash_table_iter_init (&iter, regen_data->incr_drop_uids);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		GNode *node;
+
+		node = g_hash_table_lookup (message_list->uid_nodemap, key);
+		if (!node)
+			continue;
+
+		/* Keep the displayed message, unless it should be hidden,
+		 * the same as message_list_regen_tweak_search_results() does. */
+		if (g_strcmp0 (key, message_list->cursor_uid) == 0 &&
+		    is_node_selectable (message_list, node->data, NULL))
+			continue;
+
+		ml_incremental_remove_node (message_list, node);
+	}
+
+	pending = g_ptr_array_sized_new (regen_data->incr_add_infos->len);
+
+	for (ii = 0; ii < regen_data->incr_add_infos->len; ii++) {
+		CamelMessageInfo *info = g_ptr_array_index (regen_data->incr_add_infos, ii);
+		GNode *node;
+
+		node = g_hash_table_lookup (message_list->uid_nodemap, camel_message_info_get_uid (info));
+		if (!node) {
+			g_ptr_array_add (pending, info);
+		} else if (!freeze) {
+			e_tree_model_pre_change (tree_model);
+			e_tree_model_node_data_changed (tree_model, node);
+
+			message_list_change_first_visible_parent (message_list, node);
+		}
+	}
+
+	if (regen_data->group_by_threads && pending->len > 0) {
+		pending_msgids = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, NULL);
+		added_nodes = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, NULL);
+
+		for (ii = 0; ii < pending->len; ii++) {
+			guint64 msgid;
+
+			msgid = camel_message_info_get_message_id (pending->pdata[ii]);
+			if (msgid)
+				g_hash_table_add (pending_msgids, g_memdup (&msgid, sizeof (guint64)));
+		}
+	}
+
+	/* Parents are added before their replies; when the references form
+	 * a loop, then the rest is added without waiting for each other. */
+	while (pending->len > 0) {
+		gboolean progress = FALSE;
+
+		for (ii = 0; ii < pending->len; ii++) {
+			CamelMessageInfo *info = g_ptr_array_index (pending, ii);
+			GNode *parent = NULL, *node;
+			gboolean is_pending = FALSE;
+
+			if (pending_msgids) {
+				parent = ml_incremental_find_parent (message_list, regen_data, info, pending_msgids, &is_pending);
+				if (is_pending && !force)
+					continue;
+			}
+
+			node = ml_uid_nodemap_insert (message_list, info, parent, -1);
+
+			if (pending_msgids) {
+				guint64 msgid;
+
+				msgid = camel_message_info_get_message_id (info);
+				if (msgid) {
+					g_hash_table_remove (pending_msgids, &msgid);
+					g_hash_table_insert (added_nodes, g_memdup (&msgid, sizeof (guint64)), node);
+				}
+			}
+
+			g_ptr_array_remove_index (pending, ii);
+			ii--;
+
+			progress = TRUE;
+		}
+
+		if (!progress)
+			force = TRUE;
+	}
+
+	/* Replies received before the message they reply to
+	 * are moved under it, once it is finally in the tree. */
+	if (added_nodes && regen_data->incr_child_uids) {
+		g_hash_table_iter_init (&iter, regen_data->incr_child_uids);
+		while (g_hash_table_iter_next (&iter, &key, NULL)) {
+			GNode *node, *new_parent;
+
+			node = g_hash_table_lookup (message_list->uid_nodemap, key);
+			if (!node)
+				continue;
+
+			new_parent = ml_incremental_find_new_parent (node, added_nodes);
+			if (new_parent && new_parent != node->parent && !g_node_is_ancestor (node, new_parent))
+				message_list_tree_model_move (message_list, node, new_parent, NULL);
+		}
+	}
+
+	if (pending_msgids)
+		g_hash_table_destroy (pending_msgids);
+	if (added_nodes)
+		g_hash_table_destroy (added_nodes);
+	g_ptr_array_free (pending, TRUE);
+
+	if (freeze)
+		message_list_tree_model_thaw (message_list);
+
+	if (table_item) {
+		/* Do not scroll to the cursor, this is a "folder-changed" response. */
+		table_item->queue_show_cursor = FALSE;
+		e_table_item_thaw (table_item);
+	}
+
+	if (message_list->cursor_uid && !g_hash_table_lookup (message_list->uid_nodemap, message_list->cursor_uid)) {
+		g_free (message_list->cursor_uid);
+		message_list->cursor_uid = NULL;
+		g_signal_emit (
+			message_list,
+			signals[MESSAGE_SELECTED], 0, NULL);
+	}
+
+#ifdef TIMEIT
+	gettimeofday (&end, NULL);
+	diff = end.tv_sec * 1000 + end.tv_usec / 1000;
+	diff -= start.tv_sec * 1000 + start.tv_usec / 1000;
+	printf ("Applying changes took %ld.%03ld seconds\n", diff / 1000, diff % 1000);
+#endif
+}
+
 static void
 message_list_regen_done_cb (GObject *source_object,
                             GAsyncResult *result,
@@ -6564,12 +7316,19 @@ message_list_regen_done_cb (GObject *source_object,
 		}
 	}
 
-	if (regen_data->group_by_threads) {
+	if (regen_data->incremental) {
+		message_list_regen_apply_incremental (message_list, regen_data);
+	} else if (regen_data->group_by_threads) {
 		ETableItem *table_item = e_tree_get_item (E_TREE (message_list));
 		GPtrArray *selected;
 		gchar *saveuid = NULL;
 		gboolean forcing_expand_state;
 
+		/* The regen could not be applied in place, thus
+		 * remember the expand state before the rebuild. */
+		if (regen_data->expand_state_deferred && !regen_data->expand_state)
+			regen_data->expand_state = e_tree_table_adapter_save_expanded_state_xml (adapter);
+
 		forcing_expand_state =
 			message_list->expand_all ||
 			message_list->collapse_all;
@@ -6903,6 +7662,10 @@ message_list_regen_idle_cb (gpointer user_data)
 			g_free (txt);
 		}
 
+	} else if (regen_data->incremental) {
+		/* The tree is updated in place, thus saving the expand
+		 * state is needed only when falling back to full regen. */
+		regen_data->expand_state_deferred = TRUE;
 	} else if (regen_data->group_by_threads &&
 		   !message_list->just_set_folder &&
 		   !searching) {
@@ -6963,6 +7726,31 @@ mail_regen_cancel (MessageList *message_list)
 	}
 }
 
+/* The tree reflects the last finished regen, thus only changes of the folder
+ * content can be applied to it; anything else needs to rebuild it. */
+static gboolean
+message_list_can_regen_incremental (MessageList *message_list,
+                                    const gchar *search)
+{
+	if (message_list->just_set_folder ||
+	    message_list->expand_all ||
+	    message_list->collapse_all ||
+	    message_list->priv->thaw_needs_regen ||
+	    message_list->priv->tree_model_root == NULL)
+		return FALSE;
+
+	if (!search || !*search)
+		return !message_list->search || !*message_list->search;
+
+	/* The incremental path evaluates the search only on the changed
+	 * messages, which is not enough for operators looking at other
+	 * messages of the folder, like "match-threads" does. */
+	if (strstr (search, "match-threads"))
+		return FALSE;
+
+	return g_strcmp0 (search, message_list->search) == 0;
+}
+
 static void
 mail_regen_list (MessageList *message_list,
                  const gchar *search,
@@ -7034,6 +7822,17 @@ mail_regen_list (MessageList *message_list,
 			old_regen_data->search = g_strdup (search);
 		}
 
+		if (!folder_changes || !old_regen_data->changes ||
+		    !message_list_can_regen_incremental (message_list, search)) {
+			old_regen_data->incremental = FALSE;
+			if (old_regen_data->changes) {
+				camel_folder_change_info_free (old_regen_data->changes);
+				old_regen_data->changes = NULL;
+			}
+		} else {
+			camel_folder_change_info_cat (old_regen_data->changes, folder_changes);
+		}
+
 		/* Only turn off the folder_changed flag, do not turn it on, because otherwise
 		   the view may not scroll to the cursor position, due to claiming that
 		   the regen was done for folder-changed signal, while the initial regen
@@ -7064,13 +7863,29 @@ mail_regen_list (MessageList *message_list,
 	new_regen_data->search = g_strdup (search);
 	new_regen_data->folder_changed = folder_changes != NULL;
 
+	/* Changes not applied by a cancelled regen can still be applied
+	 * in place, but only if it was not a rebuild for other reasons. */
+	if (folder_changes && (!old_regen_data || old_regen_data->changes)) {
+		new_regen_data->changes = camel_folder_change_info_new ();
+
+		if (old_regen_data)
+			camel_folder_change_info_cat (new_regen_data->changes, old_regen_data->changes);
+
+		camel_folder_change_info_cat (new_regen_data->changes, folder_changes);
+
+		new_regen_data->incremental = message_list_can_regen_incremental (message_list, search);
+	}
+
 	if (folder_changes && folder_changes->uid_removed) {
+		CamelFolderChangeInfo *use_changes;
 		guint ii;
 
+		use_changes = new_regen_data->changes ? new_regen_data->changes : folder_changes;
+
 		new_regen_data->removed_uids = g_hash_table_new_full (g_direct_hash, g_direct_equal, (GDestroyNotify) camel_pstring_free, NULL);
 
-		for (ii = 0; ii < folder_changes->uid_removed->len; ii++) {
-			g_hash_table_insert (new_regen_data->removed_uids, (gpointer) camel_pstring_strdup (folder_changes->uid_removed->pdata[ii]), NULL);
+		for (ii = 0; ii < use_changes->uid_removed->len; ii++) {
+			g_hash_table_insert (new_regen_data->removed_uids, (gpointer) camel_pstring_strdup (use_changes->uid_removed->pdata[ii]), NULL);
 		}
 	}
 
@@ -7121,6 +7936,65 @@ exit:
 	g_free (tmp_search_copy);
 }
 
+/**
+ * message_list_get_neighbour_uids:
+ * @message_list: a #MessageList
+ * @n_next: how many of the following messages to return
+ * @n_prev: how many of the preceding messages to return
+ *
+ * Returns the UIDs of up to @n_next messages shown below the cursor and
+ * up to @n_prev messages shown above it, nearest first, alternating
+ * between the two directions.  Free the returned array with
+ * g_ptr_array_unref().
+ *
+ * Returns: (transfer full): a #GPtrArray of message UIDs
+ **/
+GPtrArray *
+message_list_get_neighbour_uids (MessageList *message_list,
+				 guint n_next,
+				 guint n_prev)
+{
+	ETreeTableAdapter *adapter;
+	GPtrArray *uids;
+	GNode *node;
+	gint row, row_count;
+	guint ii;
+
+	g_return_val_if_fail (IS_MESSAGE_LIST (message_list), NULL);
+
+	uids = g_ptr_array_new_with_free_func (g_free);
+
+	if (!message_list->cursor_uid)
+		return uids;
+
+	node = g_hash_table_lookup (message_list->uid_nodemap, message_list->cursor_uid);
+	if (!node)
+		return uids;
+
+	adapter = e_tree_get_table_adapter (E_TREE (message_list));
+	row_count = e_table_model_row_count (E_TABLE_MODEL (adapter));
+
+	row = e_tree_table_adapter_row_of_node (adapter, node);
+	if (row == -1)
+		return uids;
+
+	for (ii = 1; ii <= MAX (n_next, n_prev); ii++) {
+		if (ii <= n_next && row + (gint) ii < row_count) {
+			node = e_tree_table_adapter_node_at_row (adapter, row + ii);
+			if (node && node->data)
+				g_ptr_array_add (uids, g_strdup (get_message_uid (message_list, node)));
+		}
+
+		if (ii <= n_prev && row - (gint) ii >= 0) {
+			node = e_tree_table_adapter_node_at_row (adapter, row - ii);
+			if (node && node->data)
+				g_ptr_array_add (uids, g_strdup (get_message_uid (message_list, node)));
+		}
+	}
+
+	return uids;
+}
+
 gboolean
 message_list_contains_uid (MessageList *message_list,
 			   const gchar *uid)
@@ -40,13 +40,17 @@ typedef EExtensionClass EMailFormatterTextHighlightLoaderClass;
 typedef struct _TextHighlightClosure TextHighlightClosure;
 
 struct _TextHighlightClosure {
-	gboolean wrote_anything;
 	CamelStream *read_stream;
-	GOutputStream *output_stream;
+	GByteArray *output;
 	GCancellable *cancellable;
 	GError *error;
 };
 
+/* The cache is rooted in its own directory under the user cache directory,
+ * thus its expiry doesn't touch anything else stored there */
+#define HIGHLIGHT_CACHE_DIR "highlight"
+#define HIGHLIGHT_CACHE_PATH "parts"
+
 GType e_mail_formatter_text_highlight_get_type (void);
 
 G_DEFINE_DYNAMIC_TYPE (
@@ -144,17 +148,12 @@ text_hightlight_read_data_thread (gpointer user_data)
 	while (!camel_stream_eos (closure->read_stream) &&
 	       !g_cancellable_set_error_if_cancelled (closure->cancellable, &closure->error)) {
 		gssize read;
-		gsize wrote = 0;
 
 		read = camel_stream_read (closure->read_stream, buffer, nbuffer, closure->cancellable, &closure->error);
 		if (read < 0 || closure->error)
 			break;
 
-		closure->wrote_anything = closure->wrote_anything || read > 0;
-
-		if (!g_output_stream_write_all (closure->output_stream, buffer, read, &wrote, closure->cancellable, &closure->error) ||
-		    (gssize) wrote != read || closure->error)
-			break;
+		g_byte_array_append (closure->output, (const guint8 *) buffer, read);
 	}
 
 	g_free (buffer);
@@ -162,29 +161,22 @@ text_hightlight_read_data_thread (gpointer user_data)
 	return NULL;
 }
 
-static gboolean
-text_highlight_feed_data (GOutputStream *output_stream,
-                          CamelDataWrapper *data_wrapper,
-                          gint pipe_stdin,
-                          gint pipe_stdout,
-                          GCancellable *cancellable,
-                          GError **error)
+/* Decodes the content of the @data_wrapper into memory, converted
+ * to UTF-8, which the 'highlight' expects. */
+static GByteArray *
+text_highlight_decode_content (CamelDataWrapper *data_wrapper,
+                               GCancellable *cancellable,
+                               GError **error)
 {
-	TextHighlightClosure closure;
 	CamelContentType *content_type;
-	CamelStream *write_stream;
-	gboolean success = TRUE;
-	GThread *thread;
-
-	closure.wrote_anything = FALSE;
-	closure.read_stream = camel_stream_fs_new_with_fd (pipe_stdout);
-	closure.output_stream = output_stream;
-	closure.cancellable = cancellable;
-	closure.error = NULL;
+	CamelStream *stream;
+	GByteArray *content;
+	gboolean success;
 
-	write_stream = camel_stream_fs_new_with_fd (pipe_stdin);
+	content = g_byte_array_new ();
 
-	thread = g_thread_new (NULL, text_hightlight_read_data_thread, &closure);
+	stream = camel_stream_mem_new ();
+	camel_stream_mem_set_byte_array (CAMEL_STREAM_MEM (stream), content);
 
 	content_type = camel_data_wrapper_get_mime_type_field (data_wrapper);
 	if (content_type) {
@@ -197,12 +189,12 @@ text_highlight_feed_data (GOutputStream *output_stream,
 
 			filter = camel_mime_filter_charset_new (charset, "UTF-8");
 			if (filter != NULL) {
-				CamelStream *filtered = camel_stream_filter_new (write_stream);
+				CamelStream *filtered = camel_stream_filter_new (stream);
 
 				if (filtered) {
 					camel_stream_filter_add (CAMEL_STREAM_FILTER (filtered), filter);
-					g_object_unref (write_stream);
-					write_stream = filtered;
+					g_object_unref (stream);
+					stream = filtered;
 				}
 
 				g_object_unref (filter);
@@ -210,18 +202,61 @@ text_highlight_feed_data (GOutputStream *output_stream,
 		}
 	}
 
-	if (camel_data_wrapper_decode_to_stream_sync (data_wrapper, write_stream, cancellable, error) < 0) {
+	success = camel_data_wrapper_decode_to_stream_sync (data_wrapper, stream, cancellable, error) >= 0 &&
+		camel_stream_flush (stream, cancellable, error) == 0;
+
+	g_object_unref (stream);
+
+	if (!success) {
+		g_byte_array_free (content, TRUE);
+		content = NULL;
+	}
+
+	return content;
+}
+
+/* Runs the 'highlight' with the @argv on the @content and returns its output,
+ * or NULL when it failed or did not produce anything. */
+static GByteArray *
+text_highlight_run (const gchar * const *argv,
+                    const GByteArray *content,
+                    GCancellable *cancellable,
+                    GError **error)
+{
+	TextHighlightClosure closure;
+	CamelStream *write_stream;
+	gint pipe_stdin, pipe_stdout;
+	gboolean success = TRUE;
+	GThread *thread;
+	GPid pid;
+
+	if (!g_spawn_async_with_pipes (
+		NULL, (gchar **) argv, NULL, 0, NULL, NULL,
+		&pid, &pipe_stdin, &pipe_stdout, NULL, NULL))
+		return NULL;
+
+	closure.read_stream = camel_stream_fs_new_with_fd (pipe_stdout);
+	closure.output = g_byte_array_new ();
+	closure.cancellable = cancellable;
+	closure.error = NULL;
+
+	write_stream = camel_stream_fs_new_with_fd (pipe_stdin);
+
+	thread = g_thread_new (NULL, text_hightlight_read_data_thread, &closure);
+
+	if (camel_stream_write (write_stream, (const gchar *) content->data, content->len, cancellable, error) < 0) {
 		g_cancellable_cancel (cancellable);
 		success = FALSE;
-	} else {
-		/* Close the stream, thus the highlight knows no more data will come */
-		g_clear_object (&write_stream);
 	}
 
+	/* Close the stream, thus the highlight knows no more data will come */
+	g_clear_object (&write_stream);
+
 	g_thread_join (thread);
 
 	g_clear_object (&closure.read_stream);
-	g_clear_object (&write_stream);
+
+	g_spawn_close_pid (pid);
 
 	if (closure.error) {
 		if (error && !*error)
@@ -229,10 +264,146 @@ text_highlight_feed_data (GOutputStream *output_stream,
 		else
 			g_clear_error (&closure.error);
 
-		return FALSE;
+		success = FALSE;
+	}
+
+	if (!success || !closure.output->len) {
+		g_byte_array_free (closure.output, TRUE);
+		return NULL;
 	}
 
-	return success && closure.wrote_anything;
+	return closure.output;
+}
+
+/* The output of the 'highlight' is cached on disk, thus re-opening
+ * the same patch or source file does not run it again. The output
+ * of encrypted parts is not cached, not to store it unencrypted. */
+static CamelDataCache *
+text_highlight_ref_cache (void)
+{
+	G_LOCK_DEFINE_STATIC (cache);
+	static CamelDataCache *cache = NULL;
+	static gboolean cache_failed = FALSE;
+	CamelDataCache *result;
+
+	G_LOCK (cache);
+
+	if (!cache && !cache_failed) {
+		GError *error = NULL;
+		gchar *cache_dir;
+
+		cache_dir = g_build_filename (e_get_user_cache_dir (), HIGHLIGHT_CACHE_DIR, NULL);
+		cache = camel_data_cache_new (cache_dir, &error);
+		g_free (cache_dir);
+
+		if (cache) {
+			/* cache expiry - 1 day access, 1 week max */
+			camel_data_cache_set_expire_age (cache, 7 * 24 * 60 * 60);
+			camel_data_cache_set_expire_access (cache, 24 * 60 * 60);
+		} else {
+			g_warning ("%s: Failed to create cache: %s", G_STRFUNC, error ? error->message : "Unknown error");
+			g_clear_error (&error);
+			cache_failed = TRUE;
+		}
+	}
+
+	result = cache ? g_object_ref (cache) : NULL;
+
+	G_UNLOCK (cache);
+
+	return result;
+}
+
+/* The key covers the content and all the arguments, thus also the syntax,
+ * the theme and the font, which all influence the output. */
+static gchar *
+text_highlight_compute_cache_key (const gchar * const *argv,
+                                  const GByteArray *content)
+{
+	GChecksum *checksum;
+	gchar *key;
+	gint ii;
+
+	checksum = g_checksum_new (G_CHECKSUM_SHA256);
+
+	for (ii = 0; argv[ii]; ii++) {
+		g_checksum_update (checksum, (const guchar *) argv[ii], strlen (argv[ii]) + 1);
+	}
+
+	g_checksum_update (checksum, content->data, content->len);
+
+	key = g_strdup (g_checksum_get_string (checksum));
+
+	g_checksum_free (checksum);
+
+	return key;
+}
+
+static GByteArray *
+text_highlight_read_cached (CamelDataCache *cache,
+                            const gchar *key,
+                            GCancellable *cancellable)
+{
+	GIOStream *cache_stream;
+	GInputStream *input_stream;
+	GByteArray *output;
+	gchar *buffer;
+	gssize read;
+	const gsize nbuffer = 10240;
+
+	cache_stream = camel_data_cache_get (cache, HIGHLIGHT_CACHE_PATH, key, NULL);
+	if (!cache_stream)
+		return NULL;
+
+	input_stream = g_io_stream_get_input_stream (cache_stream);
+
+	output = g_byte_array_new ();
+	buffer = g_malloc (nbuffer);
+
+	read = g_input_stream_read (input_stream, buffer, nbuffer, cancellable, NULL);
+	while (read > 0) {
+		g_byte_array_append (output, (const guint8 *) buffer, read);
+
+		read = g_input_stream_read (input_stream, buffer, nbuffer, cancellable, NULL);
+	}
+
+	g_free (buffer);
+	g_object_unref (cache_stream);
+
+	if (read < 0 || !output->len) {
+		g_byte_array_free (output, TRUE);
+		output = NULL;
+	}
+
+	return output;
+}
+
+static void
+text_highlight_write_cached (CamelDataCache *cache,
+                             const gchar *key,
+                             const GByteArray *output,
+                             GCancellable *cancellable)
+{
+	GIOStream *cache_stream;
+	GError *local_error = NULL;
+
+	cache_stream = camel_data_cache_add (cache, HIGHLIGHT_CACHE_PATH, key, &local_error);
+	if (cache_stream) {
+		GOutputStream *output_stream;
+
+		output_stream = g_io_stream_get_output_stream (cache_stream);
+
+		if (!g_output_stream_write_all (output_stream, output->data, output->len, NULL, cancellable, &local_error))
+			camel_data_cache_remove (cache, HIGHLIGHT_CACHE_PATH, key, NULL);
+
+		g_io_stream_close (cache_stream, NULL, NULL);
+		g_object_unref (cache_stream);
+	}
+
+	if (local_error && !g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		g_warning ("%s: Failed to write data to cache: %s", G_STRFUNC, local_error->message);
+
+	g_clear_error (&local_error);
 }
 
 static gboolean
@@ -268,9 +439,9 @@ emfe_text_highlight_format (EMailFormatterExtension *extension,
 		goto exit;
 
 	} else if (context->mode == E_MAIL_FORMATTER_MODE_RAW) {
-		gint pipe_stdin, pipe_stdout;
-		GPid pid;
 		CamelDataWrapper *dw;
+		GByteArray *content;
+		GError *local_error = NULL;
 		gchar *font_family, *font_size, *syntax, *theme;
 		PangoFontDescription *fd;
 		GSettings *settings;
@@ -371,34 +542,52 @@ emfe_text_highlight_format (EMailFormatterExtension *extension,
 		g_free (syntax);
 		g_free (theme);
 
-		success = g_spawn_async_with_pipes (
-			NULL, (gchar **) argv, NULL, 0, NULL, NULL,
-			&pid, &pipe_stdin, &pipe_stdout, NULL, NULL);
-
-		if (success) {
-			GError *local_error = NULL;
-
-			success = text_highlight_feed_data (
-				stream, dw,
-				pipe_stdin, pipe_stdout,
-				cancellable, &local_error);
+		content = text_highlight_decode_content (dw, cancellable, &local_error);
+		if (content) {
+			CamelDataCache *cache;
+			GByteArray *output;
+			gchar *cache_key;
+
+			/* The parser marks all the parts of a decrypted message
+			 * as encrypted; their content is not stored on disk. */
+			if ((e_mail_part_get_validity_flags (part) & E_MAIL_PART_VALIDITY_ENCRYPTED) != 0)
+				cache = NULL;
+			else
+				cache = text_highlight_ref_cache ();
+			cache_key = text_highlight_compute_cache_key (argv, content);
+
+			output = cache ? text_highlight_read_cached (cache, cache_key, cancellable) : NULL;
+			if (!output) {
+				output = text_highlight_run (argv, content, cancellable, &local_error);
+
+				if (output && cache)
+					text_highlight_write_cached (cache, cache_key, output, cancellable);
+			}
 
-			if (g_error_matches (
-				local_error, G_IO_ERROR,
-				G_IO_ERROR_CANCELLED)) {
-				/* Do nothing. */
+			success = output && g_output_stream_write_all (
+				stream, output->data, output->len,
+				NULL, cancellable, &local_error);
 
-			} else if (local_error != NULL) {
-				g_warning (
-					"%s: %s", G_STRFUNC,
-					local_error->message);
-			}
+			if (output)
+				g_byte_array_free (output, TRUE);
+			g_byte_array_free (content, TRUE);
+			g_clear_object (&cache);
+			g_free (cache_key);
+		}
 
-			g_clear_error (&local_error);
+		if (g_error_matches (
+			local_error, G_IO_ERROR,
+			G_IO_ERROR_CANCELLED)) {
+			/* Do nothing. */
 
-			g_spawn_close_pid (pid);
+		} else if (local_error != NULL) {
+			g_warning (
+				"%s: %s", G_STRFUNC,
+				local_error->message);
 		}
 
+		g_clear_error (&local_error);
+
 		if (!success) {
 			/* We can't call e_mail_formatter_format_as on text/plain,
 			 * because text-highlight is registered as an handler for